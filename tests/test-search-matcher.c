@@ -0,0 +1,327 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * Copyright (c) 2024 The Thunar development team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "thunar/thunar-search-matcher.h"
+
+
+
+#define DAY (24 * 60 * 60)
+
+
+
+static GFileInfo *
+test_file_info_new (const gchar *display_name,
+                    GFileType    type,
+                    guint64      size,
+                    gint64       mtime)
+{
+  GFileInfo *info;
+
+  info = g_file_info_new ();
+  g_file_info_set_display_name (info, display_name);
+  g_file_info_set_file_type (info, type);
+  g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_STANDARD_SIZE, size);
+  g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED, mtime);
+
+  return info;
+}
+
+
+
+static gboolean
+test_match_info (const gchar *query,
+                 const gchar *display_name,
+                 GFileType    type,
+                 guint64      size,
+                 gint64       mtime)
+{
+  ThunarSearchMatcher *matcher;
+  GFileInfo           *info;
+  gboolean             matched;
+
+  matcher = thunar_search_matcher_new (query, FALSE);
+  g_assert_nonnull (matcher);
+  g_assert_true (thunar_search_matcher_has_predicates (matcher));
+
+  info = test_file_info_new (display_name, type, size, mtime);
+  matched = thunar_search_matcher_match_info (matcher, info);
+  g_object_unref (info);
+  thunar_search_matcher_free (matcher);
+
+  return matched;
+}
+
+
+
+static void
+test_invalid_utf8 (void)
+{
+  g_assert_null (thunar_search_matcher_new ("abc\xff", FALSE));
+  g_assert_null (thunar_search_matcher_new ("\xc3", TRUE));
+}
+
+
+
+static void
+test_substring (void)
+{
+  ThunarSearchMatcher *matcher;
+
+  matcher = thunar_search_matcher_new ("  Report  2024 ", FALSE);
+  g_assert_false (thunar_search_matcher_is_fuzzy (matcher));
+  g_assert_false (thunar_search_matcher_has_predicates (matcher));
+
+  /* all terms, in any order and case */
+  g_assert_cmpint (thunar_search_matcher_score (matcher, "report-2024.pdf"), ==, 0);
+  g_assert_true (thunar_search_matcher_match (matcher, "2024 Annual REPORT.odt"));
+  g_assert_false (thunar_search_matcher_match (matcher, "report-2023.pdf"));
+  g_assert_false (thunar_search_matcher_match (matcher, "r-e-p-o-r-t 2024"));
+  g_assert_cmpint (thunar_search_matcher_score (matcher, "2024"), ==, -1);
+  thunar_search_matcher_free (matcher);
+
+  /* names that are not plain ASCII are normalized as well */
+  matcher = thunar_search_matcher_new ("CAFE", FALSE);
+  g_assert_true (thunar_search_matcher_match (matcher, "Café.txt"));
+  g_assert_false (thunar_search_matcher_match (matcher, "Caffè.txt"));
+  thunar_search_matcher_free (matcher);
+
+  matcher = thunar_search_matcher_new ("über", FALSE);
+  g_assert_true (thunar_search_matcher_match (matcher, "Über uns.html"));
+  g_assert_true (thunar_search_matcher_match (matcher, "uber.txt"));
+  thunar_search_matcher_free (matcher);
+
+  /* an empty query matches everything */
+  matcher = thunar_search_matcher_new ("   ", FALSE);
+  g_assert_true (thunar_search_matcher_match (matcher, "anything"));
+  thunar_search_matcher_free (matcher);
+}
+
+
+
+static void
+test_fuzzy (void)
+{
+  ThunarSearchMatcher *matcher;
+  gint                 consecutive;
+  gint                 boundaries;
+  gint                 gap;
+  gint                 camel;
+
+  matcher = thunar_search_matcher_new ("tf", TRUE);
+  g_assert_true (thunar_search_matcher_is_fuzzy (matcher));
+
+  consecutive = thunar_search_matcher_score (matcher, "tf.txt");
+  boundaries = thunar_search_matcher_score (matcher, "thunar-file.c");
+  camel = thunar_search_matcher_score (matcher, "testFile.c");
+  gap = thunar_search_matcher_score (matcher, "stuff.c");
+
+  g_assert_cmpint (gap, >, 0);
+  g_assert_cmpint (camel, >, gap);
+  g_assert_cmpint (boundaries, >, gap);
+  g_assert_cmpint (consecutive, >, boundaries);
+
+  /* the characters have to appear in order */
+  g_assert_cmpint (thunar_search_matcher_score (matcher, "ft"), ==, -1);
+  g_assert_cmpint (thunar_search_matcher_score (matcher, "t"), ==, -1);
+  thunar_search_matcher_free (matcher);
+
+  /* every term has to match */
+  matcher = thunar_search_matcher_new ("tf xz", TRUE);
+  g_assert_true (thunar_search_matcher_match (matcher, "thunar-file.tar.xz"));
+  g_assert_false (thunar_search_matcher_match (matcher, "thunar-file.tar.gz"));
+  thunar_search_matcher_free (matcher);
+}
+
+
+
+static void
+test_size (void)
+{
+  g_assert_true (test_match_info ("size:>1K", "a", G_FILE_TYPE_REGULAR, 1025, 0));
+  g_assert_false (test_match_info ("size:>1K", "a", G_FILE_TYPE_REGULAR, 1024, 0));
+  g_assert_true (test_match_info ("size:>=1k", "a", G_FILE_TYPE_REGULAR, 1024, 0));
+  g_assert_true (test_match_info ("size:<2M", "a", G_FILE_TYPE_REGULAR, 2 * 1024 * 1024 - 1, 0));
+  g_assert_false (test_match_info ("size:<2M", "a", G_FILE_TYPE_REGULAR, 2 * 1024 * 1024, 0));
+  g_assert_true (test_match_info ("size:=3G", "a", G_FILE_TYPE_REGULAR, G_GUINT64_CONSTANT (3) << 30, 0));
+  g_assert_true (test_match_info ("size:100", "a", G_FILE_TYPE_REGULAR, 100, 0));
+  g_assert_true (test_match_info ("SIZE:<=1t", "a", G_FILE_TYPE_REGULAR, G_GUINT64_CONSTANT (1) << 40, 0));
+
+  /* folders have no meaningful size */
+  g_assert_false (test_match_info ("size:>=0", "a", G_FILE_TYPE_DIRECTORY, 4096, 0));
+}
+
+
+
+static void
+test_type_and_extension (void)
+{
+  g_assert_true (test_match_info ("type:dir", "src", G_FILE_TYPE_DIRECTORY, 0, 0));
+  g_assert_false (test_match_info ("type:dir", "src", G_FILE_TYPE_REGULAR, 0, 0));
+  g_assert_true (test_match_info ("type:file", "a", G_FILE_TYPE_REGULAR, 0, 0));
+  g_assert_true (test_match_info ("type:link", "a", G_FILE_TYPE_SYMBOLIC_LINK, 0, 0));
+
+  g_assert_true (test_match_info ("ext:jpg,png", "photo.JPG", G_FILE_TYPE_REGULAR, 0, 0));
+  g_assert_true (test_match_info ("ext:.png,", "image.png", G_FILE_TYPE_REGULAR, 0, 0));
+  g_assert_false (test_match_info ("ext:jpg", "photo.jpg.txt", G_FILE_TYPE_REGULAR, 0, 0));
+  g_assert_false (test_match_info ("ext:jpg", ".jpg", G_FILE_TYPE_REGULAR, 0, 0));
+  g_assert_false (test_match_info ("ext:d", "conf.d", G_FILE_TYPE_DIRECTORY, 0, 0));
+
+  /* all predicates have to hold */
+  g_assert_true (test_match_info ("type:file ext:log size:>1k", "x.log", G_FILE_TYPE_REGULAR, 2048, 0));
+  g_assert_false (test_match_info ("type:file ext:log size:>1k", "x.log", G_FILE_TYPE_REGULAR, 512, 0));
+}
+
+
+
+static void
+test_modified_age (void)
+{
+  gint64 now = g_get_real_time () / G_USEC_PER_SEC;
+
+  /* an age without a comparison means within that time */
+  g_assert_true (test_match_info ("modified:7d", "a", G_FILE_TYPE_REGULAR, 0, now - DAY));
+  g_assert_false (test_match_info ("modified:7d", "a", G_FILE_TYPE_REGULAR, 0, now - 8 * DAY));
+  g_assert_true (test_match_info ("modified:<=7d", "a", G_FILE_TYPE_REGULAR, 0, now - DAY));
+  g_assert_true (test_match_info ("modified:<2h", "a", G_FILE_TYPE_REGULAR, 0, now - 60 * 60));
+  g_assert_false (test_match_info ("modified:<30m", "a", G_FILE_TYPE_REGULAR, 0, now - 60 * 60));
+
+  /* older than */
+  g_assert_true (test_match_info ("modified:>1y", "a", G_FILE_TYPE_REGULAR, 0, now - 400 * DAY));
+  g_assert_false (test_match_info ("modified:>1y", "a", G_FILE_TYPE_REGULAR, 0, now - 300 * DAY));
+  g_assert_true (test_match_info ("modified:>=2w", "a", G_FILE_TYPE_REGULAR, 0, now - 15 * DAY));
+  g_assert_false (test_match_info ("modified:>1M", "a", G_FILE_TYPE_REGULAR, 0, now - 29 * DAY));
+}
+
+
+
+static void
+test_modified_not_a_predicate (void)
+{
+  ThunarSearchMatcher *matcher;
+  const gchar         *queries[] = { "modified:=7d", "modified:7x", "modified:", "size:>lots", "type:pipe", "ext:," };
+
+  /* malformed predicates are searched for in the names instead */
+  for (guint n = 0; n < G_N_ELEMENTS (queries); n++)
+    {
+      matcher = thunar_search_matcher_new (queries[n], FALSE);
+      g_assert_false (thunar_search_matcher_has_predicates (matcher));
+      g_assert_true (thunar_search_matcher_match (matcher, queries[n]));
+      g_assert_false (thunar_search_matcher_match (matcher, "unrelated"));
+      thunar_search_matcher_free (matcher);
+    }
+}
+
+
+
+static void
+test_modified_day (void)
+{
+  GDateTime *date;
+  GDateTime *date_end;
+  gint64     start;
+  gint64     end;
+
+  /* the whole day in local time, which need not be 24 hours long */
+  date = g_date_time_new_local (2024, 3, 31, 0, 0, 0);
+  date_end = g_date_time_add_days (date, 1);
+  start = g_date_time_to_unix (date);
+  end = g_date_time_to_unix (date_end);
+  g_date_time_unref (date_end);
+  g_date_time_unref (date);
+
+  g_assert_true (test_match_info ("modified:2024-03-31", "a", G_FILE_TYPE_REGULAR, 0, start));
+  g_assert_true (test_match_info ("modified:=2024-03-31", "a", G_FILE_TYPE_REGULAR, 0, end - 1));
+  g_assert_false (test_match_info ("modified:2024-03-31", "a", G_FILE_TYPE_REGULAR, 0, start - 1));
+  g_assert_false (test_match_info ("modified:2024-03-31", "a", G_FILE_TYPE_REGULAR, 0, end));
+
+  g_assert_true (test_match_info ("modified:<2024-03-31", "a", G_FILE_TYPE_REGULAR, 0, start - 1));
+  g_assert_false (test_match_info ("modified:<2024-03-31", "a", G_FILE_TYPE_REGULAR, 0, start));
+  g_assert_true (test_match_info ("modified:<=2024-03-31", "a", G_FILE_TYPE_REGULAR, 0, end - 1));
+  g_assert_false (test_match_info ("modified:<=2024-03-31", "a", G_FILE_TYPE_REGULAR, 0, end));
+  g_assert_true (test_match_info ("modified:>=2024-03-31", "a", G_FILE_TYPE_REGULAR, 0, start));
+  g_assert_false (test_match_info ("modified:>2024-03-31", "a", G_FILE_TYPE_REGULAR, 0, end - 1));
+  g_assert_true (test_match_info ("modified:>2024-03-31", "a", G_FILE_TYPE_REGULAR, 0, end));
+}
+
+
+
+static void
+test_contents (void)
+{
+  ThunarSearchMatcher *matcher;
+  const gchar         *text = "The quick brown fox jumps over the LAZY dog";
+  gchar               *chunk;
+  guint64              found_terms = 0;
+  gsize                overlap;
+  gsize                chunk_size = 8;
+  gsize                length;
+  gsize                offset;
+  gboolean             matched = FALSE;
+
+  matcher = thunar_search_matcher_new ("lazy Brown", TRUE);
+  overlap = thunar_search_matcher_get_overlap (matcher);
+  g_assert_cmpuint (overlap, ==, strlen ("brown") - 1);
+
+  /* feed the text in small chunks, so that the terms straddle them */
+  for (offset = 0; !matched && offset < strlen (text); offset += chunk_size - overlap)
+    {
+      length = MIN (chunk_size, strlen (text) - offset);
+      chunk = g_strndup (text + offset, length);
+      matched = thunar_search_matcher_match_contents (matcher, chunk, length, &found_terms);
+      g_free (chunk);
+    }
+  g_assert_true (matched);
+
+  /* contents are never matched as subsequences */
+  found_terms = 0;
+  chunk = g_strdup ("b-r-o-w-n l-a-z-y");
+  g_assert_false (thunar_search_matcher_match_contents (matcher, chunk, strlen (chunk), &found_terms));
+  g_assert_cmpuint (found_terms, ==, 0);
+  g_free (chunk);
+
+  thunar_search_matcher_free (matcher);
+}
+
+
+
+int
+main (int    argc,
+      char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/search-matcher/invalid-utf8", test_invalid_utf8);
+  g_test_add_func ("/search-matcher/substring", test_substring);
+  g_test_add_func ("/search-matcher/fuzzy", test_fuzzy);
+  g_test_add_func ("/search-matcher/size", test_size);
+  g_test_add_func ("/search-matcher/type-and-extension", test_type_and_extension);
+  g_test_add_func ("/search-matcher/modified-age", test_modified_age);
+  g_test_add_func ("/search-matcher/modified-not-a-predicate", test_modified_not_a_predicate);
+  g_test_add_func ("/search-matcher/modified-day", test_modified_day);
+  g_test_add_func ("/search-matcher/contents", test_contents);
+
+  return g_test_run ();
+}
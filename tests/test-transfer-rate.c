@@ -0,0 +1,233 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * Copyright (c) 2024 The Thunar development team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "thunar/thunar-transfer-rate.h"
+
+
+
+/* the simulated device: 50 MB/s plus 20 ms for every file */
+#define DEVICE_SECONDS_PER_BYTE (1.0 / 50e6)
+#define DEVICE_SECONDS_PER_FILE (0.02)
+
+
+
+typedef struct
+{
+  gdouble time;
+  guint64 bytes;
+  guint64 files;
+} TestTrace;
+
+
+
+/* advances @trace by @files files of @file_size bytes each and adds the
+ * resulting sample to @rate */
+static void
+test_trace_advance (TestTrace          *trace,
+                    ThunarTransferRate *rate,
+                    guint64             files,
+                    guint64             file_size)
+{
+  trace->time += files * (file_size * DEVICE_SECONDS_PER_BYTE + DEVICE_SECONDS_PER_FILE);
+  trace->bytes += files * file_size;
+  trace->files += files;
+
+  thunar_transfer_rate_add_sample (rate, (gint64) (trace->time * G_USEC_PER_SEC + 0.5), trace->bytes, trace->files);
+}
+
+
+
+static void
+test_no_samples (void)
+{
+  ThunarTransferRate *rate;
+  guint               n_samples;
+
+  rate = thunar_transfer_rate_new ();
+  g_assert_cmpint (thunar_transfer_rate_get_remaining_time (rate, 1000, 1), ==, -1);
+  g_assert_cmpfloat (thunar_transfer_rate_get_bytes_per_second (rate), ==, 0.0);
+  thunar_transfer_rate_get_samples (rate, &n_samples);
+  g_assert_cmpuint (n_samples, ==, 0);
+
+  /* a single sample has no rate yet */
+  thunar_transfer_rate_add_sample (rate, 0, 0, 0);
+  g_assert_cmpint (thunar_transfer_rate_get_remaining_time (rate, 1000, 1), ==, -1);
+
+  /* neither has an interval without progress */
+  thunar_transfer_rate_add_sample (rate, G_USEC_PER_SEC, 0, 0);
+  g_assert_cmpint (thunar_transfer_rate_get_remaining_time (rate, 1000, 1), ==, -1);
+
+  thunar_transfer_rate_free (rate);
+  thunar_transfer_rate_free (NULL);
+}
+
+
+
+static void
+test_constant_rate (void)
+{
+  ThunarTransferRate *rate;
+
+  /* 10 MB/s in 1 MB files, sampled after every file */
+  rate = thunar_transfer_rate_new ();
+  for (gint64 n = 0; n <= 300; n++)
+    thunar_transfer_rate_add_sample (rate, n * 100000, n * 1000000, n);
+
+  g_assert_cmpfloat_with_epsilon (thunar_transfer_rate_get_bytes_per_second (rate), 10e6, 1.0);
+  g_assert_cmpfloat_with_epsilon (thunar_transfer_rate_get_files_per_second (rate), 10.0, 1.0);
+
+  /* the files are all alike, so the bytes alone predict the rest */
+  g_assert_cmpint (thunar_transfer_rate_get_remaining_time (rate, 100000000, 100), ==, 10);
+  g_assert_cmpint (thunar_transfer_rate_get_remaining_time (rate, 0, 0), ==, 0);
+
+  thunar_transfer_rate_free (rate);
+}
+
+
+
+static void
+test_mixed_files (void)
+{
+  ThunarTransferRate *rate;
+  TestTrace           trace = { 0.0, 0, 0 };
+  gint64              remaining;
+
+  rate = thunar_transfer_rate_new ();
+  thunar_transfer_rate_add_sample (rate, 0, 0, 0);
+
+  /* a folder of small files, then a few large ones, then small ones again */
+  for (guint n = 0; n < 20; n++)
+    test_trace_advance (&trace, rate, 25, 4096);
+  for (guint n = 0; n < 20; n++)
+    test_trace_advance (&trace, rate, 1, 25000000);
+  for (guint n = 0; n < 20; n++)
+    test_trace_advance (&trace, rate, 25, 4096);
+
+  /* the throughput of the small files says little about large ones,
+   * the model of seconds per byte and per file does not care */
+  remaining = thunar_transfer_rate_get_remaining_time (rate, 1000000000, 1000);
+  g_assert_cmpint (remaining, >=, 39);
+  g_assert_cmpint (remaining, <=, 41);
+
+  remaining = thunar_transfer_rate_get_remaining_time (rate, 0, 1000);
+  g_assert_cmpint (remaining, >=, 19);
+  g_assert_cmpint (remaining, <=, 21);
+
+  remaining = thunar_transfer_rate_get_remaining_time (rate, 1000000000, 0);
+  g_assert_cmpint (remaining, >=, 19);
+  g_assert_cmpint (remaining, <=, 21);
+
+  thunar_transfer_rate_free (rate);
+}
+
+
+
+static void
+test_out_of_order (void)
+{
+  ThunarTransferRate *rate;
+  guint               n_samples;
+  gdouble             bytes_per_second;
+
+  rate = thunar_transfer_rate_new ();
+  thunar_transfer_rate_add_sample (rate, 0, 0, 0);
+  thunar_transfer_rate_add_sample (rate, G_USEC_PER_SEC, 1000, 1);
+  bytes_per_second = thunar_transfer_rate_get_bytes_per_second (rate);
+  g_assert_cmpfloat (bytes_per_second, ==, 1000.0);
+
+  /* samples that do not move forward in time are dropped */
+  thunar_transfer_rate_add_sample (rate, G_USEC_PER_SEC, 5000, 2);
+  thunar_transfer_rate_add_sample (rate, G_USEC_PER_SEC / 2, 9000, 3);
+  thunar_transfer_rate_get_samples (rate, &n_samples);
+  g_assert_cmpuint (n_samples, ==, 2);
+  g_assert_cmpfloat (thunar_transfer_rate_get_bytes_per_second (rate), ==, bytes_per_second);
+
+  /* progress going back, e.g. when a failed file is copied again,
+   * slows the rate down but never makes it negative */
+  thunar_transfer_rate_add_sample (rate, 2 * G_USEC_PER_SEC, 500, 1);
+  g_assert_cmpfloat (thunar_transfer_rate_get_bytes_per_second (rate), <, bytes_per_second);
+  g_assert_cmpfloat (thunar_transfer_rate_get_bytes_per_second (rate), >=, 0.0);
+  g_assert_cmpint (thunar_transfer_rate_get_remaining_time (rate, 1000, 1), >=, 0);
+
+  thunar_transfer_rate_free (rate);
+}
+
+
+
+static void
+test_replay (void)
+{
+  const ThunarTransferRateSample *samples;
+  ThunarTransferRate             *rate;
+  ThunarTransferRate             *replay;
+  GRand                          *generator;
+  guint                           n_samples;
+  gint64                          elapsed = 0;
+  guint64                         bytes = 0;
+  guint64                         files = 0;
+
+  /* an irregular trace, the same one on every run */
+  generator = g_rand_new_with_seed (42);
+  rate = thunar_transfer_rate_new ();
+  for (guint n = 0; n < 500; n++)
+    {
+      thunar_transfer_rate_add_sample (rate, elapsed, bytes, files);
+      elapsed += g_rand_int_range (generator, 1000, 2000000);
+      bytes += g_rand_int_range (generator, 0, 50000000);
+      files += g_rand_int_range (generator, 0, 100);
+    }
+  g_rand_free (generator);
+
+  samples = thunar_transfer_rate_get_samples (rate, &n_samples);
+  g_assert_cmpuint (n_samples, ==, 500);
+
+  replay = thunar_transfer_rate_new ();
+  for (guint n = 0; n < n_samples; n++)
+    thunar_transfer_rate_add_sample (replay, samples[n].time, samples[n].bytes, samples[n].files);
+
+  g_assert_cmpfloat (thunar_transfer_rate_get_bytes_per_second (replay), ==, thunar_transfer_rate_get_bytes_per_second (rate));
+  g_assert_cmpfloat (thunar_transfer_rate_get_files_per_second (replay), ==, thunar_transfer_rate_get_files_per_second (rate));
+  g_assert_cmpint (thunar_transfer_rate_get_remaining_time (replay, 123456789, 321),
+                   ==, thunar_transfer_rate_get_remaining_time (rate, 123456789, 321));
+
+  thunar_transfer_rate_free (replay);
+  thunar_transfer_rate_free (rate);
+}
+
+
+
+int
+main (int    argc,
+      char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/transfer-rate/no-samples", test_no_samples);
+  g_test_add_func ("/transfer-rate/constant-rate", test_constant_rate);
+  g_test_add_func ("/transfer-rate/mixed-files", test_mixed_files);
+  g_test_add_func ("/transfer-rate/out-of-order", test_out_of_order);
+  g_test_add_func ("/transfer-rate/replay", test_replay);
+
+  return g_test_run ();
+}
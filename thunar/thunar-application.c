@@ -51,6 +51,7 @@
 #include "thunar/thunar-gobject-extensions.h"
 #include "thunar/thunar-gtk-extensions.h"
 #include "thunar/thunar-io-jobs.h"
+#include "thunar/thunar-io-uring.h"
 #include "thunar/thunar-preferences.h"
 #include "thunar/thunar-private.h"
 #include "thunar/thunar-progress-dialog.h"
@@ -59,6 +60,7 @@
 #include "thunar/thunar-thumbnail-cache.h"
 #include "thunar/thunar-thumbnailer.h"
 #include "thunar/thunar-transfer-job.h"
+#include "thunar/thunar-transfer-journal.h"
 #include "thunar/thunar-util.h"
 #include "thunar/thunar-view.h"
 
@@ -206,6 +208,8 @@ static GtkWidget *
 thunar_application_get_progress_dialog (ThunarApplication *application);
 static void
 thunar_application_process_files (ThunarApplication *application);
+static gboolean
+thunar_application_resume_transfers (gpointer user_data);
 
 
 
@@ -394,6 +398,9 @@ thunar_application_startup (GApplication *gapp)
   /* initialize the application */
   application->preferences = thunar_preferences_get ();
 
+  /* let local jobs batch their system calls */
+  thunar_io_uring_init (application->preferences);
+
 #ifdef HAVE_GUDEV
   /* establish connection with udev */
   application->udev_client = g_udev_client_new (subsystems);
@@ -415,6 +422,10 @@ thunar_application_startup (GApplication *gapp)
   application->accel_map = NULL;
 
   thunar_application_load_css ();
+
+  /* offer to resume copies interrupted by a crash or logout */
+  g_idle_add_full (G_PRIORITY_LOW, thunar_application_resume_transfers,
+                   g_object_ref (application), g_object_unref);
 }
 
 
@@ -718,6 +729,117 @@ thunar_application_load_css (void)
 
 
 
+static void
+thunar_application_resume_transfers_response (GtkWidget         *dialog,
+                                              gint               response,
+                                              ThunarApplication *application)
+{
+  GPtrArray *journals;
+  GList     *source_file_list;
+  GList     *target_file_list;
+
+  journals = g_object_get_data (G_OBJECT (dialog), "journals");
+
+  for (guint n = 0; n < journals->len; n++)
+    {
+      /* the copy job picks up the journal again */
+      if (response == GTK_RESPONSE_ACCEPT)
+        {
+          if (thunar_transfer_journal_load (g_ptr_array_index (journals, n), &source_file_list, &target_file_list))
+            {
+              thunar_application_copy_to (application, NULL, source_file_list, target_file_list,
+                                          THUNAR_OPERATION_LOG_OPERATIONS, NULL);
+              thunar_g_list_free_full (source_file_list);
+              thunar_g_list_free_full (target_file_list);
+            }
+        }
+      else if (response == GTK_RESPONSE_REJECT)
+        {
+          thunar_transfer_journal_discard (g_ptr_array_index (journals, n));
+        }
+    }
+
+  gtk_widget_destroy (dialog);
+}
+
+
+
+static gboolean
+thunar_application_resume_transfers (gpointer user_data)
+{
+  ThunarApplication *application = THUNAR_APPLICATION (user_data);
+  GtkWidget         *dialog;
+  GString           *folders;
+  GFile             *target_folder;
+  GPtrArray         *resumable;
+  GList             *journals;
+  GList             *source_file_list;
+  GList             *target_file_list;
+  GList             *lp;
+  gchar             *display_name;
+
+  journals = thunar_transfer_journal_list_pending ();
+  resumable = g_ptr_array_new_with_free_func (g_free);
+  folders = g_string_new (NULL);
+
+  for (lp = journals; lp != NULL; lp = lp->next)
+    {
+      if (!thunar_transfer_journal_load (lp->data, &source_file_list, &target_file_list))
+        {
+          thunar_transfer_journal_discard (lp->data);
+          continue;
+        }
+
+      target_folder = g_file_get_parent (target_file_list->data);
+      display_name = target_folder != NULL ? g_file_get_parse_name (target_folder) : g_file_get_parse_name (target_file_list->data);
+      g_string_append_printf (folders, "\n%s", display_name);
+      g_free (display_name);
+
+      if (target_folder != NULL)
+        g_object_unref (target_folder);
+      thunar_g_list_free_full (source_file_list);
+      thunar_g_list_free_full (target_file_list);
+
+      g_ptr_array_add (resumable, g_strdup (lp->data));
+    }
+
+  g_list_free_full (journals, g_free);
+
+  /* ask once for all interrupted copies, without blocking the startup */
+  if (resumable->len > 0)
+    {
+      dialog = gtk_message_dialog_new (NULL, 0,
+                                       GTK_MESSAGE_QUESTION,
+                                       GTK_BUTTONS_NONE,
+                                       ngettext ("Resume the interrupted copy?",
+                                                 "Resume %u interrupted copies?",
+                                                 resumable->len),
+                                       resumable->len);
+      gtk_window_set_title (GTK_WINDOW (dialog), _("Interrupted Copy"));
+      gtk_dialog_add_buttons (GTK_DIALOG (dialog),
+                              _("_Later"), GTK_RESPONSE_CANCEL,
+                              _("_Discard"), GTK_RESPONSE_REJECT,
+                              _("_Resume"), GTK_RESPONSE_ACCEPT,
+                              NULL);
+      gtk_dialog_set_default_response (GTK_DIALOG (dialog), GTK_RESPONSE_ACCEPT);
+      gtk_message_dialog_format_secondary_text (GTK_MESSAGE_DIALOG (dialog),
+                                                _("Copying files to these folders was interrupted before it completed. "
+                                                  "Files that were already copied will be skipped.\n%s"),
+                                                folders->str);
+
+      g_object_set_data_full (G_OBJECT (dialog), "journals", g_ptr_array_ref (resumable), (GDestroyNotify) g_ptr_array_unref);
+      g_signal_connect_object (dialog, "response", G_CALLBACK (thunar_application_resume_transfers_response), application, 0);
+      gtk_window_present (GTK_WINDOW (dialog));
+    }
+
+  g_ptr_array_unref (resumable);
+  g_string_free (folders, TRUE);
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
 static void
 thunar_application_activate (GApplication *gapp)
 {
@@ -0,0 +1,307 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * Copyright (c) 2024 The Thunar development team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Checksums for verifying copied files. Verification only has to catch
+ * corrupted data, not forged data, so it uses XXH64, which runs at memory
+ * speed, rather than a cryptographic hash. SHA-256 is only computed on
+ * request, to compare a file with its sha256sum checksum file. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include "thunar/thunar-checksum.h"
+#include "thunar/thunar-private.h"
+
+
+
+#define XXH_PRIME64_1 G_GUINT64_CONSTANT (0x9E3779B185EBCA87)
+#define XXH_PRIME64_2 G_GUINT64_CONSTANT (0xC2B2AE3D27D4EB4F)
+#define XXH_PRIME64_3 G_GUINT64_CONSTANT (0x165667B19E3779F9)
+#define XXH_PRIME64_4 G_GUINT64_CONSTANT (0x85EBCA77C2B2AE63)
+#define XXH_PRIME64_5 G_GUINT64_CONSTANT (0x27D4EB2F165667C5)
+
+#define XXH_STRIPE_SIZE 32
+
+#define xxh_rotl64(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+
+
+struct _ThunarChecksum
+{
+  /* XXH64 state, with seed 0 */
+  guint64 acc[4];
+  guint64 total_length;
+  guchar  stripe[XXH_STRIPE_SIZE];
+  gsize   stripe_length;
+
+  /* the finished XXH64 digest as hexadecimal string, once computed */
+  gchar digest[17];
+
+  /* %NULL unless SHA-256 was requested */
+  GChecksum *sha256;
+};
+
+
+
+static inline guint64
+xxh_read64 (const guchar *p)
+{
+  guint64 value;
+
+  memcpy (&value, p, sizeof (value));
+  return GUINT64_FROM_LE (value);
+}
+
+
+
+static inline guint32
+xxh_read32 (const guchar *p)
+{
+  guint32 value;
+
+  memcpy (&value, p, sizeof (value));
+  return GUINT32_FROM_LE (value);
+}
+
+
+
+static inline guint64
+xxh_round (guint64 acc,
+           guint64 input)
+{
+  acc += input * XXH_PRIME64_2;
+  acc = xxh_rotl64 (acc, 31);
+  return acc * XXH_PRIME64_1;
+}
+
+
+
+static inline guint64
+xxh_merge_round (guint64 acc,
+                 guint64 value)
+{
+  acc ^= xxh_round (0, value);
+  return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+
+
+static inline void
+xxh_consume_stripe (ThunarChecksum *checksum,
+                    const guchar   *p)
+{
+  checksum->acc[0] = xxh_round (checksum->acc[0], xxh_read64 (p));
+  checksum->acc[1] = xxh_round (checksum->acc[1], xxh_read64 (p + 8));
+  checksum->acc[2] = xxh_round (checksum->acc[2], xxh_read64 (p + 16));
+  checksum->acc[3] = xxh_round (checksum->acc[3], xxh_read64 (p + 24));
+}
+
+
+
+/**
+ * thunar_checksum_new:
+ * @with_sha256 : %TRUE to compute a SHA-256 digest as well.
+ *
+ * Creates a checksum to feed the contents of a file into with
+ * thunar_checksum_update().
+ *
+ * Return value: (transfer full): a new #ThunarChecksum, free it
+ *               with thunar_checksum_free().
+ **/
+ThunarChecksum *
+thunar_checksum_new (gboolean with_sha256)
+{
+  ThunarChecksum *checksum;
+
+  checksum = g_slice_new0 (ThunarChecksum);
+  checksum->acc[0] = XXH_PRIME64_1 + XXH_PRIME64_2;
+  checksum->acc[1] = XXH_PRIME64_2;
+  checksum->acc[2] = 0;
+  checksum->acc[3] = 0 - XXH_PRIME64_1;
+
+  if (with_sha256)
+    checksum->sha256 = g_checksum_new (G_CHECKSUM_SHA256);
+
+  return checksum;
+}
+
+
+
+/**
+ * thunar_checksum_free:
+ * @checksum : a #ThunarChecksum or %NULL.
+ *
+ * Releases @checksum.
+ **/
+void
+thunar_checksum_free (ThunarChecksum *checksum)
+{
+  if (checksum == NULL)
+    return;
+
+  if (checksum->sha256 != NULL)
+    g_checksum_free (checksum->sha256);
+
+  g_slice_free (ThunarChecksum, checksum);
+}
+
+
+
+/**
+ * thunar_checksum_update:
+ * @checksum : a #ThunarChecksum.
+ * @data     : the next chunk of the contents.
+ * @length   : the length of @data.
+ *
+ * Feeds @data into @checksum. This must not be called anymore once a
+ * digest was taken.
+ **/
+void
+thunar_checksum_update (ThunarChecksum *checksum,
+                        const guchar   *data,
+                        gsize           length)
+{
+  const guchar *end = data + length;
+  gsize         n;
+
+  _thunar_return_if_fail (checksum != NULL);
+  _thunar_return_if_fail (checksum->digest[0] == '\0');
+
+  if (checksum->sha256 != NULL)
+    g_checksum_update (checksum->sha256, data, length);
+
+  checksum->total_length += length;
+
+  /* complete a stripe left over from the last chunk first */
+  if (checksum->stripe_length > 0)
+    {
+      n = MIN (length, XXH_STRIPE_SIZE - checksum->stripe_length);
+      memcpy (checksum->stripe + checksum->stripe_length, data, n);
+      checksum->stripe_length += n;
+      data += n;
+
+      if (checksum->stripe_length < XXH_STRIPE_SIZE)
+        return;
+
+      xxh_consume_stripe (checksum, checksum->stripe);
+      checksum->stripe_length = 0;
+    }
+
+  for (; data + XXH_STRIPE_SIZE <= end; data += XXH_STRIPE_SIZE)
+    xxh_consume_stripe (checksum, data);
+
+  /* keep the rest for the next chunk */
+  checksum->stripe_length = end - data;
+  memcpy (checksum->stripe, data, checksum->stripe_length);
+}
+
+
+
+/**
+ * thunar_checksum_get_string:
+ * @checksum : a #ThunarChecksum.
+ *
+ * Finishes the XXH64 digest of the data fed into @checksum.
+ *
+ * Return value: the digest as hexadecimal string, owned by @checksum.
+ **/
+const gchar *
+thunar_checksum_get_string (ThunarChecksum *checksum)
+{
+  const guchar *p;
+  const guchar *end;
+  guint64       hash;
+
+  _thunar_return_val_if_fail (checksum != NULL, NULL);
+
+  if (checksum->digest[0] != '\0')
+    return checksum->digest;
+
+  if (checksum->total_length >= XXH_STRIPE_SIZE)
+    {
+      hash = xxh_rotl64 (checksum->acc[0], 1) + xxh_rotl64 (checksum->acc[1], 7)
+             + xxh_rotl64 (checksum->acc[2], 12) + xxh_rotl64 (checksum->acc[3], 18);
+      for (guint n = 0; n < 4; n++)
+        hash = xxh_merge_round (hash, checksum->acc[n]);
+    }
+  else
+    {
+      hash = XXH_PRIME64_5;
+    }
+
+  hash += checksum->total_length;
+
+  p = checksum->stripe;
+  end = p + checksum->stripe_length;
+  for (; p + 8 <= end; p += 8)
+    {
+      hash ^= xxh_round (0, xxh_read64 (p));
+      hash = xxh_rotl64 (hash, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+    }
+  if (p + 4 <= end)
+    {
+      hash ^= (guint64) xxh_read32 (p) * XXH_PRIME64_1;
+      hash = xxh_rotl64 (hash, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+      p += 4;
+    }
+  for (; p < end; p++)
+    {
+      hash ^= *p * XXH_PRIME64_5;
+      hash = xxh_rotl64 (hash, 11) * XXH_PRIME64_1;
+    }
+
+  /* avalanche */
+  hash ^= hash >> 33;
+  hash *= XXH_PRIME64_2;
+  hash ^= hash >> 29;
+  hash *= XXH_PRIME64_3;
+  hash ^= hash >> 32;
+
+  g_snprintf (checksum->digest, sizeof (checksum->digest), "%016" G_GINT64_MODIFIER "x", hash);
+
+  return checksum->digest;
+}
+
+
+
+/**
+ * thunar_checksum_get_sha256_string:
+ * @checksum : a #ThunarChecksum.
+ *
+ * Finishes the SHA-256 digest of the data fed into @checksum.
+ *
+ * Return value: the digest as hexadecimal string, owned by @checksum,
+ *               or %NULL if @checksum was not created to compute it.
+ **/
+const gchar *
+thunar_checksum_get_sha256_string (ThunarChecksum *checksum)
+{
+  _thunar_return_val_if_fail (checksum != NULL, NULL);
+
+  if (checksum->sha256 == NULL)
+    return NULL;
+
+  return g_checksum_get_string (checksum->sha256);
+}
@@ -0,0 +1,45 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * Copyright (c) 2024 The Thunar development team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __THUNAR_CHECKSUM_H__
+#define __THUNAR_CHECKSUM_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS;
+
+typedef struct _ThunarChecksum ThunarChecksum;
+
+ThunarChecksum *
+thunar_checksum_new (gboolean with_sha256);
+void
+thunar_checksum_free (ThunarChecksum *checksum);
+void
+thunar_checksum_update (ThunarChecksum *checksum,
+                        const guchar   *data,
+                        gsize           length);
+const gchar *
+thunar_checksum_get_string (ThunarChecksum *checksum);
+const gchar *
+thunar_checksum_get_sha256_string (ThunarChecksum *checksum);
+
+G_END_DECLS;
+
+#endif /* !__THUNAR_CHECKSUM_H__ */
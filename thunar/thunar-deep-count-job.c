@@ -27,6 +27,7 @@
 #include "thunar/thunar-job.h"
 #include "thunar/thunar-marshal.h"
 #include "thunar/thunar-private.h"
+#include "thunar/thunar-prune-rules.h"
 #include "thunar/thunar-util.h"
 
 #include <gio/gio.h>
@@ -44,7 +45,7 @@ enum
 
 
 #define DEEP_COUNT_FILE_INFO_NAMESPACE \
-  G_FILE_ATTRIBUTE_STANDARD_TYPE "," G_FILE_ATTRIBUTE_STANDARD_SIZE "," G_FILE_ATTRIBUTE_STANDARD_ALLOCATED_SIZE "," G_FILE_ATTRIBUTE_ID_FILESYSTEM
+  G_FILE_ATTRIBUTE_STANDARD_TYPE "," G_FILE_ATTRIBUTE_STANDARD_SIZE "," G_FILE_ATTRIBUTE_STANDARD_ALLOCATED_SIZE "," G_FILE_ATTRIBUTE_ID_FILESYSTEM "," THUNAR_PRUNE_RULES_ATTRIBUTES
 
 static void
 thunar_deep_count_job_finalize (GObject *object);
@@ -64,7 +65,8 @@ struct _ThunarDeepCountJobClass
                          guint64    total_size_on_disk,
                          guint      file_count,
                          guint      directory_count,
-                         guint      unreadable_directory_count);
+                         guint      unreadable_directory_count,
+                         guint      pruned_directory_count);
 };
 
 struct _ThunarDeepCountJob
@@ -73,6 +75,7 @@ struct _ThunarDeepCountJob
 
   GList              *files;
   GFileQueryInfoFlags query_flags;
+  ThunarPruneRules   *prune_rules;
 
   /* the time of the last "status-update" emission */
   gint64 last_time;
@@ -83,6 +86,7 @@ struct _ThunarDeepCountJob
   guint   file_count;
   guint   directory_count;
   guint   unreadable_directory_count;
+  guint   pruned_directory_count;
 };
 
 
@@ -115,6 +119,8 @@ thunar_deep_count_job_class_init (ThunarDeepCountJobClass *klass)
    * @file_count                 : the number of files.
    * @directory_count            : the number of directories.
    * @unreadable_directory_count : the number of unreadable directories.
+   * @pruned_directory_count     : the number of directories skipped by
+   *                                the prune rules.
    *
    * Emitted by the @job to inform listeners about the number of files,
    * directories and bytes counted so far.
@@ -125,12 +131,13 @@ thunar_deep_count_job_class_init (ThunarDeepCountJobClass *klass)
                 G_SIGNAL_NO_HOOKS,
                 G_STRUCT_OFFSET (ThunarDeepCountJobClass, status_update),
                 NULL, NULL,
-                _thunar_marshal_VOID__UINT64_UINT64_UINT_UINT_UINT,
-                G_TYPE_NONE, 5,
+                _thunar_marshal_VOID__UINT64_UINT64_UINT_UINT_UINT_UINT,
+                G_TYPE_NONE, 6,
                 G_TYPE_UINT64,
                 G_TYPE_UINT64,
                 G_TYPE_UINT,
                 G_TYPE_UINT,
+                G_TYPE_UINT,
                 G_TYPE_UINT);
 }
 
@@ -150,6 +157,7 @@ thunar_deep_count_job_finalize (GObject *object)
   ThunarDeepCountJob *job = THUNAR_DEEP_COUNT_JOB (object);
 
   g_list_free_full (job->files, g_object_unref);
+  thunar_prune_rules_unref (job->prune_rules);
 
   (*G_OBJECT_CLASS (thunar_deep_count_job_parent_class)->finalize) (object);
 }
@@ -168,7 +176,8 @@ thunar_deep_count_job_status_update (ThunarDeepCountJob *job)
                 job->total_size_on_disk,
                 job->file_count,
                 job->directory_count,
-                job->unreadable_directory_count);
+                job->unreadable_directory_count,
+                job->pruned_directory_count);
 }
 
 
@@ -178,6 +187,8 @@ thunar_deep_count_job_process (ExoJob      *job,
                                GFile       *file,
                                GFileInfo   *file_info,
                                const gchar *toplevel_fs_id,
+                               guint32      toplevel_device,
+                               guint        depth,
                                GError     **error)
 {
   ThunarDeepCountJob *count_job = THUNAR_DEEP_COUNT_JOB (job);
@@ -235,6 +246,7 @@ thunar_deep_count_job_process (ExoJob      *job,
     {
       /* first toplevel, so use this id */
       toplevel_fs_id = fs_id;
+      toplevel_device = thunar_prune_rules_get_device (info);
     }
   else if (strcmp (fs_id, toplevel_fs_id) != 0)
     {
@@ -246,7 +258,14 @@ thunar_deep_count_job_process (ExoJob      *job,
     }
 
   /* recurse if we have a directory */
-  if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
+  if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY
+      && !toplevel_file
+      && thunar_prune_rules_match (count_job->prune_rules, info, depth, toplevel_device))
+    {
+      /* skipped before it is even opened */
+      count_job->pruned_directory_count++;
+    }
+  else if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
     {
       /* try to read from the directory */
       enumerator = g_file_enumerate_children (file,
@@ -296,7 +315,7 @@ thunar_deep_count_job_process (ExoJob      *job,
                       child = g_file_resolve_relative_path (file, g_file_info_get_name (child_info));
 
                       /* recurse unless the job was cancelled before */
-                      thunar_deep_count_job_process (job, child, child_info, toplevel_fs_id, error);
+                      thunar_deep_count_job_process (job, child, child_info, toplevel_fs_id, toplevel_device, depth + 1, error);
 
                       /* free resources */
                       g_object_unref (child);
@@ -372,13 +391,14 @@ thunar_deep_count_job_execute (ExoJob  *job,
   count_job->file_count = 0;
   count_job->directory_count = 0;
   count_job->unreadable_directory_count = 0;
+  count_job->pruned_directory_count = 0;
   count_job->last_time = 0;
 
   /* count files, directories and compute size of the job files */
   for (lp = count_job->files; lp != NULL; lp = lp->next)
     {
       gfile = thunar_file_get_file (THUNAR_FILE (lp->data));
-      success = thunar_deep_count_job_process (job, gfile, NULL, NULL, &err);
+      success = thunar_deep_count_job_process (job, gfile, NULL, NULL, 0, 0, &err);
       if (G_UNLIKELY (!success))
         break;
     }
@@ -422,6 +442,7 @@ thunar_deep_count_job_new (GList              *files,
   job = g_object_new (THUNAR_TYPE_DEEP_COUNT_JOB, NULL);
   job->files = g_list_copy (files);
   job->query_flags = flags;
+  job->prune_rules = thunar_prune_rules_new_from_preferences ();
 
   g_list_foreach (job->files, (GFunc) (void (*) (void)) g_object_ref, NULL);
 
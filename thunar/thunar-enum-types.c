@@ -737,6 +737,31 @@ thunar_verify_file_get_type (void)
 
 
 
+GType
+thunar_skip_unchanged_get_type (void)
+{
+  static GType type = G_TYPE_INVALID;
+
+  if (G_UNLIKELY (type == G_TYPE_INVALID))
+    {
+      /* clang-format off */
+      static const GEnumValue values[] =
+      {
+        { THUNAR_SKIP_UNCHANGED_MODE_DISABLED, "THUNAR_SKIP_UNCHANGED_MODE_NEVER",    N_("Never"),},
+        { THUNAR_SKIP_UNCHANGED_MODE_MTIME,    "THUNAR_SKIP_UNCHANGED_MODE_MTIME",    N_("Same Size And Modification Time"),},
+        { THUNAR_SKIP_UNCHANGED_MODE_CHECKSUM, "THUNAR_SKIP_UNCHANGED_MODE_CHECKSUM", N_("Same Size And Contents"),},
+        { 0,                                   NULL,                                  NULL,},
+      };
+      /* clang-format on */
+
+      type = g_enum_register_static (I_ ("ThunarSkipUnchangedMode"), values);
+    }
+
+  return type;
+}
+
+
+
 /**
  * thunar_status_bar_info_toggle_bit:
  * @info   : a #guint.
@@ -439,6 +439,26 @@ thunar_verify_file_get_type (void) G_GNUC_CONST;
 
 
 
+#define THUNAR_TYPE_SKIP_UNCHANGED_MODE (thunar_skip_unchanged_get_type ())
+
+/**
+ * ThunarSkipUnchangedMode:
+ * @THUNAR_SKIP_UNCHANGED_MODE_DISABLED : Copy all files
+ * @THUNAR_SKIP_UNCHANGED_MODE_MTIME    : Skip targets with the same size and modification time
+ * @THUNAR_SKIP_UNCHANGED_MODE_CHECKSUM : Skip targets with the same size and contents
+ **/
+typedef enum
+{
+  THUNAR_SKIP_UNCHANGED_MODE_DISABLED,
+  THUNAR_SKIP_UNCHANGED_MODE_MTIME,
+  THUNAR_SKIP_UNCHANGED_MODE_CHECKSUM,
+} ThunarSkipUnchangedMode;
+
+GType
+thunar_skip_unchanged_get_type (void) G_GNUC_CONST;
+
+
+
 /**
  * ThunarNewTabBehavior:
  * @THUNAR_NEW_TAB_BEHAVIOR_FOLLOW_PREFERENCE   : switching to the new tab or not is controlled by a preference.
@@ -51,6 +51,18 @@
 #endif /* STATX_DIOALIGN */
 #endif /* HAVE_STATX */
 
+#ifdef HAVE_SYS_SENDFILE_H
+#define HAVE_KERNEL_COPY 1
+#include <errno.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(HAVE_LINUX_FS_H) && defined(HAVE_SYS_IOCTL_H)
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
+#endif /* HAVE_SYS_SENDFILE_H */
+
 #endif /* __linux__ */
 
 #include <gio/gdesktopappinfo.h>
@@ -58,8 +70,10 @@
 
 #endif /* HAVE_GIO_UNIX */
 
+#include "thunar/thunar-checksum.h"
 #include "thunar/thunar-file.h"
 #include "thunar/thunar-gio-extensions.h"
+#include "thunar/thunar-io-uring.h"
 #include "thunar/thunar-preferences.h"
 #include "thunar/thunar-private.h"
 #include "thunar/thunar-util.h"
@@ -69,6 +83,16 @@
 #define CMP_BUF_MIN_ALIGN (16)
 #define CMP_BUF_SIZE (1024 * 512)
 
+/* default number of bytes copied per read() / copy_file_range() / sendfile() call */
+#define COPY_BUF_SIZE (1024 * 1024 * 8)
+
+/* files from this size on are dropped from the page cache while copying */
+#define DROP_CACHE_MIN_SIZE (1024 * 1024 * 64)
+
+/* files from this size on are copied with O_DIRECT, if enabled */
+#define DIRECT_IO_MIN_SIZE (G_GOFFSET_CONSTANT (1024) * 1024 * 1024)
+#define DIRECT_IO_ALIGN (4096)
+
 #ifndef O_BINARY
 #define O_BINARY (0)
 #endif
@@ -760,20 +784,674 @@ thunar_g_file_hastable_get_type (void)
 
 
 
+#ifdef HAVE_KERNEL_COPY
+/* Writes back and drops the cached pages of the range @offset to
+ * @offset + @length of both files, so copying large files does not
+ * evict everything else from the page cache */
+static void
+thunar_g_file_copy_drop_cache (gint    source_fd,
+                               gint    dest_fd,
+                               goffset offset,
+                               goffset length)
+{
+  sync_file_range (dest_fd, offset, length,
+                   SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+  posix_fadvise (dest_fd, offset, length, POSIX_FADV_DONTNEED);
+  posix_fadvise (source_fd, offset, length, POSIX_FADV_DONTNEED);
+}
+
+
+
+static gboolean
+thunar_g_file_set_direct_io (gint     fd,
+                             gboolean enabled)
+{
+  gint fd_flags;
+
+  fd_flags = fcntl (fd, F_GETFL);
+  if (fd_flags < 0)
+    return FALSE;
+
+  fd_flags = enabled ? (fd_flags | O_DIRECT) : (fd_flags & ~O_DIRECT);
+  return fcntl (fd, F_SETFL, fd_flags) == 0;
+}
+
+
+
+/* Copies @size bytes between two file descriptors opened with O_DIRECT
+ * through aligned buffers of @buffer_size bytes, several of them in flight
+ * at once if io_uring is available. Returns 0 on success or an errno value,
+ * the number of copied bytes is stored in @copied_return */
+static gint
+thunar_g_file_copy_direct (gint                  source_fd,
+                           gint                  dest_fd,
+                           goffset               size,
+                           gsize                 buffer_size,
+                           GCancellable         *cancellable,
+                           GFileProgressCallback progress_callback,
+                           gpointer              progress_callback_data,
+                           goffset              *copied_return)
+{
+  ThunarIoUring *ring;
+  gpointer       buffer;
+  goffset        copied = 0;
+  gssize         n;
+  gssize         written;
+  gssize         done;
+  gint           saved_errno = 0;
+
+  /* the buffer size must be a multiple of the block size as well */
+  buffer_size = MAX (buffer_size - buffer_size % DIRECT_IO_ALIGN, DIRECT_IO_ALIGN);
+
+  if (posix_memalign (&buffer, DIRECT_IO_ALIGN, buffer_size) != 0)
+    return ENOMEM;
+
+  /* without the page cache every read and write waits for the disk, so
+   * keep several of them in flight. The unaligned tail is left to the
+   * loop below */
+  ring = thunar_io_uring_new ();
+  if (ring != NULL)
+    {
+      saved_errno = thunar_io_uring_copy (ring, source_fd, dest_fd, size - size % DIRECT_IO_ALIGN, buffer_size, cancellable,
+                                          progress_callback, progress_callback_data, &copied);
+      thunar_io_uring_free (ring);
+
+      /* the ring does not move the file offsets */
+      if (saved_errno == ENOSYS)
+        saved_errno = 0;
+      else if (saved_errno == 0 && (lseek (source_fd, copied, SEEK_SET) < 0 || lseek (dest_fd, copied, SEEK_SET) < 0))
+        saved_errno = errno;
+    }
+
+  while (copied < size && saved_errno == 0)
+    {
+      if (g_cancellable_is_cancelled (cancellable))
+        {
+          saved_errno = ECANCELED;
+          break;
+        }
+
+      n = read (source_fd, buffer, buffer_size);
+      if (n < 0)
+        {
+          if (errno == EINTR)
+            continue;
+
+          saved_errno = errno;
+          break;
+        }
+
+      /* the source file was truncated while copying */
+      if (n == 0)
+        break;
+
+      /* direct writes must be aligned, the tail goes through the page cache */
+      if (n % DIRECT_IO_ALIGN != 0 && !thunar_g_file_set_direct_io (dest_fd, FALSE))
+        {
+          saved_errno = errno;
+          break;
+        }
+
+      for (done = 0; done < n; done += written)
+        {
+          written = write (dest_fd, (guchar *) buffer + done, n - done);
+          if (written < 0)
+            {
+              if (errno == EINTR)
+                {
+                  written = 0;
+                  continue;
+                }
+
+              saved_errno = errno;
+              break;
+            }
+        }
+
+      if (saved_errno != 0)
+        break;
+
+      copied += n;
+
+      if (progress_callback != NULL)
+        progress_callback (copied, size, progress_callback_data);
+    }
+
+  free (buffer);
+
+  *copied_return = copied;
+  return saved_errno;
+}
+
+
+
+#ifdef SEEK_DATA
+/* Copies the data regions of the sparse file @source_fd and leaves holes in
+ * @dest_fd where the source has them. Returns 0 on success or an errno value.
+ * The progress counts the holes as copied once they are skipped, so it adds
+ * up to the logical size like any other copy; the offset reached is stored
+ * in @copied_return */
+static gint
+thunar_g_file_copy_sparse (gint                  source_fd,
+                           gint                  dest_fd,
+                           goffset               size,
+                           gsize                 buffer_size,
+                           gboolean              drop_cache,
+                           GCancellable         *cancellable,
+                           GFileProgressCallback progress_callback,
+                           gpointer              progress_callback_data,
+                           goffset              *copied_return)
+{
+  gboolean use_copy_file_range = TRUE;
+  goffset  offset = 0;
+  goffset  data_end;
+  goffset  chunk_start = 0;
+  goffset  chunk_length = 0;
+  off_t    in_offset;
+  off_t    out_offset;
+  gssize   n;
+  gint     saved_errno = 0;
+
+  /* the size of the target covers a hole at the end */
+  if (ftruncate (dest_fd, size) != 0)
+    return errno;
+
+  while (offset < size && saved_errno == 0)
+    {
+      /* skip the hole in front of the next data region */
+      in_offset = lseek (source_fd, offset, SEEK_DATA);
+      if (in_offset < 0)
+        {
+          /* only a hole is left */
+          if (errno == ENXIO)
+            offset = size;
+          else
+            saved_errno = errno;
+          break;
+        }
+
+      data_end = lseek (source_fd, in_offset, SEEK_HOLE);
+      if (data_end < 0)
+        {
+          saved_errno = errno;
+          break;
+        }
+
+      offset = in_offset;
+      data_end = MIN (data_end, size);
+
+      while (offset < data_end)
+        {
+          if (g_cancellable_is_cancelled (cancellable))
+            {
+              saved_errno = ECANCELED;
+              break;
+            }
+
+#ifdef HAVE_COPY_FILE_RANGE
+          if (use_copy_file_range)
+            {
+              in_offset = offset;
+              out_offset = offset;
+              n = copy_file_range (source_fd, &in_offset, dest_fd, &out_offset, MIN ((goffset) buffer_size, data_end - offset), 0);
+
+              /* not supported by the kernel or across these filesystems, try sendfile() */
+              if (n < 0 && (errno == ENOSYS || errno == EXDEV || errno == EOPNOTSUPP || errno == EINVAL))
+                {
+                  use_copy_file_range = FALSE;
+                  continue;
+                }
+            }
+          else
+#endif
+            {
+              /* sendfile() writes at the file offset of the target */
+              in_offset = offset;
+              if (lseek (dest_fd, offset, SEEK_SET) < 0)
+                n = -1;
+              else
+                n = sendfile (dest_fd, source_fd, &in_offset, MIN ((goffset) buffer_size, data_end - offset));
+            }
+
+          if (n < 0)
+            {
+              if (errno == EINTR)
+                continue;
+
+              saved_errno = errno;
+              break;
+            }
+
+          /* the source file was truncated while copying, so is the copy */
+          if (n == 0)
+            {
+              if (ftruncate (dest_fd, offset) != 0)
+                saved_errno = errno;
+              size = offset;
+              break;
+            }
+
+          if (drop_cache)
+            {
+              /* start writing this chunk back, and wait for the previous one
+               * so its pages can be dropped while the kernel keeps streaming.
+               * The chunks are not contiguous across holes */
+              sync_file_range (dest_fd, offset, n, SYNC_FILE_RANGE_WRITE);
+              if (chunk_length > 0)
+                thunar_g_file_copy_drop_cache (source_fd, dest_fd, chunk_start, chunk_length);
+              chunk_start = offset;
+              chunk_length = n;
+            }
+
+          offset += n;
+
+          if (progress_callback != NULL)
+            progress_callback (offset, size, progress_callback_data);
+        }
+    }
+
+  if (chunk_length > 0)
+    thunar_g_file_copy_drop_cache (source_fd, dest_fd, chunk_start, chunk_length);
+
+  *copied_return = offset;
+  return saved_errno;
+}
+#endif /* SEEK_DATA */
+
+
+
+/* Copies a local regular file without passing the data through userspace: it
+ * tries to reflink the file (FICLONE) first, then copy_file_range() which may
+ * do a server-side copy on NFS, and sendfile() as last resort. Large files are
+ * read sequentially and dropped from the page cache behind the copy, or copied
+ * with O_DIRECT if @use_direct_io is set. Sparse files keep their holes.
+ * Returns %FALSE if the copy was not attempted and g_file_copy() should be
+ * used instead, otherwise the result is stored in @success */
+static gboolean
+thunar_g_file_copy_kernel (GFile                *source,
+                           GFile                *destination,
+                           GFileCopyFlags        flags,
+                           gsize                 buffer_size,
+                           gboolean              use_direct_io,
+                           GCancellable         *cancellable,
+                           GFileProgressCallback progress_callback,
+                           gpointer              progress_callback_data,
+                           gboolean             *success,
+                           GError              **error)
+{
+  struct stat source_stat;
+  const gchar *source_path;
+  const gchar *dest_path;
+  gboolean     use_copy_file_range = TRUE;
+  gboolean     drop_cache;
+  gboolean     cloned = FALSE;
+  gboolean     sparse = FALSE;
+  goffset      copied = 0;
+  goffset      reported = 0;
+  goffset      chunk_start = 0;
+  gssize       n;
+  gint         source_fd;
+  gint         dest_fd;
+  gint         saved_errno = 0;
+
+  /* overwriting, backups and metadata are left to gio */
+  if ((flags & (G_FILE_COPY_OVERWRITE | G_FILE_COPY_BACKUP | G_FILE_COPY_ALL_METADATA)) != 0)
+    return FALSE;
+
+  if (!g_file_is_native (source) || !g_file_is_native (destination))
+    return FALSE;
+
+  source_path = g_file_peek_path (source);
+  dest_path = g_file_peek_path (destination);
+  if (source_path == NULL || dest_path == NULL)
+    return FALSE;
+
+  source_fd = open (source_path, O_RDONLY | O_CLOEXEC | ((flags & G_FILE_COPY_NOFOLLOW_SYMLINKS) ? O_NOFOLLOW : 0));
+  if (source_fd < 0)
+    return FALSE;
+
+  /* only regular files, gio knows how to handle the rest */
+  if (fstat (source_fd, &source_stat) != 0 || !S_ISREG (source_stat.st_mode))
+    {
+      close (source_fd);
+      return FALSE;
+    }
+
+  /* let gio report existing targets in its usual way. The permissions of
+   * the source are only set once the data is written, targets with default
+   * permissions get whatever the umask leaves of 0666, like in gio */
+  dest_fd = open (dest_path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+                  (flags & G_FILE_COPY_TARGET_DEFAULT_PERMS) != 0 ? 0666 : 0600);
+  if (dest_fd < 0)
+    {
+      close (source_fd);
+      return FALSE;
+    }
+
+#ifdef FICLONE
+  /* share the extents if the filesystem supports reflinks */
+  if (ioctl (dest_fd, FICLONE, source_fd) == 0)
+    {
+      copied = source_stat.st_size;
+      cloned = TRUE;
+    }
+#endif
+
+  if (!cloned && use_direct_io && source_stat.st_size >= DIRECT_IO_MIN_SIZE)
+    {
+      /* bypass the page cache, if both filesystems support it */
+      if (thunar_g_file_set_direct_io (source_fd, TRUE))
+        {
+          if (thunar_g_file_set_direct_io (dest_fd, TRUE))
+            {
+              saved_errno = thunar_g_file_copy_direct (source_fd, dest_fd, source_stat.st_size, buffer_size, cancellable,
+                                                       progress_callback, progress_callback_data, &copied);
+              reported = copied;
+            }
+          else
+            {
+              thunar_g_file_set_direct_io (source_fd, FALSE);
+            }
+        }
+    }
+
+  /* tell the kernel to read ahead aggressively, and drop the pages of
+   * large files once they are copied instead of filling the cache */
+  if (copied < source_stat.st_size && saved_errno == 0)
+    posix_fadvise (source_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+  drop_cache = !cloned && source_stat.st_size >= DROP_CACHE_MIN_SIZE;
+
+#ifdef SEEK_DATA
+  /* fewer allocated blocks than the size means there are holes (VM images,
+   * databases, core dumps), only copy the data instead of writing zeros */
+  if (!cloned && copied == 0 && saved_errno == 0
+      && (goffset) source_stat.st_blocks * 512 < source_stat.st_size)
+    {
+      sparse = TRUE;
+      saved_errno = thunar_g_file_copy_sparse (source_fd, dest_fd, source_stat.st_size, buffer_size, drop_cache, cancellable,
+                                               progress_callback, progress_callback_data, &copied);
+      reported = copied;
+    }
+#endif
+
+  while (!sparse && copied < source_stat.st_size && saved_errno == 0)
+    {
+      if (g_cancellable_is_cancelled (cancellable))
+        {
+          saved_errno = ECANCELED;
+          break;
+        }
+
+#ifdef HAVE_COPY_FILE_RANGE
+      if (use_copy_file_range)
+        {
+          n = copy_file_range (source_fd, NULL, dest_fd, NULL, buffer_size, 0);
+
+          /* not supported by the kernel or across these filesystems, try sendfile() */
+          if (n < 0 && copied == 0 && (errno == ENOSYS || errno == EXDEV || errno == EOPNOTSUPP || errno == EINVAL))
+            {
+              use_copy_file_range = FALSE;
+              continue;
+            }
+        }
+      else
+#endif
+        n = sendfile (dest_fd, source_fd, NULL, buffer_size);
+
+      if (n < 0)
+        {
+          if (errno == EINTR)
+            continue;
+
+          saved_errno = errno;
+          break;
+        }
+
+      /* the source file was truncated while copying */
+      if (n == 0)
+        break;
+
+      if (drop_cache)
+        {
+          /* start writing this chunk back, and wait for the previous one
+           * so its pages can be dropped while the kernel keeps streaming */
+          sync_file_range (dest_fd, copied, n, SYNC_FILE_RANGE_WRITE);
+          if (copied > chunk_start)
+            thunar_g_file_copy_drop_cache (source_fd, dest_fd, chunk_start, copied - chunk_start);
+          chunk_start = copied;
+        }
+
+      copied += n;
+
+      if (progress_callback != NULL)
+        progress_callback (copied, source_stat.st_size, progress_callback_data);
+      reported = copied;
+    }
+
+  if (!sparse && drop_cache && copied > chunk_start)
+    thunar_g_file_copy_drop_cache (source_fd, dest_fd, chunk_start, copied - chunk_start);
+
+  if (saved_errno == 0 && (flags & G_FILE_COPY_TARGET_DEFAULT_PERMS) == 0)
+    {
+      /* copy the permissions like g_file_copy() does */
+      if (fchmod (dest_fd, source_stat.st_mode & 07777) != 0)
+        saved_errno = errno;
+    }
+
+  /* write errors on network filesystems may only be reported on close */
+  if (close (dest_fd) != 0 && saved_errno == 0)
+    saved_errno = errno;
+  close (source_fd);
+
+  /* the kernel could not copy a single byte, leave it to gio */
+  if (saved_errno != 0 && saved_errno != ECANCELED && copied == 0
+      && (saved_errno == EINVAL || saved_errno == ENOSYS || saved_errno == EOPNOTSUPP))
+    {
+      unlink (dest_path);
+      return FALSE;
+    }
+
+  if (saved_errno != 0)
+    {
+      /* don't leave an incomplete file behind */
+      unlink (dest_path);
+
+      if (saved_errno == ECANCELED)
+        g_cancellable_set_error_if_cancelled (cancellable, error);
+      else
+        g_set_error (error, G_IO_ERROR, g_io_error_from_errno (saved_errno),
+                     "Error copying file \"%s\": %s", dest_path, g_strerror (saved_errno));
+
+      *success = FALSE;
+      return TRUE;
+    }
+
+  /* empty files and reflinks did not report any progress yet */
+  if (progress_callback != NULL && (reported != copied || copied == 0))
+    progress_callback (copied, source_stat.st_size, progress_callback_data);
+
+  *success = TRUE;
+  return TRUE;
+}
+#endif /* HAVE_KERNEL_COPY */
+
+
+
+/* Copies a regular file by streaming it through userspace, feeding every
+ * chunk read from @source into @checksum on the way */
+static gboolean
+thunar_g_file_copy_with_checksum (GFile                *source,
+                                  GFile                *destination,
+                                  GFileCopyFlags        flags,
+                                  gsize                 buffer_size,
+                                  GCancellable         *cancellable,
+                                  GFileProgressCallback progress_callback,
+                                  gpointer              progress_callback_data,
+                                  ThunarChecksum       *checksum,
+                                  GError              **error)
+{
+  GFileInputStream  *input;
+  GFileOutputStream *output;
+  GCancellable      *close_cancellable;
+  GFileInfo         *info;
+  gboolean           replacing = (flags & G_FILE_COPY_OVERWRITE) != 0;
+  gboolean           success = FALSE;
+  goffset            total_size = 0;
+  goffset            copied = 0;
+  guchar            *buffer;
+  gssize             n;
+
+  input = g_file_read (source, cancellable, error);
+  if (input == NULL)
+    return FALSE;
+
+  info = g_file_input_stream_query_info (input, G_FILE_ATTRIBUTE_STANDARD_SIZE, cancellable, NULL);
+  if (info != NULL)
+    {
+      total_size = g_file_info_get_size (info);
+      g_object_unref (info);
+    }
+
+  if (replacing)
+    output = g_file_replace (destination, NULL, (flags & G_FILE_COPY_BACKUP) != 0,
+                             G_FILE_CREATE_REPLACE_DESTINATION, cancellable, error);
+  else
+    output = g_file_create (destination, G_FILE_CREATE_NONE, cancellable, error);
+
+  if (output == NULL)
+    {
+      g_object_unref (input);
+      return FALSE;
+    }
+
+  buffer = g_malloc (buffer_size);
+
+  for (;;)
+    {
+      n = g_input_stream_read (G_INPUT_STREAM (input), buffer, buffer_size, cancellable, error);
+      if (n < 0)
+        break;
+
+      if (n == 0)
+        {
+          success = TRUE;
+          break;
+        }
+
+      thunar_checksum_update (checksum, buffer, n);
+
+      if (!g_output_stream_write_all (G_OUTPUT_STREAM (output), buffer, n, NULL, cancellable, error))
+        break;
+
+      copied += n;
+
+      if (progress_callback != NULL)
+        progress_callback (copied, MAX (copied, total_size), progress_callback_data);
+    }
+
+  g_free (buffer);
+
+  if (success)
+    {
+      /* close errors are still write errors */
+      success = g_output_stream_close (G_OUTPUT_STREAM (output), cancellable, error);
+    }
+  else if (replacing)
+    {
+      /* a cancelled close drops the new contents and keeps the file that was to be replaced */
+      close_cancellable = g_cancellable_new ();
+      g_cancellable_cancel (close_cancellable);
+      g_output_stream_close (G_OUTPUT_STREAM (output), close_cancellable, NULL);
+      g_object_unref (close_cancellable);
+    }
+  else
+    {
+      g_output_stream_close (G_OUTPUT_STREAM (output), NULL, NULL);
+    }
+
+  g_object_unref (output);
+  g_object_unref (input);
+
+  if (success)
+    {
+      /* like g_file_copy(), failing to copy the attributes is not an error */
+      g_file_copy_attributes (source, destination, flags, cancellable, NULL);
+    }
+  else if (!replacing)
+    {
+      /* don't leave the incomplete file behind we created */
+      g_file_delete (destination, NULL, NULL);
+    }
+
+  return success;
+}
+
+
+
+static gboolean
+thunar_g_file_copy_internal (GFile                *source,
+                             GFile                *destination,
+                             GFileCopyFlags        flags,
+                             gsize                 buffer_size,
+                             gboolean              use_direct_io,
+                             GCancellable         *cancellable,
+                             GFileProgressCallback progress_callback,
+                             gpointer              progress_callback_data,
+                             ThunarChecksum       *checksum,
+                             GError              **error)
+{
+#ifdef HAVE_KERNEL_COPY
+  gboolean success;
+#endif
+
+  if (buffer_size == 0)
+    buffer_size = COPY_BUF_SIZE;
+
+  /* the data has to pass through userspace to be hashed */
+  if (checksum != NULL)
+    return thunar_g_file_copy_with_checksum (source, destination, flags, buffer_size, cancellable,
+                                             progress_callback, progress_callback_data,
+                                             checksum, error);
+
+#ifdef HAVE_KERNEL_COPY
+
+  /* try to let the kernel do the copy for local files */
+  if (thunar_g_file_copy_kernel (source, destination, flags, buffer_size, use_direct_io, cancellable,
+                                 progress_callback, progress_callback_data,
+                                 &success, error))
+    return success;
+#endif
+
+  return g_file_copy (source, destination, flags, cancellable, progress_callback, progress_callback_data, error);
+}
+
+
+
 /**
  * thunar_g_file_copy:
  * @source                 : input #GFile
  * @destination            : destination #GFile
  * @flags                  : set of #GFileCopyFlags
  * @use_partial            : option to use *.partial~
+ * @buffer_size            : number of bytes to copy at once, or 0 for the default
+ * @use_direct_io          : whether very large local files should bypass the page cache
  * @cancellable            : (nullable): optional #GCancellable object
  * @progress_callback      : (nullable) (scope call): function to callback with progress information
  * @progress_callback_data : (clousure): user data to pass to @progress_callback
+ * @checksum               : (nullable): #ThunarChecksum to feed the copied data into
  * @error                  : (nullable): #GError to set on error
  *
  * Calls g_file_copy() if @use_partial is not enabled.
  * If enabled, copies files to *.partial~ first and then
- * renames *.partial~ into its original name.
+ * renames *.partial~ into its original name. Local regular
+ * files are copied by the kernel (reflink, copy_file_range()
+ * or sendfile()) when possible. Large local files are dropped
+ * from the page cache behind the copy, or copied with O_DIRECT
+ * if @use_direct_io is set and the filesystems support it.
+ *
+ * If @checksum is given, @source must be a regular file. Its
+ * contents are then hashed while being copied, so verifying
+ * the copy only requires reading @destination again.
  *
  * Return value: %TRUE on success, %FALSE otherwise.
  **/
@@ -782,9 +1460,12 @@ thunar_g_file_copy (GFile                *source,
                     GFile                *destination,
                     GFileCopyFlags        flags,
                     gboolean              use_partial,
+                    gsize                 buffer_size,
+                    gboolean              use_direct_io,
                     GCancellable         *cancellable,
                     GFileProgressCallback progress_callback,
                     gpointer              progress_callback_data,
+                    ThunarChecksum       *checksum,
                     GError              **error)
 {
   gboolean            success;
@@ -820,7 +1501,7 @@ thunar_g_file_copy (GFile                *source,
 
   if (!use_partial)
     {
-      success = g_file_copy (source, destination, flags, cancellable, progress_callback, progress_callback_data, error);
+      success = thunar_g_file_copy_internal (source, destination, flags, buffer_size, use_direct_io, cancellable, progress_callback, progress_callback_data, checksum, error);
       return success;
     }
 
@@ -868,7 +1549,7 @@ thunar_g_file_copy (GFile                *source,
     g_file_delete (partial, NULL, error);
 
   /* copy file to .partial */
-  success = g_file_copy (source, partial, flags, cancellable, progress_callback, progress_callback_data, error);
+  success = thunar_g_file_copy_internal (source, partial, flags, buffer_size, use_direct_io, cancellable, progress_callback, progress_callback_data, checksum, error);
 
   if (success)
     {
@@ -1050,114 +1731,124 @@ open_file_and_buffer_fallback (GFile        *file,
 
 
 /**
- * thunar_g_file_compare_contents:
- * @file_a      : a #GFile
- * @file_b      : a #GFile
+ * thunar_g_file_compute_checksum:
+ * @file        : a #GFile
  * @cancellable : (nullalble): optional #GCancellable object
  * @error       : (nullalble): optional #GError
  *
- * Compares the contents of @file_a and @file_b.
+ * Computes the checksum of the contents of @file, like
+ * thunar_checksum_get_string() does for a #ThunarChecksum. Local files
+ * are read with O_DIRECT if possible, since @file was usually just
+ * written and parts of it are still in the kernel's buffer cache.
  *
- * Return value: %TRUE if the files match, %FALSE if not.
+ * Return value: (transfer full): the hexadecimal digest or %NULL on error.
  **/
-gboolean
-thunar_g_file_compare_contents (GFile        *file_a,
-                                GFile        *file_b,
+gchar *
+thunar_g_file_compute_checksum (GFile        *file,
                                 GCancellable *cancellable,
                                 GError      **error)
 {
-  GFileInputStream *inp_a = NULL;
-  GInputStream     *inp_b = NULL;
-  void             *buf_a = NULL;
-  void             *buf_b = NULL;
-  unsigned int      buf_align = 0;
-  size_t            buf_size = 0;
-  gboolean          is_equal = FALSE;
+  GInputStream   *inp = NULL;
+  ThunarChecksum *checksum;
+  void           *buf = NULL;
+  unsigned int    buf_align = 0;
+  size_t          buf_size = 0;
+  gchar          *digest = NULL;
+  gsize           bytes_read;
+
+  g_return_val_if_fail (G_IS_FILE (file), NULL);
+  g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-  g_return_val_if_fail (G_IS_FILE (file_a), FALSE);
-  g_return_val_if_fail (G_IS_FILE (file_b), FALSE);
-  g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), FALSE);
-  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+#ifdef HAVE_DIRECT_IO
+  if (g_file_has_uri_scheme (file, "file"))
+    {
+      DBG ("Attempting direct I/O for checksum");
+      inp = open_file_and_buffer_for_direct_io (file, cancellable, &buf, &buf_align, &buf_size);
+    }
+#endif
 
-  // We assume that file_b is the destination file, and that's the one that
-  // really needs to be opened using O_DIRECT, as it's just been written, and
-  // some (or even all) of it will still be in the kernel's buffer cache.
-  // file_a can be opened normally, and will hopefully/likely be read from
-  // buffer cache, which is both fine and faster.
+  if (inp == NULL)
+    inp = open_file_and_buffer_fallback (file, cancellable, &buf, &buf_align, &buf_size, error);
 
-  inp_a = g_file_read (file_a, cancellable, error);
+  if (inp == NULL)
+    return NULL;
 
-  if (inp_a != NULL)
+  checksum = thunar_checksum_new (FALSE);
+
+  for (;;)
     {
-#ifdef HAVE_DIRECT_IO
-      if (g_file_has_uri_scheme (file_b, "file"))
-        {
-          DBG ("Attempting direct I/O for destination file");
-          inp_b = open_file_and_buffer_for_direct_io (file_b, cancellable, &buf_b, &buf_align, &buf_size);
-        }
-#endif
+      if (!g_input_stream_read_all (inp, buf, buf_size, &bytes_read, cancellable, error))
+        break;
 
-      if (inp_b == NULL)
+      if (bytes_read == 0)
         {
-          inp_b = open_file_and_buffer_fallback (file_b, cancellable, &buf_b, &buf_align, &buf_size, error);
+          digest = g_strdup (thunar_checksum_get_string (checksum));
+          break;
         }
-    }
 
-  if (inp_b != NULL)
-    {
-      // Now that we know the alignment and size needed for file_b, we can also
-      // allocate the buffer for file_a.
-      if (posix_memalign (&buf_a, buf_align, buf_size) != 0)
-        {
-          g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno), "Failed to allocate aligned memory: %s", strerror (errno));
-        }
+      thunar_checksum_update (checksum, buf, bytes_read);
     }
 
-  if (inp_a != NULL && inp_b != NULL && buf_a != NULL)
-    {
-      for (;;)
-        {
-          gsize bytes_read_a;
-          gsize bytes_read_b;
+  thunar_checksum_free (checksum);
+  g_object_unref (inp);
+  free (buf);
 
-          if (!g_input_stream_read_all (G_INPUT_STREAM (inp_a), buf_a, buf_size, &bytes_read_a, cancellable, error))
-            {
-              break;
-            }
-          if (!g_input_stream_read_all (G_INPUT_STREAM (inp_b), buf_b, buf_size, &bytes_read_b, cancellable, error))
-            {
-              break;
-            }
+  return digest;
+}
 
-          if (bytes_read_a == 0 && bytes_read_b == 0)
-            {
-              is_equal = TRUE;
-              break;
-            }
-          else if (bytes_read_a != bytes_read_b)
-            {
-              break;
-            }
-          else if (memcmp (buf_a, buf_b, bytes_read_a) != 0)
-            {
-              break;
-            }
-        }
-    }
 
-  if (inp_a != NULL)
-    {
-      g_object_unref (inp_a);
-    }
-  if (inp_b != NULL)
+
+/**
+ * thunar_g_file_read_checksum_file:
+ * @file        : a #GFile
+ * @cancellable : (nullalble): optional #GCancellable object
+ *
+ * Looks for a "<name>.sha256" file next to @file, as written by
+ * sha256sum, and returns the SHA-256 digest stored in it.
+ *
+ * Return value: (transfer full): the lowercase hexadecimal digest
+ *               or %NULL if there is no valid checksum file.
+ **/
+gchar *
+thunar_g_file_read_checksum_file (GFile        *file,
+                                  GCancellable *cancellable)
+{
+  GFile *parent;
+  GFile *checksum_file;
+  gchar *base_name;
+  gchar *name;
+  gchar *contents = NULL;
+  gchar *digest = NULL;
+  gsize  length;
+  gsize  digest_length;
+
+  g_return_val_if_fail (G_IS_FILE (file), NULL);
+
+  parent = g_file_get_parent (file);
+  if (parent == NULL)
+    return NULL;
+
+  base_name = g_file_get_basename (file);
+  name = g_strconcat (base_name, ".sha256", NULL);
+  checksum_file = g_file_get_child (parent, name);
+  g_free (name);
+  g_free (base_name);
+  g_object_unref (parent);
+
+  if (g_file_load_contents (checksum_file, cancellable, &contents, &length, NULL, NULL))
     {
-      g_object_unref (inp_b);
+      /* the digest is the first word of the file */
+      digest_length = strspn (contents, "0123456789abcdefABCDEF");
+      if (digest_length == (gsize) g_checksum_type_get_length (G_CHECKSUM_SHA256) * 2)
+        digest = g_ascii_strdown (contents, digest_length);
+
+      g_free (contents);
     }
 
-  free (buf_a);
-  free (buf_b);
+  g_object_unref (checksum_file);
 
-  return is_equal;
+  return digest;
 }
 
 
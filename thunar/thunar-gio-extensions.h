@@ -21,6 +21,8 @@
 #ifndef __THUNAR_GIO_EXTENSIONS_H__
 #define __THUNAR_GIO_EXTENSIONS_H__
 
+#include "thunar/thunar-checksum.h"
+
 #include <gio/gio.h>
 
 G_BEGIN_DECLS
@@ -108,17 +110,23 @@ thunar_g_file_copy (GFile                *source,
                     GFile                *destination,
                     GFileCopyFlags        flags,
                     gboolean              use_partial,
+                    gsize                 buffer_size,
+                    gboolean              use_direct_io,
                     GCancellable         *cancellable,
                     GFileProgressCallback progress_callback,
                     gpointer              progress_callback_data,
+                    ThunarChecksum       *checksum,
                     GError              **error);
 
-gboolean
-thunar_g_file_compare_contents (GFile        *file_a,
-                                GFile        *file_b,
+gchar *
+thunar_g_file_compute_checksum (GFile        *file,
                                 GCancellable *cancellable,
                                 GError      **error);
 
+gchar *
+thunar_g_file_read_checksum_file (GFile        *file,
+                                  GCancellable *cancellable);
+
 /**
  * THUNAR_TYPE_G_FILE_LIST:
  *
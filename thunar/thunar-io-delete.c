@@ -0,0 +1,619 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * Copyright (c) 2024 The Thunar development team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Deletes local folder trees with several threads. A thread works on one
+ * folder at a time: it unlinks the files in it relative to the file
+ * descriptor of the folder, hands the subfolders to the other threads and
+ * removes a folder as soon as its last subfolder is gone. Only the folders
+ * being worked on are kept in memory, whatever the size of the tree.
+ *
+ * Nothing is asked while deleting. What could not be deleted is returned,
+ * children before their folders, so the caller can ask the user about it
+ * afterwards. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include "thunar/thunar-io-delete.h"
+#include "thunar/thunar-io-uring.h"
+#include "thunar/thunar-private.h"
+
+
+
+/* number of threads deleting folders in parallel */
+#define MAX_DELETE_WORKERS (8)
+
+/* folders waiting for a thread, beyond that the threads descend themselves */
+#define MAX_QUEUED_FOLDERS (4 * MAX_DELETE_WORKERS)
+
+/* time between two progress updates */
+#define PROGRESS_INTERVAL (100 * G_TIME_SPAN_MILLISECOND)
+
+/* from linux/ioprio.h, which is not always installed */
+#ifndef IOPRIO_WHO_PROCESS
+#define IOPRIO_WHO_PROCESS (1)
+#endif
+#ifndef IOPRIO_CLASS_IDLE
+#define IOPRIO_CLASS_IDLE (3)
+#endif
+#ifndef IOPRIO_CLASS_SHIFT
+#define IOPRIO_CLASS_SHIFT (13)
+#endif
+
+
+
+typedef struct _ThunarIoDeleteNode ThunarIoDeleteNode;
+
+static void
+thunar_io_delete_worker (gpointer data,
+                         gpointer user_data);
+static void
+thunar_io_delete_contents (ThunarIoDelete     *delete,
+                           ThunarIoDeleteNode *node);
+static void
+thunar_io_delete_finish (ThunarIoDelete     *delete,
+                         ThunarIoDeleteNode *node);
+
+
+
+struct _ThunarIoDelete
+{
+  GThreadPool          *pool;
+  GCancellable         *cancellable;
+  ThunarThumbnailCache *thumbnail_cache;
+  gboolean              low_priority;
+  gint                  n_deleted; /* atomic */
+
+  GMutex   mutex;
+  GCond    cond;
+  guint    n_queued;
+  gboolean finished;
+  GList   *failures; /* newest first */
+};
+
+struct _ThunarIoDeleteNode
+{
+  ThunarIoDeleteNode *parent;
+  GFile              *file;
+  gchar              *name; /* relative to the parent, the path for the toplevel folder */
+  gint                fd;
+  gint                n_pending; /* subfolders not removed yet, plus one until the contents are read */
+  gint                failed;    /* something in the folder could not be deleted */
+};
+
+/* state of a worker thread, released when the thread exits */
+typedef struct
+{
+  ThunarIoUring *ring;
+  gboolean       low_priority;
+} ThunarIoDeleteThread;
+
+
+
+static void
+thunar_io_delete_thread_free (gpointer data)
+{
+  ThunarIoDeleteThread *thread = data;
+
+  thunar_io_uring_free (thread->ring);
+  g_free (thread);
+}
+
+
+
+static GPrivate delete_thread = G_PRIVATE_INIT (thunar_io_delete_thread_free);
+
+
+
+/**
+ * thunar_io_delete_new:
+ * @low_priority    : whether to delete with idle I/O priority.
+ * @thumbnail_cache : (nullable): cache to drop the thumbnails of deleted files from.
+ *
+ * Return value: a new #ThunarIoDelete, to be released with
+ *               thunar_io_delete_free().
+ **/
+ThunarIoDelete *
+thunar_io_delete_new (gboolean              low_priority,
+                      ThunarThumbnailCache *thumbnail_cache)
+{
+  ThunarIoDelete *delete;
+
+  _thunar_return_val_if_fail (thumbnail_cache == NULL || THUNAR_IS_THUMBNAIL_CACHE (thumbnail_cache), NULL);
+
+  delete = g_slice_new0 (ThunarIoDelete);
+  delete->low_priority = low_priority;
+  if (thumbnail_cache != NULL)
+    delete->thumbnail_cache = g_object_ref (thumbnail_cache);
+  g_mutex_init (&delete->mutex);
+  g_cond_init (&delete->cond);
+
+  return delete;
+}
+
+
+
+void
+thunar_io_delete_free (ThunarIoDelete *delete)
+{
+  if (delete == NULL)
+    return;
+
+  if (delete->pool != NULL)
+    g_thread_pool_free (delete->pool, FALSE, TRUE);
+
+  g_list_free_full (delete->failures, thunar_io_delete_failure_free);
+  g_clear_object (&delete->thumbnail_cache);
+  g_mutex_clear (&delete->mutex);
+  g_cond_clear (&delete->cond);
+  g_slice_free (ThunarIoDelete, delete);
+}
+
+
+
+void
+thunar_io_delete_failure_free (gpointer data)
+{
+  ThunarIoDeleteFailure *failure = data;
+
+  g_object_unref (failure->file);
+  if (failure->error != NULL)
+    g_error_free (failure->error);
+  g_slice_free (ThunarIoDeleteFailure, failure);
+}
+
+
+
+static ThunarIoDeleteThread *
+thunar_io_delete_get_thread (ThunarIoDelete *delete)
+{
+  ThunarIoDeleteThread *thread;
+
+  thread = g_private_get (&delete_thread);
+  if (thread == NULL)
+    {
+      thread = g_new0 (ThunarIoDeleteThread, 1);
+
+      /* an empty batch tells whether the kernel can unlink at all */
+      thread->ring = thunar_io_uring_new ();
+      if (thread->ring != NULL && !thunar_io_uring_unlinkat (thread->ring, AT_FDCWD, NULL, NULL, 0, NULL))
+        g_clear_pointer (&thread->ring, thunar_io_uring_free);
+
+      g_private_set (&delete_thread, thread);
+    }
+
+#if defined(__linux__) && defined(SYS_ioprio_set)
+  /* the threads of the pool are not shared, so this sticks to the deletion */
+  if (delete->low_priority && !thread->low_priority)
+    {
+      syscall (SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT);
+      thread->low_priority = TRUE;
+    }
+#endif
+
+  return thread;
+}
+
+
+
+static void
+thunar_io_delete_add_failure (ThunarIoDelete *delete,
+                              GFile          *file,
+                              gint            saved_errno)
+{
+  ThunarIoDeleteFailure *failure;
+
+  failure = g_slice_new0 (ThunarIoDeleteFailure);
+  failure->file = g_object_ref (file);
+  if (saved_errno != 0)
+    failure->error = g_error_new (G_IO_ERROR, g_io_error_from_errno (saved_errno),
+                                  _("Error removing file: %s"), g_strerror (saved_errno));
+
+  g_mutex_lock (&delete->mutex);
+  delete->failures = g_list_prepend (delete->failures, failure);
+  g_mutex_unlock (&delete->mutex);
+}
+
+
+
+static void
+thunar_io_delete_child_deleted (ThunarIoDelete     *delete,
+                                ThunarIoDeleteNode *node,
+                                const gchar        *name,
+                                gint                saved_errno)
+{
+  GFile *file;
+
+  if (saved_errno == 0)
+    {
+      g_atomic_int_inc (&delete->n_deleted);
+    }
+  else if (saved_errno != ENOENT)
+    {
+      /* files which went away meanwhile are fine */
+      file = g_file_get_child (node->file, name);
+      thunar_io_delete_add_failure (delete, file, saved_errno);
+      g_atomic_int_set (&node->failed, TRUE);
+      g_object_unref (file);
+    }
+}
+
+
+
+static ThunarIoDeleteNode *
+thunar_io_delete_node_new (ThunarIoDeleteNode *parent,
+                           GFile              *file,
+                           const gchar        *name)
+{
+  ThunarIoDeleteNode *node;
+
+  node = g_slice_new0 (ThunarIoDeleteNode);
+  node->parent = parent;
+  node->file = g_object_ref (file);
+  node->name = g_strdup (name);
+  node->fd = -1;
+  node->n_pending = 1;
+
+  if (parent != NULL)
+    g_atomic_int_inc (&parent->n_pending);
+
+  return node;
+}
+
+
+
+static void
+thunar_io_delete_queue (ThunarIoDelete     *delete,
+                        ThunarIoDeleteNode *node)
+{
+  gboolean queue;
+
+  g_mutex_lock (&delete->mutex);
+  queue = (delete->n_queued < MAX_QUEUED_FOLDERS);
+  if (queue)
+    delete->n_queued++;
+  g_mutex_unlock (&delete->mutex);
+
+  if (queue)
+    {
+      g_thread_pool_push (delete->pool, node, NULL);
+    }
+  else
+    {
+      /* the other threads have enough to do, descend ourselves */
+      thunar_io_delete_contents (delete, node);
+      thunar_io_delete_finish (delete, node);
+    }
+}
+
+
+
+static void
+thunar_io_delete_subfolder (ThunarIoDelete     *delete,
+                            ThunarIoDeleteNode *node,
+                            const gchar        *name)
+{
+  GFile *file;
+
+  file = g_file_get_child (node->file, name);
+  thunar_io_delete_queue (delete, thunar_io_delete_node_new (node, file, name));
+  g_object_unref (file);
+}
+
+
+
+static void
+thunar_io_delete_flush (ThunarIoDelete     *delete,
+                        ThunarIoDeleteNode *node,
+                        ThunarIoUring      *ring,
+                        GPtrArray          *names,
+                        gint               *flags,
+                        gint               *results)
+{
+  guint n;
+
+  if (names->len == 0)
+    return;
+
+  thunar_io_uring_unlinkat (ring, node->fd, (const gchar *const *) names->pdata, flags, names->len, results);
+
+  for (n = 0; n < names->len; n++)
+    {
+      /* the directory entry didn't tell it was a folder */
+      if (results[n] == -EISDIR)
+        thunar_io_delete_subfolder (delete, node, g_ptr_array_index (names, n));
+      else
+        thunar_io_delete_child_deleted (delete, node, g_ptr_array_index (names, n), -results[n]);
+    }
+
+  g_ptr_array_set_size (names, 0);
+}
+
+
+
+/* Deletes the files in the folder of @node and queues its subfolders */
+static void
+thunar_io_delete_contents (ThunarIoDelete     *delete,
+                           ThunarIoDeleteNode *node)
+{
+  ThunarIoDeleteThread *thread;
+  struct dirent        *entry;
+  struct stat           statbuf;
+  GPtrArray            *names = NULL;
+  guint8                type;
+  guint                 max_names = 0;
+  gint                 *flags = NULL;
+  gint                 *results = NULL;
+  gint                  saved_errno;
+  gint                  fd;
+  DIR                  *dir;
+
+  thread = thunar_io_delete_get_thread (delete);
+
+  node->fd = openat (node->parent != NULL ? node->parent->fd : AT_FDCWD, node->name,
+                     O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+
+  /* the folder descriptor is kept for the subfolders, the stream is not */
+  fd = (node->fd >= 0) ? dup (node->fd) : -1;
+  dir = (fd >= 0) ? fdopendir (fd) : NULL;
+  if (dir == NULL)
+    {
+      saved_errno = errno;
+      if (fd >= 0)
+        close (fd);
+      if (node->fd >= 0)
+        close (node->fd);
+      node->fd = -1;
+
+      if (saved_errno != ENOENT)
+        {
+          thunar_io_delete_add_failure (delete, node->file, saved_errno);
+          g_atomic_int_set (&node->failed, TRUE);
+        }
+      return;
+    }
+
+  if (thread->ring != NULL)
+    {
+      max_names = thunar_io_uring_get_queue_depth (thread->ring);
+      names = g_ptr_array_new_full (max_names, g_free);
+      flags = g_new0 (gint, max_names);
+      results = g_new (gint, max_names);
+    }
+
+  while ((entry = readdir (dir)) != NULL)
+    {
+      if (g_cancellable_is_cancelled (delete->cancellable))
+        break;
+
+      if (strcmp (entry->d_name, ".") == 0 || strcmp (entry->d_name, "..") == 0)
+        continue;
+
+      type = entry->d_type;
+      if (type == DT_UNKNOWN && fstatat (node->fd, entry->d_name, &statbuf, AT_SYMLINK_NOFOLLOW) == 0)
+        type = IFTODT (statbuf.st_mode);
+
+      if (type == DT_DIR)
+        {
+          thunar_io_delete_subfolder (delete, node, entry->d_name);
+        }
+      else if (names != NULL)
+        {
+          g_ptr_array_add (names, g_strdup (entry->d_name));
+          if (names->len == max_names)
+            thunar_io_delete_flush (delete, node, thread->ring, names, flags, results);
+        }
+      else if (unlinkat (node->fd, entry->d_name, 0) == 0)
+        {
+          thunar_io_delete_child_deleted (delete, node, entry->d_name, 0);
+        }
+      else if (errno == EISDIR)
+        {
+          thunar_io_delete_subfolder (delete, node, entry->d_name);
+        }
+      else
+        {
+          thunar_io_delete_child_deleted (delete, node, entry->d_name, errno);
+        }
+    }
+
+  if (names != NULL)
+    {
+      thunar_io_delete_flush (delete, node, thread->ring, names, flags, results);
+      g_ptr_array_unref (names);
+      g_free (flags);
+      g_free (results);
+    }
+
+  closedir (dir);
+}
+
+
+
+/* Drops the pending count of @node, and removes the folders which are
+ * empty then, going up the tree */
+static void
+thunar_io_delete_finish (ThunarIoDelete     *delete,
+                         ThunarIoDeleteNode *node)
+{
+  ThunarIoDeleteNode *parent;
+
+  while (node != NULL && g_atomic_int_dec_and_test (&node->n_pending))
+    {
+      parent = node->parent;
+
+      if (!g_cancellable_is_cancelled (delete->cancellable))
+        {
+          if (g_atomic_int_get (&node->failed))
+            {
+              /* the caller tries again once it dealt with the contents, unless
+               * the folder could not even be opened, which is reported already */
+              if (node->fd >= 0)
+                thunar_io_delete_add_failure (delete, node->file, 0);
+            }
+          else if (unlinkat (parent != NULL ? parent->fd : AT_FDCWD, node->name, AT_REMOVEDIR) == 0)
+            {
+              g_atomic_int_inc (&delete->n_deleted);
+            }
+          else if (errno != ENOENT)
+            {
+              thunar_io_delete_add_failure (delete, node->file, errno);
+              g_atomic_int_set (&node->failed, TRUE);
+            }
+        }
+
+      if (parent != NULL && g_atomic_int_get (&node->failed))
+        g_atomic_int_set (&parent->failed, TRUE);
+
+      if (parent == NULL)
+        {
+          /* one cleanup drops the thumbnails of everything which is gone
+           * below the folder, instead of a delete request per file */
+          if (delete->thumbnail_cache != NULL)
+            thunar_thumbnail_cache_cleanup_file (delete->thumbnail_cache, node->file);
+
+          g_mutex_lock (&delete->mutex);
+          delete->finished = TRUE;
+          g_cond_broadcast (&delete->cond);
+          g_mutex_unlock (&delete->mutex);
+        }
+
+      if (node->fd >= 0)
+        close (node->fd);
+      g_object_unref (node->file);
+      g_free (node->name);
+      g_slice_free (ThunarIoDeleteNode, node);
+
+      node = parent;
+    }
+}
+
+
+
+static void
+thunar_io_delete_worker (gpointer data,
+                         gpointer user_data)
+{
+  ThunarIoDelete     *delete = user_data;
+  ThunarIoDeleteNode *node = data;
+
+  g_mutex_lock (&delete->mutex);
+  delete->n_queued--;
+  g_mutex_unlock (&delete->mutex);
+
+  thunar_io_delete_contents (delete, node);
+  thunar_io_delete_finish (delete, node);
+}
+
+
+
+/**
+ * thunar_io_delete_tree:
+ * @delete          : a #ThunarIoDelete.
+ * @file            : a local file or folder.
+ * @cancellable     : (nullable): a #GCancellable.
+ * @progress_func   : (nullable): called regularly from the calling thread.
+ * @progress_data   : data for @progress_func.
+ * @failures_return : return location for the #ThunarIoDeleteFailure<!---->s,
+ *                    files before the folders they are in.
+ *
+ * Deletes @file, and everything in it if it is a folder. The number of
+ * files deleted by @delete so far is passed to @progress_func.
+ *
+ * Return value: %TRUE if everything was deleted.
+ **/
+gboolean
+thunar_io_delete_tree (ThunarIoDelete            *delete,
+                       GFile                     *file,
+                       GCancellable              *cancellable,
+                       ThunarIoDeleteProgressFunc progress_func,
+                       gpointer                   progress_data,
+                       GList                    **failures_return)
+{
+  struct stat  statbuf;
+  const gchar *path;
+  gint64       end_time;
+  gint         saved_errno;
+
+  _thunar_return_val_if_fail (delete != NULL, FALSE);
+  _thunar_return_val_if_fail (g_file_is_native (file), FALSE);
+  _thunar_return_val_if_fail (failures_return != NULL, FALSE);
+
+  *failures_return = NULL;
+  path = g_file_peek_path (file);
+
+  /* files need no threads */
+  if (unlink (path) == 0)
+    {
+      g_atomic_int_inc (&delete->n_deleted);
+      if (delete->thumbnail_cache != NULL)
+        thunar_thumbnail_cache_delete_file (delete->thumbnail_cache, file);
+      return TRUE;
+    }
+
+  saved_errno = errno;
+  if (saved_errno != EISDIR && (saved_errno != EPERM || lstat (path, &statbuf) != 0 || !S_ISDIR (statbuf.st_mode)))
+    {
+      if (saved_errno == ENOENT)
+        return TRUE;
+
+      thunar_io_delete_add_failure (delete, file, saved_errno);
+      *failures_return = g_steal_pointer (&delete->failures);
+      return FALSE;
+    }
+
+  if (delete->pool == NULL)
+    delete->pool = g_thread_pool_new (thunar_io_delete_worker, delete, MAX_DELETE_WORKERS, TRUE, NULL);
+
+  delete->cancellable = cancellable;
+
+  g_mutex_lock (&delete->mutex);
+  delete->finished = FALSE;
+  delete->n_queued++;
+  g_thread_pool_push (delete->pool, thunar_io_delete_node_new (NULL, file, path), NULL);
+  while (!delete->finished)
+    {
+      end_time = g_get_monotonic_time () + PROGRESS_INTERVAL;
+      if (!g_cond_wait_until (&delete->cond, &delete->mutex, end_time) && progress_func != NULL)
+        {
+          g_mutex_unlock (&delete->mutex);
+          (*progress_func) ((guint) g_atomic_int_get (&delete->n_deleted), progress_data);
+          g_mutex_lock (&delete->mutex);
+        }
+    }
+  *failures_return = g_list_reverse (g_steal_pointer (&delete->failures));
+  g_mutex_unlock (&delete->mutex);
+
+  if (progress_func != NULL)
+    (*progress_func) ((guint) g_atomic_int_get (&delete->n_deleted), progress_data);
+
+  return *failures_return == NULL;
+}
@@ -0,0 +1,58 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * Copyright (c) 2024 The Thunar development team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __THUNAR_IO_DELETE_H__
+#define __THUNAR_IO_DELETE_H__
+
+#include "thunar/thunar-thumbnail-cache.h"
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS;
+
+typedef struct _ThunarIoDelete ThunarIoDelete;
+
+typedef struct
+{
+  GFile  *file;
+  GError *error; /* %NULL if a folder was kept because of its contents */
+} ThunarIoDeleteFailure;
+
+typedef void (*ThunarIoDeleteProgressFunc) (guint    n_deleted,
+                                            gpointer user_data);
+
+ThunarIoDelete *
+thunar_io_delete_new (gboolean              low_priority,
+                      ThunarThumbnailCache *thumbnail_cache);
+void
+thunar_io_delete_free (ThunarIoDelete *delete);
+gboolean
+thunar_io_delete_tree (ThunarIoDelete            *delete,
+                       GFile                     *file,
+                       GCancellable              *cancellable,
+                       ThunarIoDeleteProgressFunc progress_func,
+                       gpointer                   progress_data,
+                       GList                    **failures_return);
+void
+thunar_io_delete_failure_free (gpointer data);
+
+G_END_DECLS;
+
+#endif /* !__THUNAR_IO_DELETE_H__ */
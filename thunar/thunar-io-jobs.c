@@ -25,18 +25,25 @@
 #ifdef HAVE_ERRNO_H
 #include <errno.h>
 #endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
 
 #include "thunar/thunar-application.h"
 #include "thunar/thunar-enum-types.h"
 #include "thunar/thunar-file.h"
 #include "thunar/thunar-gio-extensions.h"
 #include "thunar/thunar-gobject-extensions.h"
+#include "thunar/thunar-io-delete.h"
 #include "thunar/thunar-io-jobs-util.h"
 #include "thunar/thunar-io-jobs.h"
 #include "thunar/thunar-io-scan-directory.h"
+#include "thunar/thunar-io-trash.h"
 #include "thunar/thunar-job.h"
 #include "thunar/thunar-preferences.h"
 #include "thunar/thunar-private.h"
+#include "thunar/thunar-prune-rules.h"
+#include "thunar/thunar-search-matcher.h"
 #include "thunar/thunar-simple-job.h"
 #include "thunar/thunar-thumbnail-cache.h"
 #include "thunar/thunar-transfer-job.h"
@@ -481,6 +488,114 @@ thunar_io_jobs_make_directories (GList *file_list)
 
 
 
+static ThunarJobResponse
+_tij_unlink_ask_skip (ThunarJob *job,
+                      GFile     *file,
+                      GError    *err)
+{
+  ThunarJobResponse response;
+  GFileInfo        *info;
+  gchar            *base_name;
+  gchar            *display_name;
+
+  /* query the file info for the display name */
+  info = g_file_query_info (file,
+                            G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME,
+                            G_FILE_QUERY_INFO_NONE,
+                            exo_job_get_cancellable (EXO_JOB (job)),
+                            NULL);
+
+  /* abort if the job was cancelled */
+  if (exo_job_is_cancelled (EXO_JOB (job)))
+    {
+      if (info != NULL)
+        g_object_unref (info);
+      return THUNAR_JOB_RESPONSE_CANCEL;
+    }
+
+  /* determine the display name, using the basename as a fallback */
+  if (info != NULL)
+    {
+      display_name = g_strdup (g_file_info_get_display_name (info));
+      g_object_unref (info);
+    }
+  else
+    {
+      base_name = g_file_get_basename (file);
+      display_name = g_filename_display_name (base_name);
+      g_free (base_name);
+    }
+
+  /* ask the user whether he wants to skip this file */
+  response = thunar_job_ask_skip (THUNAR_JOB (job),
+                                  _("Could not delete file \"%s\": %s"),
+                                  display_name, err->message);
+  g_free (display_name);
+
+  return response;
+}
+
+
+
+static void
+_tij_unlink_progress (guint    n_deleted,
+                      gpointer user_data)
+{
+  exo_job_info_message (EXO_JOB (user_data),
+                        ngettext ("Deleted %u file", "Deleted %u files", n_deleted),
+                        n_deleted);
+}
+
+
+
+/* Deletes the local @file and its contents with @delete, and asks the user
+ * about what could not be deleted afterwards */
+static void
+_tij_unlink_native (ThunarJob            *job,
+                    ThunarIoDelete       *delete,
+                    ThunarThumbnailCache *thumbnail_cache,
+                    GFile                *file)
+{
+  ThunarIoDeleteFailure *failure;
+  ThunarJobResponse      response;
+  GError                *err = NULL;
+  GList                 *failures;
+  GList                 *lp;
+
+  if (thunar_io_delete_tree (delete, file, exo_job_get_cancellable (EXO_JOB (job)),
+                             _tij_unlink_progress, job, &failures))
+    return;
+
+  /* the contents of a folder come before the folder */
+  for (lp = failures; lp != NULL && !exo_job_is_cancelled (EXO_JOB (job)); lp = lp->next)
+    {
+      failure = lp->data;
+
+      if (failure->error == NULL)
+        {
+          /* the folder is empty now, unless the user skipped some of its contents */
+          if (_tij_delete_file (failure->file, exo_job_get_cancellable (EXO_JOB (job)), &err))
+            thunar_thumbnail_cache_delete_file (thumbnail_cache, failure->file);
+          else if (!g_error_matches (err, G_IO_ERROR, G_IO_ERROR_NOT_EMPTY))
+            failure->error = g_steal_pointer (&err);
+          g_clear_error (&err);
+
+          if (failure->error == NULL)
+            continue;
+        }
+
+      response = _tij_unlink_ask_skip (job, failure->file, failure->error);
+
+      /* start over with the file or folder */
+      if (response == THUNAR_JOB_RESPONSE_RETRY)
+        _tij_unlink_native (job, delete, thumbnail_cache, failure->file);
+    }
+
+  g_list_free_full (failures, thunar_io_delete_failure_free);
+}
+
+
+
 static gboolean
 _thunar_io_jobs_unlink (ThunarJob *job,
                         GArray    *param_values,
@@ -489,12 +604,12 @@ _thunar_io_jobs_unlink (ThunarJob *job,
   ThunarThumbnailCache *thumbnail_cache;
   ThunarApplication    *application;
   ThunarJobResponse     response;
-  GFileInfo            *info;
+  ThunarIoDelete       *delete;
   GError               *err = NULL;
   GList                *file_list;
+  GList                *native_list = NULL;
+  GList                *other_list = NULL;
   GList                *lp;
-  gchar                *base_name;
-  gchar                *display_name;
   guint                 n_processed = 0;
 
   _thunar_return_val_if_fail (THUNAR_IS_JOB (job), FALSE);
@@ -508,8 +623,22 @@ _thunar_io_jobs_unlink (ThunarJob *job,
   /* tell the user that we're preparing to unlink the files */
   exo_job_info_message (EXO_JOB (job), _("Preparing..."));
 
+  /* local folders are deleted while walking through them, others
+   * are collected first. The local trash folders are moved aside at
+   * once and deleted like local folders */
+  for (lp = file_list; lp != NULL; lp = lp->next)
+    {
+      if (g_file_is_native (lp->data))
+        native_list = g_list_prepend (native_list, g_object_ref (lp->data));
+      else if (!thunar_g_file_is_trash (lp->data) || !thunar_io_trash_empty_local (&native_list))
+        other_list = g_list_prepend (other_list, lp->data);
+    }
+  native_list = g_list_reverse (native_list);
+  other_list = g_list_reverse (other_list);
+
   /* recursively collect files for removal, not following any symlinks */
-  file_list = _tij_collect_nofollow (job, file_list, TRUE, &err);
+  file_list = _tij_collect_nofollow (job, other_list, TRUE, &err);
+  g_list_free (other_list);
 
   /* free the file list and fail if there was an error or the job was cancelled */
   if (err != NULL || exo_job_is_cancelled (EXO_JOB (job)))
@@ -519,18 +648,23 @@ _thunar_io_jobs_unlink (ThunarJob *job,
       else
         g_propagate_error (error, err);
 
+      thunar_g_list_free_full (native_list);
       thunar_g_list_free_full (file_list);
       return FALSE;
     }
 
   /* we know the total list of files to process */
-  thunar_job_set_total_files (THUNAR_JOB (job), file_list);
+  file_list = g_list_concat (native_list, file_list);
+  if (file_list != NULL)
+    thunar_job_set_total_files (THUNAR_JOB (job), file_list);
 
   /* take a reference on the thumbnail cache */
   application = thunar_application_get ();
   thumbnail_cache = thunar_application_get_thumbnail_cache (application);
   g_object_unref (application);
 
+  delete = thunar_io_delete_new (FALSE, thumbnail_cache);
+
   /* remove all the files */
   for (lp = file_list;
        lp != NULL && !exo_job_is_cancelled (EXO_JOB (job));
@@ -545,6 +679,12 @@ _thunar_io_jobs_unlink (ThunarJob *job,
       /* update progress information */
       thunar_job_processing_file (THUNAR_JOB (job), lp, n_processed);
 
+      if (g_file_is_native (lp->data))
+        {
+          _tij_unlink_native (job, delete, thumbnail_cache, lp->data);
+          continue;
+        }
+
 again:
       /* try to delete the file */
       if (_tij_delete_file (lp->data, exo_job_get_cancellable (EXO_JOB (job)), &err))
@@ -555,38 +695,7 @@ again:
         }
       else
         {
-          /* query the file info for the display name */
-          info = g_file_query_info (lp->data,
-                                    G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME,
-                                    G_FILE_QUERY_INFO_NONE,
-                                    exo_job_get_cancellable (EXO_JOB (job)),
-                                    NULL);
-
-          /* abort if the job was cancelled */
-          if (exo_job_is_cancelled (EXO_JOB (job)))
-            {
-              g_clear_error (&err);
-              break;
-            }
-
-          /* determine the display name, using the basename as a fallback */
-          if (info != NULL)
-            {
-              display_name = g_strdup (g_file_info_get_display_name (info));
-              g_object_unref (info);
-            }
-          else
-            {
-              base_name = g_file_get_basename (lp->data);
-              display_name = g_filename_display_name (base_name);
-              g_free (base_name);
-            }
-
-          /* ask the user whether he wants to skip this file */
-          response = thunar_job_ask_skip (THUNAR_JOB (job),
-                                          _("Could not delete file \"%s\": %s"),
-                                          display_name, err->message);
-          g_free (display_name);
+          response = _tij_unlink_ask_skip (job, lp->data, err);
 
           /* clear the error */
           g_clear_error (&err);
@@ -597,6 +706,8 @@ again:
         }
     }
 
+  thunar_io_delete_free (delete);
+
   /* release the thumbnail cache */
   g_object_unref (thumbnail_cache);
 
@@ -869,8 +980,12 @@ _thunar_io_jobs_trash (ThunarJob *job,
   ThunarJobResponse      response;
   ThunarOperationLogMode log_mode;
   GError                *err = NULL;
+  GError                *trash_err = NULL;
   GList                 *file_list;
   GList                 *lp;
+  gboolean              *trashed;
+  gboolean               stopped = FALSE;
+  guint                  n;
 
   _thunar_return_val_if_fail (THUNAR_IS_JOB (job), FALSE);
   _thunar_return_val_if_fail (param_values != NULL, FALSE);
@@ -892,33 +1007,53 @@ _thunar_io_jobs_trash (ThunarJob *job,
   if (log_mode != THUNAR_OPERATION_LOG_NO_OPERATIONS)
     operation = thunar_job_operation_new (THUNAR_JOB_OPERATION_KIND_TRASH);
 
-  for (lp = file_list; err == NULL && lp != NULL; lp = lp->next)
+  /* local files are moved to the trash in batches first */
+  trashed = g_new (gboolean, g_list_length (file_list));
+  thunar_io_trash_files (file_list, exo_job_get_cancellable (EXO_JOB (job)), trashed);
+
+  for (lp = file_list, n = 0; lp != NULL; lp = lp->next, n++)
     {
       _thunar_assert (G_IS_FILE (lp->data));
 
-      /* trash the file or folder */
-      g_file_trash (lp->data, exo_job_get_cancellable (EXO_JOB (job)), &err);
-
-      if (err != NULL)
+      /* trash the file or folder, unless that happened already. Once the
+       * job stopped, the files the batch trashed are still logged below,
+       * so that undo can restore them */
+      if (!trashed[n])
         {
-          response = thunar_job_ask_delete (job, "%s", err->message);
+          if (stopped || err != NULL || exo_job_is_cancelled (EXO_JOB (job)))
+            continue;
 
-          g_clear_error (&err);
+          if (!g_file_trash (lp->data, exo_job_get_cancellable (EXO_JOB (job)), &trash_err))
+            {
+              response = thunar_job_ask_delete (job, "%s", trash_err->message);
 
-          if (response == THUNAR_JOB_RESPONSE_CANCEL)
-            break;
+              g_clear_error (&trash_err);
+
+              if (response == THUNAR_JOB_RESPONSE_CANCEL)
+                {
+                  stopped = TRUE;
+                  continue;
+                }
 
-          if (response == THUNAR_JOB_RESPONSE_YES)
-            _tij_delete_file (lp->data, exo_job_get_cancellable (EXO_JOB (job)), &err);
+              /* a failed delete ends the job with its error */
+              if (response == THUNAR_JOB_RESPONSE_YES
+                  && !_tij_delete_file (lp->data, exo_job_get_cancellable (EXO_JOB (job)), &err))
+                {
+                  thunar_thumbnail_cache_cleanup_file (thumbnail_cache, lp->data);
+                  continue;
+                }
+            }
         }
 
-      if (err == NULL && log_mode != THUNAR_OPERATION_LOG_NO_OPERATIONS)
+      if (log_mode != THUNAR_OPERATION_LOG_NO_OPERATIONS)
         thunar_job_operation_add (operation, lp->data, NULL);
 
       /* update the thumbnail cache */
       thunar_thumbnail_cache_cleanup_file (thumbnail_cache, lp->data);
     }
 
+  g_free (trashed);
+
   /* release the thumbnail cache */
   g_object_unref (thumbnail_cache);
 
@@ -1504,25 +1639,340 @@ thunar_io_jobs_count_files (ThunarFile *file)
 
 
 
+/* fuzzy searches only deliver the best ranked results */
+#define FUZZY_SEARCH_MAX_RESULTS 500
+
+/* how often the best ranked results so far are shown, in microseconds */
+#define FUZZY_SEARCH_FLUSH_INTERVAL (250 * G_TIME_SPAN_MILLISECOND)
+
+/* files only found by their contents rank below every name match */
+#define FUZZY_SEARCH_CONTENT_SCORE 0
+
+/* files larger than this are not searched by content */
+#define CONTENT_SEARCH_MAX_FILE_SIZE (64 * 1024 * 1024)
+#define CONTENT_SEARCH_CHUNK_SIZE    (64 * 1024)
+#define CONTENT_SEARCH_MAX_THREADS   4
+
+/* like git and grep, a NUL byte at the start marks a binary file */
+#define CONTENT_SEARCH_BINARY_PROBE_SIZE 8000
+
+
+
+typedef struct _ThunarSearchContext ThunarSearchContext;
+typedef struct _ThunarSearchHit     ThunarSearchHit;
+
+struct _ThunarSearchContext
+{
+  ThunarStandardViewModel           *model;
+  ThunarJob                         *job;
+  const ThunarSearchMatcher         *matcher;
+  enum ThunarStandardViewModelSearch search_type;
+  gboolean                           show_hidden;
+
+  /* min-heap of the best fuzzy hits found so far, its root is the hit a
+   * new one has to beat once FUZZY_SEARCH_MAX_RESULTS are known. The
+   * content workers rank into it as well, so it is guarded by the mutex */
+  GMutex  mutex;
+  GArray *top_hits;
+
+  /* the hits of the heap which were handed to the model by the last
+   * flush, and whether the heap changed since. Only the directory walk
+   * flushes, so these are not guarded */
+  GHashTable *shown_hits;
+  gboolean    top_hits_changed;
+  gint64      last_flush_time;
+
+  /* the walk and the content workers hand their results to the model
+   * one at a time, the models only queue them for the main thread */
+  GMutex handoff_mutex;
+
+  /* regular files whose names do not match are scanned by these
+   * workers, so the directory walk does not wait for file reads.
+   * NULL if the contents are not searched */
+  GThreadPool *content_pool;
+
+  /* folders matching these rules are not entered */
+  ThunarPruneRules *prune_rules;
+  guint32           toplevel_device;
+  guint             n_pruned;
+};
+
+struct _ThunarSearchHit
+{
+  GFile *file;
+  gint   score;
+};
+
+
+
+static gboolean
+_thunar_search_would_rank (ThunarSearchContext *context,
+                           gint                 score)
+{
+  return context->top_hits->len < FUZZY_SEARCH_MAX_RESULTS
+         || score > g_array_index (context->top_hits, ThunarSearchHit, 0).score;
+}
+
+
+
+static void
+_thunar_search_hit_swap (GArray *heap,
+                         guint   a,
+                         guint   b)
+{
+  ThunarSearchHit tmp;
+
+  tmp = g_array_index (heap, ThunarSearchHit, a);
+  g_array_index (heap, ThunarSearchHit, a) = g_array_index (heap, ThunarSearchHit, b);
+  g_array_index (heap, ThunarSearchHit, b) = tmp;
+}
+
+
+
+static void
+_thunar_search_rank (ThunarSearchContext *context,
+                     GFile               *file,
+                     gint                 score)
+{
+  GArray         *heap = context->top_hits;
+  ThunarSearchHit hit;
+  guint           n, parent, child;
+
+  if (!_thunar_search_would_rank (context, score))
+    return;
+
+  hit.file = g_object_ref (file);
+  hit.score = score;
+  context->top_hits_changed = TRUE;
+
+  if (heap->len < FUZZY_SEARCH_MAX_RESULTS)
+    {
+      /* sift the new hit up */
+      g_array_append_val (heap, hit);
+      for (n = heap->len - 1; n > 0; n = parent)
+        {
+          parent = (n - 1) / 2;
+          if (g_array_index (heap, ThunarSearchHit, parent).score <= g_array_index (heap, ThunarSearchHit, n).score)
+            break;
+          _thunar_search_hit_swap (heap, parent, n);
+        }
+    }
+  else
+    {
+      /* drop the worst hit and sift the new one down */
+      g_object_unref (g_array_index (heap, ThunarSearchHit, 0).file);
+      g_array_index (heap, ThunarSearchHit, 0) = hit;
+      for (n = 0;; n = child)
+        {
+          child = 2 * n + 1;
+          if (child >= heap->len)
+            break;
+          if (child + 1 < heap->len && g_array_index (heap, ThunarSearchHit, child + 1).score < g_array_index (heap, ThunarSearchHit, child).score)
+            child++;
+          if (g_array_index (heap, ThunarSearchHit, n).score <= g_array_index (heap, ThunarSearchHit, child).score)
+            break;
+          _thunar_search_hit_swap (heap, n, child);
+        }
+    }
+}
+
+
+
+static void
+_thunar_search_hand_over (ThunarSearchContext *context,
+                          GList               *files_found,
+                          GList               *files_outranked)
+{
+  g_mutex_lock (&context->handoff_mutex);
+
+  if (files_outranked != NULL)
+    thunar_standard_view_model_remove_search_files (context->model, files_outranked);
+
+  /* the model takes over the files, but not the list */
+  if (files_found != NULL)
+    thunar_standard_view_model_add_search_files (context->model, files_found);
+
+  g_mutex_unlock (&context->handoff_mutex);
+}
+
+
+
+static gboolean
+_thunar_search_file_contents (ThunarSearchContext *context,
+                              GFile               *file)
+{
+  GCancellable     *cancellable;
+  GFileInputStream *stream;
+  gchar            *buffer;
+  gsize             overlap;
+  gsize             length = 0;
+  gssize            n_read;
+  guint64           found_terms = 0;
+  gboolean          matched = FALSE;
+  gboolean          first_chunk = TRUE;
+
+  cancellable = exo_job_get_cancellable (EXO_JOB (context->job));
+  stream = g_file_read (file, cancellable, NULL);
+  if (stream == NULL)
+    return FALSE;
+
+  overlap = thunar_search_matcher_get_overlap (context->matcher);
+  buffer = g_malloc (overlap + CONTENT_SEARCH_CHUNK_SIZE);
+
+  /* plain reads in small chunks rather than mapping the file, so that
+   * a cancelled search is noticed after a chunk at the latest */
+  while (!matched && !g_cancellable_is_cancelled (cancellable))
+    {
+      n_read = g_input_stream_read (G_INPUT_STREAM (stream), buffer + length,
+                                    CONTENT_SEARCH_CHUNK_SIZE, cancellable, NULL);
+      if (n_read <= 0)
+        break;
+
+      if (first_chunk && memchr (buffer, '\0', MIN ((gsize) n_read, CONTENT_SEARCH_BINARY_PROBE_SIZE)) != NULL)
+        break;
+      first_chunk = FALSE;
+
+      length += n_read;
+      matched = thunar_search_matcher_match_contents (context->matcher, buffer, length, &found_terms);
+
+      /* keep the tail, a term might continue in the next chunk */
+      if (length > overlap)
+        {
+          memmove (buffer, buffer + length - overlap, overlap);
+          length = overlap;
+        }
+    }
+
+  g_free (buffer);
+  g_object_unref (stream);
+
+  return matched && !g_cancellable_is_cancelled (cancellable);
+}
+
+
+
+static void
+_thunar_search_content_worker (gpointer data,
+                               gpointer user_data)
+{
+  ThunarSearchContext *context = user_data;
+  GFile               *file = data;
+  ThunarFile          *thunar_file;
+  GList               *files;
+
+  /* the queue is drained quickly once the search is cancelled */
+  if (!exo_job_is_cancelled (EXO_JOB (context->job)) && _thunar_search_file_contents (context, file))
+    {
+      if (thunar_search_matcher_is_fuzzy (context->matcher))
+        {
+          /* compete for the limited results like the name matches */
+          g_mutex_lock (&context->mutex);
+          _thunar_search_rank (context, file, FUZZY_SEARCH_CONTENT_SCORE);
+          g_mutex_unlock (&context->mutex);
+        }
+      else
+        {
+          /* hand over every hit right away, like each folder's name matches */
+          thunar_file = thunar_file_get (file, NULL);
+          if (thunar_file != NULL)
+            {
+              files = g_list_prepend (NULL, thunar_file);
+              _thunar_search_hand_over (context, files, NULL);
+              g_list_free (files);
+            }
+        }
+    }
+
+  g_object_unref (file);
+}
+
+
+
+static void
+_thunar_search_flush_top_hits (ThunarSearchContext *context)
+{
+  GArray         *heap = context->top_hits;
+  GHashTable     *ranked;
+  GHashTableIter  iter;
+  GList          *files_found = NULL;
+  GList          *files_outranked = NULL;
+  ThunarFile     *file;
+  gpointer        key;
+
+  context->last_flush_time = g_get_monotonic_time ();
+
+  g_mutex_lock (&context->mutex);
+
+  if (!context->top_hits_changed)
+    {
+      g_mutex_unlock (&context->mutex);
+      return;
+    }
+  context->top_hits_changed = FALSE;
+
+  /* hand over the hits which are not shown yet */
+  ranked = g_hash_table_new (g_direct_hash, NULL);
+  for (guint n = 0; n < heap->len; n++)
+    {
+      key = g_array_index (heap, ThunarSearchHit, n).file;
+      g_hash_table_add (ranked, key);
+      if (g_hash_table_contains (context->shown_hits, key))
+        continue;
+
+      file = thunar_file_get (key, NULL);
+      if (file != NULL)
+        {
+          files_found = g_list_prepend (files_found, file);
+          g_hash_table_add (context->shown_hits, g_object_ref (key));
+        }
+    }
+
+  g_mutex_unlock (&context->mutex);
+
+  /* and take back the shown ones which got outranked since */
+  g_hash_table_iter_init (&iter, context->shown_hits);
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+      if (g_hash_table_contains (ranked, key))
+        continue;
+
+      file = thunar_file_get (key, NULL);
+      if (file != NULL)
+        files_outranked = g_list_prepend (files_outranked, file);
+      g_hash_table_iter_remove (&iter);
+    }
+  g_hash_table_destroy (ranked);
+
+  if (exo_job_is_cancelled (EXO_JOB (context->job)))
+    {
+      thunar_g_list_free_full (files_found);
+      thunar_g_list_free_full (files_outranked);
+      return;
+    }
+
+  _thunar_search_hand_over (context, files_found, files_outranked);
+  thunar_g_list_free_full (files_outranked);
+  g_list_free (files_found);
+}
+
+
+
 static void
-_thunar_search_folder (ThunarStandardViewModel           *model,
-                       ThunarJob                         *job,
-                       gchar                             *uri,
-                       gchar                            **search_query_c_terms,
-                       enum ThunarStandardViewModelSearch search_type,
-                       gboolean                           show_hidden)
+_thunar_search_folder (ThunarSearchContext *context,
+                       GFile               *directory,
+                       guint                depth)
 {
   GCancellable    *cancellable;
   GFileEnumerator *enumerator;
-  GFile           *directory;
   GList           *files_found = NULL; /* contains the matching files in this folder only */
-  const gchar *namespace;
-  const gchar *display_name;
-  gchar       *display_name_c; /* converted to ignore case */
+  const gchar     *namespace;
+  gboolean         is_recent;
+  gboolean         fuzzy;
 
-  cancellable = exo_job_get_cancellable (EXO_JOB (job));
-  directory = g_file_new_for_uri (uri);
-  namespace = G_FILE_ATTRIBUTE_STANDARD_TYPE "," G_FILE_ATTRIBUTE_STANDARD_TARGET_URI "," G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME "," G_FILE_ATTRIBUTE_STANDARD_IS_BACKUP "," G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN "," G_FILE_ATTRIBUTE_STANDARD_NAME ", recent::*";
+  cancellable = exo_job_get_cancellable (EXO_JOB (context->job));
+  is_recent = g_file_has_uri_scheme (directory, "recent");
+  fuzzy = thunar_search_matcher_is_fuzzy (context->matcher);
+  namespace = G_FILE_ATTRIBUTE_STANDARD_TYPE "," G_FILE_ATTRIBUTE_STANDARD_TARGET_URI "," G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME "," G_FILE_ATTRIBUTE_STANDARD_IS_BACKUP "," G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN "," G_FILE_ATTRIBUTE_STANDARD_NAME "," G_FILE_ATTRIBUTE_STANDARD_SIZE "," THUNAR_PRUNE_RULES_ATTRIBUTES "," THUNAR_SEARCH_MATCHER_ATTRIBUTES ", recent::*";
 
   /* The directory enumerator MUST NOT follow symlinks itself, meaning that any symlinks that
    * g_file_enumerator_next_file() emits are the actual symlink entries. This prevents one
@@ -1532,24 +1982,26 @@ _thunar_search_folder (ThunarStandardViewModel           *model,
    * which allows them to appear in the search results. */
   enumerator = g_file_enumerate_children (directory, namespace, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, cancellable, NULL);
   if (enumerator == NULL)
-    {
-      g_object_unref (directory);
-      return;
-    }
+    return;
 
   /* go through every file in the folder and check if it matches */
-  while (exo_job_is_cancelled (EXO_JOB (job)) == FALSE)
+  while (exo_job_is_cancelled (EXO_JOB (context->job)) == FALSE)
     {
-      GFile     *file;
+      GFile     *file = NULL;
       GFileInfo *info;
       GFileType  type;
+      gboolean   matched;
+      gboolean   descend;
+      gboolean   scan_contents;
+      gboolean   accepted;
+      gint       score;
 
-      /* get GFile and GFileInfo */
+      /* get GFileInfo, the GFile is only created once it is needed */
       info = g_file_enumerator_next_file (enumerator, cancellable, NULL);
       if (G_UNLIKELY (info == NULL))
         break;
 
-      if (g_file_has_uri_scheme (directory, "recent"))
+      if (is_recent)
         {
           file = g_file_new_for_uri (g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_STANDARD_TARGET_URI));
           g_object_unref (info);
@@ -1560,56 +2012,87 @@ _thunar_search_folder (ThunarStandardViewModel           *model,
               break;
             }
         }
-      else
-        file = g_file_get_child (directory, g_file_info_get_name (info));
 
       /* respect last-show-hidden */
-      if (show_hidden == FALSE)
+      if (context->show_hidden == FALSE)
         {
           /* same logic as thunar_file_is_hidden() */
           if (g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN)
               || g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_STANDARD_IS_BACKUP))
             {
-              g_object_unref (file);
+              g_clear_object (&file);
               g_object_unref (info);
               continue;
             }
         }
 
       type = g_file_info_get_file_type (info);
+      descend = (type == G_FILE_TYPE_DIRECTORY && context->search_type == THUNAR_STANDARD_VIEW_MODEL_SEARCH_RECURSIVE);
 
-      /* handle directories */
-      if (type == G_FILE_TYPE_DIRECTORY && search_type == THUNAR_STANDARD_VIEW_MODEL_SEARCH_RECURSIVE)
+      /* check the prune rules before the folder is opened */
+      if (descend && thunar_prune_rules_match (context->prune_rules, info, depth + 1, context->toplevel_device))
+        {
+          context->n_pruned++;
+          descend = FALSE;
+        }
+
+      /* attribute predicates like "size:>100M" are checked first, a
+       * rejected entry never gets a GFile or ThunarFile */
+      accepted = thunar_search_matcher_match_info (context->matcher, info);
+
+      /* search for all substrings in the display name, and for fuzzy
+       * searches drop hits which could not make it into the results */
+      score = accepted ? thunar_search_matcher_score (context->matcher, g_file_info_get_display_name (info)) : -1;
+      matched = score >= 0;
+      if (matched && fuzzy)
         {
-          gchar *file_uri = g_file_get_uri (file);
-          _thunar_search_folder (model, job, file_uri, search_query_c_terms, search_type, show_hidden);
-          g_free (file_uri);
+          g_mutex_lock (&context->mutex);
+          matched = _thunar_search_would_rank (context, score);
+          g_mutex_unlock (&context->mutex);
         }
 
-      /* prepare entry display name */
-      display_name = g_file_info_get_display_name (info);
-      display_name_c = thunar_g_utf8_normalize_for_search (display_name, TRUE, TRUE);
+      /* files whose name already matched do not need to be read */
+      scan_contents = (context->content_pool != NULL && accepted && score < 0 && type == G_FILE_TYPE_REGULAR
+                       && g_file_info_get_size (info) <= CONTENT_SEARCH_MAX_FILE_SIZE);
 
-      /* search for all substrings */
-      if (thunar_util_search_terms_match (search_query_c_terms, display_name_c))
+      if (file == NULL && (matched || descend || scan_contents))
+        file = g_file_get_child (directory, g_file_info_get_name (info));
+
+      if (scan_contents)
+        g_thread_pool_push (context->content_pool, g_object_ref (file), NULL);
+
+      /* handle directories */
+      if (descend)
+        _thunar_search_folder (context, file, depth + 1);
+
+      if (matched && fuzzy)
+        {
+          g_mutex_lock (&context->mutex);
+          _thunar_search_rank (context, file, score);
+          g_mutex_unlock (&context->mutex);
+        }
+      else if (matched)
         files_found = g_list_prepend (files_found, thunar_file_get (file, NULL));
 
       /* free memory */
-      g_free (display_name_c);
-      g_object_unref (file);
+      g_clear_object (&file);
       g_object_unref (info);
     }
 
   g_object_unref (enumerator);
-  g_object_unref (directory);
 
-  if (exo_job_is_cancelled (EXO_JOB (job)))
+  if (exo_job_is_cancelled (EXO_JOB (context->job)))
     {
-      g_list_free (files_found);
+      thunar_g_list_free_full (files_found);
       return;
     }
 
-  thunar_standard_view_model_add_search_files (model, files_found);
+  _thunar_search_hand_over (context, files_found, NULL);
+  g_list_free (files_found);
+
+  /* show the best ranked hits so far every now and then */
+  if (fuzzy && g_get_monotonic_time () - context->last_flush_time >= FUZZY_SEARCH_FLUSH_INTERVAL)
+    _thunar_search_flush_top_hits (context);
 }
 
 
@@ -1619,41 +2102,86 @@ _thunar_job_search_directory (ThunarJob *job,
                               GArray    *param_values,
                               GError   **error)
 {
-  ThunarStandardViewModel           *model;
-  ThunarFile                        *directory;
-  const char                        *search_query_c;
-  gchar                            **search_query_c_terms;
-  gboolean                           is_source_device_local;
-  ThunarRecursiveSearchMode          mode;
-  gboolean                           show_hidden;
-  enum ThunarStandardViewModelSearch search_type;
-  gchar                             *directory_uri;
-
-  search_type = THUNAR_STANDARD_VIEW_MODEL_SEARCH_NON_RECURSIVE;
+  ThunarSearchContext       context;
+  ThunarSearchMatcher      *matcher;
+  ThunarFile               *directory;
+  GFileInfo                *info;
+  const char               *search_query;
+  gboolean                  is_source_device_local;
+  ThunarRecursiveSearchMode mode;
+  gboolean                  fuzzy;
+  gboolean                  search_contents;
 
   if (exo_job_set_error_if_cancelled (EXO_JOB (job), error))
     return FALSE;
 
-  model = g_value_get_object (&g_array_index (param_values, GValue, 0));
-  search_query_c = g_value_get_string (&g_array_index (param_values, GValue, 1));
+  context.job = job;
+  context.model = g_value_get_object (&g_array_index (param_values, GValue, 0));
+  search_query = g_value_get_string (&g_array_index (param_values, GValue, 1));
   directory = g_value_get_object (&g_array_index (param_values, GValue, 2));
   mode = g_value_get_enum (&g_array_index (param_values, GValue, 3));
-  show_hidden = g_value_get_boolean (&g_array_index (param_values, GValue, 4));
-
-  search_query_c_terms = thunar_util_split_search_query (search_query_c, error);
-  if (search_query_c_terms == NULL)
-    return FALSE;
-
+  context.show_hidden = g_value_get_boolean (&g_array_index (param_values, GValue, 4));
+  fuzzy = g_value_get_boolean (&g_array_index (param_values, GValue, 5));
+  search_contents = g_value_get_boolean (&g_array_index (param_values, GValue, 6));
+  context.prune_rules = g_value_get_boxed (&g_array_index (param_values, GValue, 7));
+
+  /* compile the query once for the whole search */
+  matcher = thunar_search_matcher_new (search_query, fuzzy);
+  if (matcher == NULL)
+    {
+      g_set_error (error, G_CONVERT_ERROR, G_CONVERT_ERROR_ILLEGAL_SEQUENCE,
+                   _("Invalid search query"));
+      return FALSE;
+    }
+  context.matcher = matcher;
+  g_mutex_init (&context.mutex);
+  g_mutex_init (&context.handoff_mutex);
+  context.top_hits = g_array_sized_new (FALSE, FALSE, sizeof (ThunarSearchHit), FUZZY_SEARCH_MAX_RESULTS);
+  context.shown_hits = g_hash_table_new_full (g_direct_hash, NULL, g_object_unref, NULL);
+  context.top_hits_changed = FALSE;
+  context.last_flush_time = g_get_monotonic_time ();
+  context.content_pool = NULL;
+  if (search_contents)
+    context.content_pool = g_thread_pool_new (_thunar_search_content_worker, &context,
+                                              CLAMP (g_get_num_processors (), 1, CONTENT_SEARCH_MAX_THREADS),
+                                              FALSE, NULL);
+
+  context.search_type = THUNAR_STANDARD_VIEW_MODEL_SEARCH_NON_RECURSIVE;
   is_source_device_local = thunar_g_file_is_on_local_device (thunar_file_get_file (directory));
   if (mode == THUNAR_RECURSIVE_SEARCH_ALWAYS || (mode == THUNAR_RECURSIVE_SEARCH_LOCAL && is_source_device_local))
-    search_type = THUNAR_STANDARD_VIEW_MODEL_SEARCH_RECURSIVE;
+    context.search_type = THUNAR_STANDARD_VIEW_MODEL_SEARCH_RECURSIVE;
+
+  /* remember the filesystem the search started on */
+  context.toplevel_device = 0;
+  context.n_pruned = 0;
+  info = g_file_query_info (thunar_file_get_file (directory), G_FILE_ATTRIBUTE_UNIX_DEVICE,
+                            G_FILE_QUERY_INFO_NONE, exo_job_get_cancellable (EXO_JOB (job)), NULL);
+  if (info != NULL)
+    {
+      context.toplevel_device = thunar_prune_rules_get_device (info);
+      g_object_unref (info);
+    }
+
+  _thunar_search_folder (&context, thunar_file_get_file (directory), 0);
 
-  directory_uri = thunar_file_dup_uri (directory);
+  /* wait for the content scans still in flight */
+  if (context.content_pool != NULL)
+    g_thread_pool_free (context.content_pool, FALSE, TRUE);
 
-  _thunar_search_folder (model, job, directory_uri, search_query_c_terms, search_type, show_hidden);
+  /* the ranking is only final once every folder and file was searched */
+  if (fuzzy)
+    _thunar_search_flush_top_hits (&context);
 
-  g_free (directory_uri);
-  g_strfreev (search_query_c_terms);
+  /* hand how much was left out to the model, which reads it once the job finished */
+  g_value_set_uint (&g_array_index (param_values, GValue, 8), context.n_pruned);
+
+  for (guint n = 0; n < context.top_hits->len; n++)
+    g_object_unref (g_array_index (context.top_hits, ThunarSearchHit, n).file);
+  g_array_free (context.top_hits, TRUE);
+  g_hash_table_destroy (context.shown_hits);
+  g_mutex_clear (&context.mutex);
+  g_mutex_clear (&context.handoff_mutex);
+  thunar_search_matcher_free (matcher);
 
   return TRUE;
 }
@@ -1668,20 +2196,35 @@ thunar_io_jobs_search_directory (ThunarStandardViewModel *model,
   ThunarPreferences        *preferences;
   ThunarRecursiveSearchMode mode;
   gboolean                  show_hidden;
+  gboolean                  fuzzy;
+  gboolean                  search_contents;
+  ThunarPruneRules         *prune_rules;
+  ThunarJob                *job;
 
   preferences = thunar_preferences_get ();
 
   /* grab a reference of preferences determine the current recursive search mode */
   g_object_get (G_OBJECT (preferences), "misc-recursive-search", &mode, NULL);
   g_object_get (G_OBJECT (preferences), "last-show-hidden", &show_hidden, NULL);
+  g_object_get (G_OBJECT (preferences), "misc-fuzzy-search", &fuzzy, NULL);
+  g_object_get (G_OBJECT (preferences), "misc-search-file-contents", &search_contents, NULL);
 
   g_object_unref (preferences);
-  return thunar_simple_job_new (_thunar_job_search_directory, 5,
-                                THUNAR_TYPE_STANDARD_VIEW_MODEL, model,
-                                G_TYPE_STRING, search_query,
-                                THUNAR_TYPE_FILE, directory,
-                                G_TYPE_ENUM, mode,
-                                G_TYPE_BOOLEAN, show_hidden);
+
+  prune_rules = thunar_prune_rules_new_from_preferences ();
+  job = thunar_simple_job_new (_thunar_job_search_directory, 9,
+                               THUNAR_TYPE_STANDARD_VIEW_MODEL, model,
+                               G_TYPE_STRING, search_query,
+                               THUNAR_TYPE_FILE, directory,
+                               G_TYPE_ENUM, mode,
+                               G_TYPE_BOOLEAN, show_hidden,
+                               G_TYPE_BOOLEAN, fuzzy,
+                               G_TYPE_BOOLEAN, search_contents,
+                               THUNAR_TYPE_PRUNE_RULES, prune_rules,
+                               G_TYPE_UINT, 0);
+  thunar_prune_rules_unref (prune_rules);
+
+  return job;
 }
 
 
@@ -1917,6 +2460,7 @@ _thunar_job_load_statusbar_text (ThunarJob *job,
   gchar              *temp_string;
   GList              *text_list = NULL;
   guint               status_bar_active_info;
+  guint               n_pruned;
   guint64             size;
 
   if (exo_job_set_error_if_cancelled (EXO_JOB (job), error))
@@ -1930,6 +2474,7 @@ _thunar_job_load_statusbar_text (ThunarJob *job,
   date_style = g_value_get_enum (&g_array_index (param_values, GValue, 5));
   date_custom_style = g_value_get_string (&g_array_index (param_values, GValue, 6));
   status_bar_active_info = g_value_get_uint (&g_array_index (param_values, GValue, 7));
+  n_pruned = g_value_get_uint (&g_array_index (param_values, GValue, 8));
 
   text_for_files = thunar_util_get_statusbar_text_for_files (thunar_files,
                                                              show_hidden,
@@ -1958,6 +2503,16 @@ _thunar_job_load_statusbar_text (ThunarJob *job,
           text_list = g_list_append (text_list, temp_string);
           g_free (size_string);
         }
+
+      /* the last search did not look into everything */
+      if (n_pruned > 0)
+        {
+          temp_string = g_strdup_printf (ngettext ("%u folder skipped by the prune rules",
+                                                   "%u folders skipped by the prune rules",
+                                                   n_pruned),
+                                         n_pruned);
+          text_list = g_list_append (text_list, temp_string);
+        }
     }
 
   temp_string = thunar_util_strjoin_list (text_list, "  |  ");
@@ -2000,7 +2555,7 @@ thunar_io_jobs_load_statusbar_text_for_folder (ThunarStandardView *standard_view
       return NULL;
     }
 
-  ThunarJob *job = thunar_simple_job_new (_thunar_job_load_statusbar_text, 8,
+  ThunarJob *job = thunar_simple_job_new (_thunar_job_load_statusbar_text, 9,
                                           THUNAR_TYPE_STANDARD_VIEW, g_object_ref (standard_view),
                                           THUNAR_TYPE_FILE, g_object_ref (file),
                                           THUNAR_TYPE_G_FILE_HASH_TABLE, files,
@@ -2008,7 +2563,8 @@ thunar_io_jobs_load_statusbar_text_for_folder (ThunarStandardView *standard_view
                                           G_TYPE_BOOLEAN, show_file_size_binary_format,
                                           THUNAR_TYPE_DATE_STYLE, date_style,
                                           G_TYPE_STRING, date_custom_style,
-                                          G_TYPE_UINT, status_bar_active_info);
+                                          G_TYPE_UINT, status_bar_active_info,
+                                          G_TYPE_UINT, thunar_standard_view_get_search_n_pruned (standard_view));
   g_free (date_custom_style);
 
   g_signal_connect_swapped (job, "finished", G_CALLBACK (g_object_unref), file);
@@ -2035,7 +2591,7 @@ thunar_io_jobs_load_statusbar_text_for_selection (ThunarStandardView *standard_v
                 "misc-file-size-binary", &show_file_size_binary_format,
                 "misc-status-bar-active-info", &status_bar_active_info, NULL);
 
-  ThunarJob *job = thunar_simple_job_new (_thunar_job_load_statusbar_text, 8,
+  ThunarJob *job = thunar_simple_job_new (_thunar_job_load_statusbar_text, 9,
                                           THUNAR_TYPE_STANDARD_VIEW, g_object_ref (standard_view),
                                           THUNAR_TYPE_FILE, NULL,
                                           THUNAR_TYPE_G_FILE_HASH_TABLE, selected_files,
@@ -2043,7 +2599,8 @@ thunar_io_jobs_load_statusbar_text_for_selection (ThunarStandardView *standard_v
                                           G_TYPE_BOOLEAN, show_file_size_binary_format,
                                           THUNAR_TYPE_DATE_STYLE, date_style,
                                           G_TYPE_STRING, date_custom_style,
-                                          G_TYPE_UINT, status_bar_active_info);
+                                          G_TYPE_UINT, status_bar_active_info,
+                                          G_TYPE_UINT, 0);
   g_free (date_custom_style);
 
   g_signal_connect_swapped (job, "finished", G_CALLBACK (g_object_unref), standard_view);
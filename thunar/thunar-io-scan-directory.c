@@ -22,8 +22,18 @@
 #include "config.h"
 #endif
 
+#ifdef HAVE_STATX
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include "thunar/thunar-gio-extensions.h"
 #include "thunar/thunar-io-scan-directory.h"
+#include "thunar/thunar-io-uring.h"
 #include "thunar/thunar-job.h"
 #include "thunar/thunar-private.h"
 
@@ -31,6 +41,167 @@
 #include <gio/gio.h>
 
 
+
+#ifdef HAVE_STATX
+/* Lists a local folder like thunar_io_scan_directory() does, but with
+ * readdir() instead of a GFileEnumerator which stats every child. Most
+ * filesystems store the type in the directory entries, the children
+ * without one are stat'ed in io_uring batches if @ring is given */
+static GList *
+thunar_io_scan_directory_native (ThunarJob          *job,
+                                 GFile              *file,
+                                 GFileQueryInfoFlags flags,
+                                 gboolean            recursively,
+                                 guint              *n_files_max,
+                                 ThunarIoUring      *ring,
+                                 GError            **error)
+{
+  struct dirent *entry;
+  struct statx  *statxbufs;
+  const gchar  **stat_names;
+  GByteArray    *types;
+  GPtrArray     *names;
+  GError        *err = NULL;
+  GFile         *child_file;
+  GList         *child_files;
+  GList         *files = NULL;
+  gboolean       follow_symlinks = (flags & G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS) == 0;
+  guint8         type;
+  guint         *stat_index;
+  guint          n_stats = 0;
+  guint          n;
+  gchar         *display_name;
+  gint          *results;
+  gint           saved_errno;
+  DIR           *dir;
+  gint           fd;
+
+  fd = open (g_file_peek_path (file), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  dir = (fd >= 0) ? fdopendir (fd) : NULL;
+  if (dir == NULL)
+    {
+      saved_errno = errno;
+      if (fd >= 0)
+        close (fd);
+
+      display_name = g_filename_display_name (g_file_peek_path (file));
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (saved_errno),
+                   _("Error opening directory \"%s\": %s"), display_name, g_strerror (saved_errno));
+      g_free (display_name);
+      return NULL;
+    }
+
+  names = g_ptr_array_new_with_free_func (g_free);
+  types = g_byte_array_new ();
+
+  for (errno = 0; (entry = readdir (dir)) != NULL; errno = 0)
+    {
+      if (strcmp (entry->d_name, ".") == 0 || strcmp (entry->d_name, "..") == 0)
+        continue;
+
+      /* symlinks have the type of their target, unless not following them */
+      type = entry->d_type;
+      if (type == DT_LNK && follow_symlinks)
+        type = DT_UNKNOWN;
+
+      g_ptr_array_add (names, g_strdup (entry->d_name));
+      g_byte_array_append (types, &type, 1);
+      n_stats += (type == DT_UNKNOWN);
+    }
+
+  if (errno != 0)
+    {
+      saved_errno = errno;
+      display_name = g_filename_display_name (g_file_peek_path (file));
+      g_set_error (&err, G_IO_ERROR, g_io_error_from_errno (saved_errno),
+                   _("Error reading directory \"%s\": %s"), display_name, g_strerror (saved_errno));
+      g_free (display_name);
+    }
+
+  if (err == NULL && n_stats > 0)
+    {
+      stat_names = g_new (const gchar *, n_stats);
+      stat_index = g_new (guint, n_stats);
+      statxbufs = g_new (struct statx, n_stats);
+      results = g_new (gint, n_stats);
+
+      for (n = 0, n_stats = 0; n < names->len; n++)
+        if (types->data[n] == DT_UNKNOWN)
+          {
+            stat_names[n_stats] = g_ptr_array_index (names, n);
+            stat_index[n_stats++] = n;
+          }
+
+      if (ring == NULL
+          || !thunar_io_uring_statx (ring, dirfd (dir), stat_names, n_stats,
+                                     follow_symlinks ? 0 : AT_SYMLINK_NOFOLLOW,
+                                     STATX_TYPE, statxbufs, results))
+        {
+          for (n = 0; n < n_stats; n++)
+            results[n] = statx (dirfd (dir), stat_names[n], follow_symlinks ? 0 : AT_SYMLINK_NOFOLLOW,
+                                STATX_TYPE, &statxbufs[n]) == 0 ? 0 : -errno;
+        }
+
+      /* broken symlinks and files deleted meanwhile stay unknown */
+      for (n = 0; n < n_stats; n++)
+        if (results[n] == 0)
+          types->data[stat_index[n]] = IFTODT (statxbufs[n].stx_mode);
+
+      g_free (stat_names);
+      g_free (stat_index);
+      g_free (statxbufs);
+      g_free (results);
+    }
+
+  closedir (dir);
+
+  for (n = 0; err == NULL && n < names->len && (job == NULL || !exo_job_is_cancelled (EXO_JOB (job))); n++)
+    {
+      if (G_UNLIKELY (n_files_max != NULL))
+        {
+          if (*n_files_max == 0)
+            break;
+          else
+            (*n_files_max)--;
+        }
+
+      child_file = g_file_get_child (file, g_ptr_array_index (names, n));
+      files = thunar_g_list_prepend_deep (files, child_file);
+
+      /* children go before their folder, see thunar_io_scan_directory() */
+      if (recursively && types->data[n] == DT_DIR)
+        {
+          child_files = thunar_io_scan_directory_native (job, child_file, flags, recursively,
+                                                         n_files_max, ring, &err);
+          files = g_list_concat (child_files, files);
+        }
+
+      g_object_unref (child_file);
+    }
+
+  g_ptr_array_unref (names);
+  g_byte_array_unref (types);
+
+  if (G_UNLIKELY (err != NULL))
+    {
+      g_propagate_error (error, err);
+      thunar_g_list_free_full (files);
+      return NULL;
+    }
+  else if (job != NULL && exo_job_set_error_if_cancelled (EXO_JOB (job), &err))
+    {
+      g_propagate_error (error, err);
+      thunar_g_list_free_full (files);
+      return NULL;
+    }
+
+  return files;
+}
+#endif
+
+
+
+
 /**
  * thunar_io_scan_directory:
  * @job                 : a #ThunarJob instance
@@ -68,6 +239,9 @@ thunar_io_scan_directory (ThunarJob          *job,
   ThunarFile   *thunar_file;
   gboolean      is_mounted;
   GCancellable *cancellable = NULL;
+#ifdef HAVE_STATX
+  ThunarIoUring *ring;
+#endif
 
   _thunar_return_val_if_fail (G_IS_FILE (file), NULL);
   _thunar_return_val_if_fail (error == NULL || *error == NULL, NULL);
@@ -102,6 +276,17 @@ thunar_io_scan_directory (ThunarJob          *job,
   if (type != G_FILE_TYPE_DIRECTORY)
     return NULL;
 
+#ifdef HAVE_STATX
+  /* lists of local files don't need the file infos */
+  if (!return_thunar_files && g_file_is_native (file))
+    {
+      ring = thunar_io_uring_new ();
+      files = thunar_io_scan_directory_native (job, file, flags, recursively, n_files_max, ring, error);
+      thunar_io_uring_free (ring);
+      return files;
+    }
+#endif
+
   /* determine the namespace */
   if (return_thunar_files)
   namespace = THUNARX_FILE_INFO_NAMESPACE;
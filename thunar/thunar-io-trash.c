@@ -0,0 +1,691 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * Copyright (c) 2024 The Thunar development team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Moves local files to the trash in batches, following the freedesktop.org
+ * trash specification like g_file_trash() does. The .trashinfo files of a
+ * batch are written and synced first, with one sync of info/ for all of
+ * them, then the files are renamed into the trash all at once, through
+ * io_uring if possible. A rename never replaces a file in the trash.
+ *
+ * Only trash folders which exist already are used: the home trash, and
+ * $topdir/.Trash-$uid of other file systems if there is no shared
+ * $topdir/.Trash. Everything else is left to g_file_trash().
+ *
+ * Emptying the trash moves info/ and files/ of the local trash folders
+ * aside, so the trash is empty at once. The delete job then deletes them
+ * like any other folder. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "thunar/thunar-io-trash.h"
+#include "thunar/thunar-io-uring.h"
+#include "thunar/thunar-private.h"
+
+#include <glib/gstdio.h>
+#ifdef HAVE_GIO_UNIX
+#include <gio/gunixmounts.h>
+#endif
+
+
+
+/* number of files written to the trash between two syncs */
+#define TRASH_BATCH_SIZE (1024)
+
+/* from linux/fs.h, for the io_uring if the C library lacks renameat2() */
+#ifndef RENAME_NOREPLACE
+#define RENAME_NOREPLACE (1 << 0)
+#endif
+
+/* prefix of the folders an emptied trash is moved to until it is deleted */
+#define EXPUNGED_PREFIX "thunar-expunged-"
+
+
+
+typedef struct
+{
+  gint64     device;
+  gchar     *path;     /* of the trash folder, %NULL if it cannot be used */
+  gchar     *topdir;   /* the original paths are relative to it, %NULL for the home trash */
+  gint       files_fd;
+  gint       info_fd;
+  GArray    *indices;  /* of the files to trash here, in the file list */
+  GPtrArray *files;
+} ThunarIoTrashDir;
+
+
+
+static void
+thunar_io_trash_dir_free (gpointer data)
+{
+  ThunarIoTrashDir *dir = data;
+
+  if (dir->files_fd >= 0)
+    close (dir->files_fd);
+  if (dir->info_fd >= 0)
+    close (dir->info_fd);
+  g_array_free (dir->indices, TRUE);
+  g_ptr_array_free (dir->files, TRUE);
+  g_free (dir->path);
+  g_free (dir->topdir);
+  g_slice_free (ThunarIoTrashDir, dir);
+}
+
+
+
+static ThunarIoTrashDir *
+thunar_io_trash_dir_new (gint64       device,
+                         const gchar *path,
+                         const gchar *topdir)
+{
+  ThunarIoTrashDir *dir;
+  struct stat       statbuf;
+  gint              fd;
+
+  dir = g_slice_new0 (ThunarIoTrashDir);
+  dir->device = device;
+  dir->files_fd = -1;
+  dir->info_fd = -1;
+  dir->indices = g_array_new (FALSE, FALSE, sizeof (guint));
+  dir->files = g_ptr_array_new ();
+
+  if (path == NULL)
+    return dir;
+
+  /* the trash folder must be ours and not a link */
+  fd = open (path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (fd < 0)
+    return dir;
+
+  if (fstat (fd, &statbuf) == 0 && statbuf.st_uid == getuid () && (gint64) statbuf.st_dev == device)
+    {
+      /* files/ and info/ are created on demand by the other implementations */
+      mkdirat (fd, "files", 0700);
+      mkdirat (fd, "info", 0700);
+
+      dir->files_fd = openat (fd, "files", O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+      dir->info_fd = openat (fd, "info", O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    }
+  close (fd);
+
+  if (dir->files_fd >= 0 && dir->info_fd >= 0)
+    {
+      dir->path = g_strdup (path);
+      dir->topdir = g_strdup (topdir);
+    }
+
+  return dir;
+}
+
+
+
+/* Returns the top folder of the file system of the file at @path, or %NULL
+ * if @path is the top folder itself */
+static gchar *
+thunar_io_trash_find_topdir (const gchar *path,
+                             gint64       device)
+{
+  struct stat statbuf;
+  gchar      *topdir;
+  gchar      *parent;
+
+  topdir = g_path_get_dirname (path);
+  if (g_lstat (topdir, &statbuf) != 0 || (gint64) statbuf.st_dev != device)
+    {
+      g_free (topdir);
+      return NULL;
+    }
+
+  for (;;)
+    {
+      parent = g_path_get_dirname (topdir);
+      if (strcmp (parent, topdir) == 0 || g_lstat (parent, &statbuf) != 0 || (gint64) statbuf.st_dev != device)
+        {
+          g_free (parent);
+          return topdir;
+        }
+
+      g_free (topdir);
+      topdir = parent;
+    }
+}
+
+
+
+static ThunarIoTrashDir *
+thunar_io_trash_dir_for_device (GHashTable  *dirs,
+                                const gchar *path,
+                                gint64       device)
+{
+  ThunarIoTrashDir *dir;
+  gchar            *topdir;
+  gchar            *shared_path;
+  gchar            *trash_path = NULL;
+  gchar            *name;
+
+  dir = g_hash_table_lookup (dirs, &device);
+  if (dir != NULL)
+    return dir;
+
+  topdir = thunar_io_trash_find_topdir (path, device);
+  if (topdir != NULL)
+    {
+      /* the shared trash folder comes first, leave that to gio */
+      shared_path = g_build_filename (topdir, ".Trash", NULL);
+      if (!g_file_test (shared_path, G_FILE_TEST_EXISTS))
+        {
+          name = g_strdup_printf (".Trash-%u", (guint) getuid ());
+          trash_path = g_build_filename (topdir, name, NULL);
+          g_free (name);
+        }
+      g_free (shared_path);
+    }
+
+  dir = thunar_io_trash_dir_new (device, trash_path, topdir);
+  g_hash_table_insert (dirs, &dir->device, dir);
+
+  g_free (trash_path);
+  g_free (topdir);
+
+  return dir;
+}
+
+
+
+static void
+thunar_io_trash_remove_info (ThunarIoTrashDir *dir,
+                             const gchar      *trash_name)
+{
+  gchar *info_name;
+
+  info_name = g_strconcat (trash_name, ".trashinfo", NULL);
+  unlinkat (dir->info_fd, info_name, 0);
+  g_free (info_name);
+}
+
+
+
+/* Writes the .trashinfo file for @path and returns the name the file gets
+ * in the trash, or %NULL on failure */
+static gchar *
+thunar_io_trash_write_info (ThunarIoTrashDir *dir,
+                            const gchar      *path,
+                            const gchar      *deletion_date)
+{
+  const gchar *relative_path = path;
+  struct stat  statbuf;
+  gchar       *basename;
+  gchar       *trash_name;
+  gchar       *info_name;
+  gchar       *escaped;
+  gchar       *contents;
+  gsize        length;
+  gsize        written = 0;
+  gssize       n;
+  guint        i;
+  gint         fd = -1;
+
+  /* the original path is relative to the top folder, if not in the home trash */
+  if (dir->topdir != NULL)
+    {
+      relative_path = path + strlen (dir->topdir);
+      while (*relative_path == G_DIR_SEPARATOR)
+        relative_path++;
+    }
+
+  basename = g_path_get_basename (path);
+  trash_name = g_strdup (basename);
+
+  /* reserve a name which is neither in info/ nor in files/ */
+  for (i = 1; i < 1000; i++)
+    {
+      if (i > 1)
+        {
+          g_free (trash_name);
+          trash_name = g_strdup_printf ("%s.%u", basename, i);
+        }
+
+      if (fstatat (dir->files_fd, trash_name, &statbuf, AT_SYMLINK_NOFOLLOW) == 0)
+        continue;
+
+      info_name = g_strconcat (trash_name, ".trashinfo", NULL);
+      fd = openat (dir->info_fd, info_name, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+      g_free (info_name);
+
+      if (fd >= 0 || errno != EEXIST)
+        break;
+    }
+  g_free (basename);
+
+  if (fd < 0)
+    {
+      g_free (trash_name);
+      return NULL;
+    }
+
+  escaped = g_uri_escape_string (relative_path, "/", FALSE);
+  contents = g_strdup_printf ("[Trash Info]\nPath=%s\nDeletionDate=%s\n", escaped, deletion_date);
+  length = strlen (contents);
+  g_free (escaped);
+
+  while (written < length)
+    {
+      n = write (fd, contents + written, length - written);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        break;
+      written += n;
+    }
+  g_free (contents);
+
+  if (written == length && fdatasync (fd) != 0)
+    written = 0;
+
+  close (fd);
+
+  if (written < length)
+    {
+      thunar_io_trash_remove_info (dir, trash_name);
+      g_free (trash_name);
+      return NULL;
+    }
+
+  return trash_name;
+}
+
+
+
+/* Moves @path into the trash as @trash_name, never replacing a file
+ * which took that name. Returns 0 or a negative errno value */
+static gint
+thunar_io_trash_rename (ThunarIoTrashDir *dir,
+                        const gchar      *path,
+                        const gchar      *trash_name)
+{
+  struct stat statbuf;
+  gint        saved_errno;
+
+#ifdef HAVE_RENAMEAT2
+  /* the name was reserved with the info file, but another program
+   * could have put a file there in the meantime */
+  if (renameat2 (AT_FDCWD, path, dir->files_fd, trash_name, RENAME_NOREPLACE) == 0)
+    return 0;
+
+  /* not supported by every file system */
+  if (errno != EINVAL)
+    return -errno;
+#endif
+
+  if (lstat (path, &statbuf) != 0)
+    return -errno;
+
+  /* renameat() would replace such a file, a new link fails instead. Files
+   * which cannot be linked are left to gio */
+  if (!S_ISDIR (statbuf.st_mode))
+    {
+      if (linkat (AT_FDCWD, path, dir->files_fd, trash_name, 0) != 0)
+        return -errno;
+
+      if (unlink (path) != 0)
+        {
+          saved_errno = errno;
+          unlinkat (dir->files_fd, trash_name, 0);
+          return -saved_errno;
+        }
+
+      return 0;
+    }
+
+  /* folders cannot be linked, check the name right before moving them */
+  if (fstatat (dir->files_fd, trash_name, &statbuf, AT_SYMLINK_NOFOLLOW) == 0)
+    return -EEXIST;
+  if (errno != ENOENT)
+    return -errno;
+
+  return (renameat (AT_FDCWD, path, dir->files_fd, trash_name) == 0) ? 0 : -errno;
+}
+
+
+
+/* Moves @n_files files of @dir, starting at @first, to the trash */
+static guint
+thunar_io_trash_batch (ThunarIoTrashDir *dir,
+                       guint             first,
+                       guint             n_files,
+                       ThunarIoUring    *ring,
+                       GCancellable     *cancellable,
+                       gboolean         *trashed)
+{
+  const gchar **paths;
+  GDateTime    *now;
+  gchar       **trash_names;
+  gchar        *deletion_date;
+  guint        *indices;
+  guint         n_prepared = 0;
+  guint         n_trashed = 0;
+  guint         n;
+  gint         *results;
+
+  paths = g_new0 (const gchar *, n_files);
+  trash_names = g_new0 (gchar *, n_files + 1);
+  indices = g_new (guint, n_files);
+  results = g_new (gint, n_files);
+
+  /* all files of a batch get the same deletion date */
+  now = g_date_time_new_now_local ();
+  deletion_date = g_date_time_format (now, "%Y-%m-%dT%H:%M:%S");
+  g_date_time_unref (now);
+
+  /* the info files come first, so nothing is in the trash without one */
+  for (n = 0; n < n_files && !g_cancellable_is_cancelled (cancellable); n++)
+    {
+      paths[n_prepared] = g_file_peek_path (g_ptr_array_index (dir->files, first + n));
+      trash_names[n_prepared] = thunar_io_trash_write_info (dir, paths[n_prepared], deletion_date);
+      if (trash_names[n_prepared] != NULL)
+        indices[n_prepared++] = g_array_index (dir->indices, guint, first + n);
+    }
+  g_free (deletion_date);
+
+  /* one sync for the folder entries of all the info files of the batch */
+  if (n_prepared > 0 && fsync (dir->info_fd) != 0)
+    {
+      for (n = 0; n < n_prepared; n++)
+        thunar_io_trash_remove_info (dir, trash_names[n]);
+      n_prepared = 0;
+    }
+
+  /* move the files into the trash, all at once if possible */
+  if (ring == NULL || !thunar_io_uring_renameat (ring, AT_FDCWD, (const gchar *const *) paths, dir->files_fd,
+                                                 (const gchar *const *) trash_names, RENAME_NOREPLACE,
+                                                 n_prepared, results))
+    {
+      for (n = 0; n < n_prepared; n++)
+        results[n] = thunar_io_trash_rename (dir, paths[n], trash_names[n]);
+    }
+
+  for (n = 0; n < n_prepared; n++)
+    {
+      if (results[n] == -EINVAL)
+        results[n] = thunar_io_trash_rename (dir, paths[n], trash_names[n]);
+
+      if (results[n] == 0)
+        {
+          trashed[indices[n]] = TRUE;
+          n_trashed++;
+        }
+      else
+        {
+          /* gio gets another chance with the file */
+          thunar_io_trash_remove_info (dir, trash_names[n]);
+        }
+    }
+
+  /* one sync for the folder entries of the moved files */
+  if (n_trashed > 0)
+    fsync (dir->files_fd);
+
+  g_free (paths);
+  g_strfreev (trash_names);
+  g_free (indices);
+  g_free (results);
+
+  return n_trashed;
+}
+
+
+
+/**
+ * thunar_io_trash_files:
+ * @file_list   : a #GList of #GFile<!---->s.
+ * @cancellable : (nullable): a #GCancellable.
+ * @trashed     : return location for whether each file of @file_list
+ *                was moved to the trash.
+ *
+ * Moves the local files of @file_list to the trash in batches. The
+ * files which are not marked in @trashed are left to g_file_trash(),
+ * which also reports the errors.
+ *
+ * Return value: the number of files moved to the trash.
+ **/
+guint
+thunar_io_trash_files (GList        *file_list,
+                       GCancellable *cancellable,
+                       gboolean     *trashed)
+{
+  ThunarIoTrashDir *dir;
+  ThunarIoUring    *ring;
+  struct stat       statbuf;
+  GHashTableIter    iter;
+  const gchar      *path;
+  GHashTable       *dirs;
+  GList            *lp;
+  gchar            *home_trash;
+  guint             n_trashed = 0;
+  guint             n;
+  gsize             length;
+
+  _thunar_return_val_if_fail (trashed != NULL || file_list == NULL, 0);
+
+  dirs = g_hash_table_new_full (g_int64_hash, g_int64_equal, NULL, thunar_io_trash_dir_free);
+
+  /* files on the file system of the home folder go to the home trash */
+  home_trash = g_build_filename (g_get_user_data_dir (), "Trash", NULL);
+  if (g_mkdir_with_parents (home_trash, 0700) == 0 && g_stat (home_trash, &statbuf) == 0)
+    dir = thunar_io_trash_dir_new (statbuf.st_dev, home_trash, NULL);
+  else if (g_stat (g_get_home_dir (), &statbuf) == 0)
+    dir = thunar_io_trash_dir_new (statbuf.st_dev, NULL, NULL);
+  else
+    dir = NULL;
+  if (dir != NULL)
+    g_hash_table_insert (dirs, &dir->device, dir);
+  g_free (home_trash);
+
+  /* sort the files by trash folder */
+  for (lp = file_list, n = 0; lp != NULL; lp = lp->next, n++)
+    {
+      trashed[n] = FALSE;
+
+      if (!g_file_is_native (lp->data))
+        continue;
+
+      path = g_file_peek_path (lp->data);
+      if (g_lstat (path, &statbuf) != 0)
+        continue;
+
+      dir = thunar_io_trash_dir_for_device (dirs, path, statbuf.st_dev);
+      if (dir->path == NULL)
+        continue;
+
+      /* gio refuses to trash the trash itself */
+      length = strlen (dir->path);
+      if (strncmp (path, dir->path, length) == 0 && (path[length] == '\0' || path[length] == G_DIR_SEPARATOR))
+        continue;
+
+      g_array_append_val (dir->indices, n);
+      g_ptr_array_add (dir->files, lp->data);
+    }
+
+  ring = thunar_io_uring_new ();
+
+  g_hash_table_iter_init (&iter, dirs);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &dir))
+    {
+      for (n = 0; n < dir->files->len && !g_cancellable_is_cancelled (cancellable); n += TRASH_BATCH_SIZE)
+        n_trashed += thunar_io_trash_batch (dir, n, MIN (TRASH_BATCH_SIZE, dir->files->len - n), ring, cancellable, trashed);
+    }
+
+  thunar_io_uring_free (ring);
+  g_hash_table_destroy (dirs);
+
+  return n_trashed;
+}
+
+
+
+/* Moves info/ and files/ of the trash folder at @path aside and prepends
+ * what is to be deleted to @expunged. Returns %FALSE if the trash folder
+ * could not be emptied */
+static gboolean
+thunar_io_trash_expunge_dir (const gchar *path,
+                             GList      **expunged)
+{
+  struct dirent *entry;
+  struct stat    statbuf;
+  gboolean       succeed = TRUE;
+  gchar         *expunged_path;
+  gint           expunged_fd;
+  gint           fd;
+  DIR           *dir;
+
+  /* a trash folder which doesn't exist is empty */
+  fd = open (path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (fd < 0)
+    return (errno == ENOENT);
+
+  if (fstat (fd, &statbuf) != 0 || statbuf.st_uid != getuid ())
+    {
+      close (fd);
+      return FALSE;
+    }
+
+  /* pick up what an earlier run left behind */
+  dir = fdopendir (dup (fd));
+  if (dir != NULL)
+    {
+      while ((entry = readdir (dir)) != NULL)
+        if (g_str_has_prefix (entry->d_name, EXPUNGED_PREFIX))
+          *expunged = g_list_prepend (*expunged, g_file_new_build_filename (path, entry->d_name, NULL));
+      closedir (dir);
+    }
+
+  expunged_path = g_build_filename (path, EXPUNGED_PREFIX "XXXXXX", NULL);
+  if (g_mkdtemp_full (expunged_path, 0700) != NULL
+      && (expunged_fd = open (expunged_path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC)) >= 0)
+    {
+      /* info/ goes first and comes back if files/ cannot follow, so no
+       * trashed file is left without its info file */
+      if (renameat (fd, "info", expunged_fd, "info") != 0 && errno != ENOENT)
+        {
+          succeed = FALSE;
+        }
+      else if (renameat (fd, "files", expunged_fd, "files") != 0 && errno != ENOENT)
+        {
+          renameat (expunged_fd, "info", fd, "info");
+          succeed = FALSE;
+        }
+      close (expunged_fd);
+
+      /* the folder is deleted even if it only has the files */
+      *expunged = g_list_prepend (*expunged, g_file_new_for_path (expunged_path));
+
+      mkdirat (fd, "files", 0700);
+      mkdirat (fd, "info", 0700);
+    }
+  else
+    {
+      succeed = FALSE;
+    }
+
+  g_free (expunged_path);
+  close (fd);
+
+  return succeed;
+}
+
+
+
+/**
+ * thunar_io_trash_empty_local:
+ * @expunged_return : return location for the folders to delete.
+ *
+ * Empties the home trash and the $topdir/.Trash/$uid and $topdir/.Trash-$uid
+ * folders of the mounted file systems at once, by moving their contents
+ * aside into folders which are prepended to @expunged_return. The caller
+ * deletes them; what is left of them is returned again next time.
+ *
+ * Return value: %TRUE if trash:/// is empty now, %FALSE if gio has to
+ *               delete what is left.
+ **/
+gboolean
+thunar_io_trash_empty_local (GList **expunged_return)
+{
+  gboolean     succeed;
+  gchar       *path;
+#ifdef HAVE_GIO_UNIX
+  struct stat  statbuf;
+  const gchar *mount_path;
+  GList       *mounts;
+  GList       *lp;
+  gchar       *name;
+#endif
+
+  path = g_build_filename (g_get_user_data_dir (), "Trash", NULL);
+  succeed = thunar_io_trash_expunge_dir (path, expunged_return);
+  g_free (path);
+
+#ifdef HAVE_GIO_UNIX
+  /* the trash folders of the other file systems, like gvfs finds them */
+  mounts = g_unix_mounts_get (NULL);
+  for (lp = mounts; lp != NULL; lp = lp->next)
+    {
+      if (g_unix_mount_is_system_internal (lp->data))
+        continue;
+
+      mount_path = g_unix_mount_get_mount_path (lp->data);
+
+      /* the shared trash folder must be sticky and not a link */
+      path = g_build_filename (mount_path, ".Trash", NULL);
+      if (g_lstat (path, &statbuf) == 0 && S_ISDIR (statbuf.st_mode) && (statbuf.st_mode & S_ISVTX) != 0)
+        {
+          name = g_strdup_printf ("%u", (guint) getuid ());
+          g_free (path);
+          path = g_build_filename (mount_path, ".Trash", name, NULL);
+          g_free (name);
+
+          if (!thunar_io_trash_expunge_dir (path, expunged_return))
+            succeed = FALSE;
+        }
+      g_free (path);
+
+      name = g_strdup_printf (".Trash-%u", (guint) getuid ());
+      path = g_build_filename (mount_path, name, NULL);
+      if (!thunar_io_trash_expunge_dir (path, expunged_return))
+        succeed = FALSE;
+      g_free (path);
+      g_free (name);
+    }
+  g_list_free_full (mounts, (GDestroyNotify) g_unix_mount_free);
+#else
+  /* without the mounts, gio has to take care of the other file systems */
+  succeed = FALSE;
+#endif
+
+  return succeed;
+}
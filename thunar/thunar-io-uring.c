@@ -0,0 +1,885 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * Copyright (c) 2024 The Thunar development team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Submits batches of local file system calls through an io_uring, so a
+ * job thread has many of them in flight instead of one at a time. The
+ * ring is set up with the raw system calls, there is no dependency on
+ * liburing.
+ *
+ * A ring belongs to the thread which created it. thunar_io_uring_new()
+ * returns %NULL if the kernel has no io_uring, a sandbox forbids it or
+ * the "misc-io-uring-queue-depth" preference is 0; the callers then fall
+ * back to the plain system calls. Batches of operations the kernel does
+ * not know return %FALSE (or %ENOSYS) without doing anything. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef HAVE_ERRNO_H
+#include <errno.h>
+#endif
+
+#if defined(__linux__) && defined(HAVE_LINUX_IO_URING_H)
+#include <linux/io_uring.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+/* unlinkat and renameat came with Linux 5.11, like IORING_FEAT_EXT_ARG */
+#if defined(__NR_io_uring_setup) && defined(IORING_FEAT_EXT_ARG) && defined(HAVE_STATX)
+#define HAVE_IO_URING 1
+#endif
+#endif
+
+#include "thunar/thunar-io-uring.h"
+#include "thunar/thunar-private.h"
+
+
+
+/* queue depth of new rings until the preferences are read */
+#define DEFAULT_QUEUE_DEPTH (32)
+
+/* memory of the buffers of a copy, at least two buffers are used */
+#define COPY_MEMORY (32 * 1024 * 1024)
+
+/* alignment of the copy buffers, suitable for O_DIRECT */
+#define COPY_BUFFER_ALIGN (4096)
+
+
+
+static gint queue_depth = DEFAULT_QUEUE_DEPTH;
+
+
+
+static void
+thunar_io_uring_queue_depth_changed (ThunarPreferences *preferences,
+                                     GParamSpec        *pspec,
+                                     gpointer           user_data)
+{
+  guint depth;
+
+  g_object_get (G_OBJECT (preferences), "misc-io-uring-queue-depth", &depth, NULL);
+  g_atomic_int_set (&queue_depth, (gint) depth);
+}
+
+
+
+/**
+ * thunar_io_uring_init:
+ * @preferences : the #ThunarPreferences.
+ *
+ * Makes new rings follow the "misc-io-uring-queue-depth" preference.
+ * Has to be called from the main thread.
+ **/
+void
+thunar_io_uring_init (ThunarPreferences *preferences)
+{
+  _thunar_return_if_fail (THUNAR_IS_PREFERENCES (preferences));
+
+  g_signal_connect (G_OBJECT (preferences), "notify::misc-io-uring-queue-depth",
+                    G_CALLBACK (thunar_io_uring_queue_depth_changed), NULL);
+  thunar_io_uring_queue_depth_changed (preferences, NULL, NULL);
+}
+
+
+
+#ifdef HAVE_IO_URING
+struct _ThunarIoUring
+{
+  gint  fd;
+  guint queue_depth;
+
+  /* submission queue, shared with the kernel */
+  guint               *sq_head;
+  guint               *sq_tail;
+  guint               *sq_array;
+  guint                sq_mask;
+  guint                sq_queued;    /* our tail, published on submit */
+  guint                sq_submitted; /* entries consumed by the kernel */
+  struct io_uring_sqe *sqes;
+
+  /* completion queue, shared with the kernel */
+  guint               *cq_head;
+  guint               *cq_tail;
+  guint                cq_mask;
+  struct io_uring_cqe *cqes;
+
+  gpointer sq_ring;
+  gsize    sq_ring_size;
+  gpointer cq_ring;
+  gsize    cq_ring_size;
+  gsize    sqes_size;
+
+  /* the operations supported by the kernel, all cleared once the ring broke */
+  gboolean supported[IORING_OP_LAST];
+};
+
+typedef void (*ThunarIoUringPrepareFunc) (struct io_uring_sqe *sqe,
+                                          guint                index,
+                                          gconstpointer        user_data);
+
+typedef struct
+{
+  gint                dirfd;
+  const gchar *const *names;
+  const gint         *flags;
+  gint                statx_flags;
+  guint               mask;
+  struct statx       *statxbufs;
+  gint                new_dirfd;
+  const gchar *const *new_names;
+  guint               rename_flags;
+} ThunarIoUringBatch;
+
+typedef struct
+{
+  guchar  *buffer;
+  goffset  offset; /* of the chunk in both files */
+  gsize    length; /* of the chunk */
+  gsize    done;   /* bytes read or written so far */
+  gboolean writing;
+} ThunarIoUringChunk;
+
+
+
+/* the kernel wants it to stay disabled, remembered for all threads */
+static gint io_uring_unavailable = FALSE;
+
+
+
+static gpointer
+thunar_io_uring_map (gint   fd,
+                     gsize  size,
+                     off_t  offset)
+{
+  gpointer ptr;
+
+  ptr = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+  return ptr != MAP_FAILED ? ptr : NULL;
+}
+
+
+
+/**
+ * thunar_io_uring_new:
+ *
+ * Sets up a ring with the queue depth of the "misc-io-uring-queue-depth"
+ * preference, to be used by the calling thread only.
+ *
+ * Return value: (nullable): a new #ThunarIoUring, or %NULL if the
+ *               plain system calls have to be used.
+ **/
+ThunarIoUring *
+thunar_io_uring_new (void)
+{
+  struct io_uring_params params;
+  struct io_uring_probe *probe;
+  ThunarIoUring         *ring;
+  guint                  depth;
+  guint                  n;
+  gint                   fd;
+
+  depth = (guint) g_atomic_int_get (&queue_depth);
+  if (depth == 0 || g_atomic_int_get (&io_uring_unavailable))
+    return NULL;
+
+  memset (&params, 0, sizeof (params));
+  fd = syscall (__NR_io_uring_setup, depth, &params);
+  if (fd < 0)
+    {
+      /* not built into the kernel, or forbidden by a sandbox or sysctl */
+      if (errno == ENOSYS || errno == EPERM || errno == EACCES)
+        g_atomic_int_set (&io_uring_unavailable, TRUE);
+      return NULL;
+    }
+
+  ring = g_slice_new0 (ThunarIoUring);
+  ring->fd = fd;
+  ring->queue_depth = params.sq_entries;
+
+  ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof (guint);
+  ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof (struct io_uring_cqe);
+  if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0)
+    ring->sq_ring_size = ring->cq_ring_size = MAX (ring->sq_ring_size, ring->cq_ring_size);
+  ring->sqes_size = params.sq_entries * sizeof (struct io_uring_sqe);
+
+  ring->sq_ring = thunar_io_uring_map (fd, ring->sq_ring_size, IORING_OFF_SQ_RING);
+  if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0)
+    ring->cq_ring = ring->sq_ring;
+  else
+    ring->cq_ring = thunar_io_uring_map (fd, ring->cq_ring_size, IORING_OFF_CQ_RING);
+  ring->sqes = thunar_io_uring_map (fd, ring->sqes_size, IORING_OFF_SQES);
+
+  if (ring->sq_ring == NULL || ring->cq_ring == NULL || ring->sqes == NULL)
+    {
+      thunar_io_uring_free (ring);
+      return NULL;
+    }
+
+  ring->sq_head = (guint *) ((guchar *) ring->sq_ring + params.sq_off.head);
+  ring->sq_tail = (guint *) ((guchar *) ring->sq_ring + params.sq_off.tail);
+  ring->sq_array = (guint *) ((guchar *) ring->sq_ring + params.sq_off.array);
+  ring->sq_mask = *(guint *) ((guchar *) ring->sq_ring + params.sq_off.ring_mask);
+  ring->sq_queued = *ring->sq_tail;
+  ring->sq_submitted = ring->sq_queued;
+
+  ring->cq_head = (guint *) ((guchar *) ring->cq_ring + params.cq_off.head);
+  ring->cq_tail = (guint *) ((guchar *) ring->cq_ring + params.cq_off.tail);
+  ring->cq_mask = *(guint *) ((guchar *) ring->cq_ring + params.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *) ((guchar *) ring->cq_ring + params.cq_off.cqes);
+
+  /* ask which operations this kernel knows */
+  probe = g_malloc0 (sizeof (struct io_uring_probe) + 256 * sizeof (struct io_uring_probe_op));
+  if (syscall (__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) == 0)
+    {
+      for (n = 0; n < probe->ops_len && n < IORING_OP_LAST; n++)
+        ring->supported[n] = (probe->ops[n].flags & IO_URING_OP_SUPPORTED) != 0;
+    }
+  g_free (probe);
+
+  return ring;
+}
+
+
+
+void
+thunar_io_uring_free (ThunarIoUring *ring)
+{
+  if (ring == NULL)
+    return;
+
+  if (ring->sqes != NULL)
+    munmap (ring->sqes, ring->sqes_size);
+  if (ring->cq_ring != NULL && ring->cq_ring != ring->sq_ring)
+    munmap (ring->cq_ring, ring->cq_ring_size);
+  if (ring->sq_ring != NULL)
+    munmap (ring->sq_ring, ring->sq_ring_size);
+
+  close (ring->fd);
+  g_slice_free (ThunarIoUring, ring);
+}
+
+
+
+guint
+thunar_io_uring_get_queue_depth (const ThunarIoUring *ring)
+{
+  _thunar_return_val_if_fail (ring != NULL, 0);
+  return ring->queue_depth;
+}
+
+
+
+/* Returns a cleared submission queue entry, the caller makes sure
+ * that no more than queue_depth operations are in flight */
+static struct io_uring_sqe *
+thunar_io_uring_get_sqe (ThunarIoUring *ring,
+                         guint64        user_data)
+{
+  struct io_uring_sqe *sqe;
+  guint                index;
+
+  index = ring->sq_queued & ring->sq_mask;
+  sqe = &ring->sqes[index];
+  memset (sqe, 0, sizeof (*sqe));
+  sqe->user_data = user_data;
+
+  ring->sq_array[index] = index;
+  ring->sq_queued++;
+
+  return sqe;
+}
+
+
+
+/* Submits the queued entries and waits until at least one operation
+ * completed. Returns 0 or a negative errno value */
+static gint
+thunar_io_uring_submit_and_wait (ThunarIoUring *ring)
+{
+  glong ret;
+
+  /* publish the new entries before the kernel looks at them */
+  g_atomic_int_set ((gint *) ring->sq_tail, (gint) ring->sq_queued);
+
+  ret = syscall (__NR_io_uring_enter, ring->fd, ring->sq_queued - ring->sq_submitted, 1,
+                 IORING_ENTER_GETEVENTS, NULL, (gsize) 0);
+  if (ret < 0)
+    {
+      /* nothing was submitted, the completions may free resources */
+      if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+        return 0;
+
+      return -errno;
+    }
+
+  ring->sq_submitted += (guint) ret;
+  return 0;
+}
+
+
+
+static gboolean
+thunar_io_uring_next_cqe (ThunarIoUring       *ring,
+                          struct io_uring_cqe *cqe_return)
+{
+  guint head;
+
+  head = *ring->cq_head;
+  if (head == (guint) g_atomic_int_get ((gint *) ring->cq_tail))
+    return FALSE;
+
+  *cqe_return = ring->cqes[head & ring->cq_mask];
+
+  /* hand the entry back to the kernel once it is copied */
+  g_atomic_int_set ((gint *) ring->cq_head, (gint) (head + 1));
+
+  return TRUE;
+}
+
+
+
+/* Cleans up after submitting failed: the entries the kernel did not consume
+ * are taken back, and the @n_in_flight operations that did start are waited
+ * for, since they still use the buffers of the caller. Results are stored in
+ * @results, if not %NULL. The ring is not used for anything else afterwards */
+static void
+thunar_io_uring_drain (ThunarIoUring *ring,
+                       guint          n_in_flight,
+                       gint          *results)
+{
+  struct io_uring_cqe cqe;
+
+  n_in_flight -= ring->sq_queued - ring->sq_submitted;
+  ring->sq_queued = ring->sq_submitted;
+  g_atomic_int_set ((gint *) ring->sq_tail, (gint) ring->sq_queued);
+
+  memset (ring->supported, 0, sizeof (ring->supported));
+
+  while (n_in_flight > 0)
+    {
+      while (n_in_flight > 0 && thunar_io_uring_next_cqe (ring, &cqe))
+        {
+          if (results != NULL)
+            results[cqe.user_data] = cqe.res;
+          n_in_flight--;
+        }
+
+      /* if the kernel refuses to wait as well, poll the completion queue */
+      if (n_in_flight > 0
+          && syscall (__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, (gsize) 0) < 0
+          && errno != EINTR)
+        g_usleep (1000);
+    }
+}
+
+
+
+/* Runs @n_ops independent operations, at most queue_depth at a time, and
+ * stores the result of each in @results: 0 or more on success, a negative
+ * errno value on failure */
+static void
+thunar_io_uring_run (ThunarIoUring           *ring,
+                     guint                    n_ops,
+                     ThunarIoUringPrepareFunc prepare_func,
+                     gconstpointer            user_data,
+                     gint                    *results)
+{
+  struct io_uring_cqe cqe;
+  guint               n_queued = 0;
+  guint               n_in_flight = 0;
+  guint               n;
+  gint                ret;
+
+  for (n = 0; n < n_ops; n++)
+    results[n] = -ECANCELED;
+
+  while (n_queued < n_ops || n_in_flight > 0)
+    {
+      for (; n_queued < n_ops && n_in_flight < ring->queue_depth; n_queued++, n_in_flight++)
+        (*prepare_func) (thunar_io_uring_get_sqe (ring, n_queued), n_queued, user_data);
+
+      ret = thunar_io_uring_submit_and_wait (ring);
+      if (G_UNLIKELY (ret < 0))
+        {
+          g_warning ("Failed to submit to the io_uring: %s", g_strerror (-ret));
+          thunar_io_uring_drain (ring, n_in_flight, results);
+          break;
+        }
+
+      while (thunar_io_uring_next_cqe (ring, &cqe))
+        {
+          results[cqe.user_data] = cqe.res;
+          n_in_flight--;
+        }
+    }
+}
+
+
+
+static void
+thunar_io_uring_prepare_statx (struct io_uring_sqe *sqe,
+                               guint                index,
+                               gconstpointer        user_data)
+{
+  const ThunarIoUringBatch *batch = user_data;
+
+  sqe->opcode = IORING_OP_STATX;
+  sqe->fd = batch->dirfd;
+  sqe->addr = (guintptr) batch->names[index];
+  sqe->len = batch->mask;
+  sqe->off = (guintptr) &batch->statxbufs[index];
+  sqe->statx_flags = batch->statx_flags;
+}
+
+
+
+static void
+thunar_io_uring_prepare_unlinkat (struct io_uring_sqe *sqe,
+                                  guint                index,
+                                  gconstpointer        user_data)
+{
+  const ThunarIoUringBatch *batch = user_data;
+
+  sqe->opcode = IORING_OP_UNLINKAT;
+  sqe->fd = batch->dirfd;
+  sqe->addr = (guintptr) batch->names[index];
+  sqe->unlink_flags = batch->flags[index];
+}
+
+
+
+static void
+thunar_io_uring_prepare_renameat (struct io_uring_sqe *sqe,
+                                  guint                index,
+                                  gconstpointer        user_data)
+{
+  const ThunarIoUringBatch *batch = user_data;
+
+  sqe->opcode = IORING_OP_RENAMEAT;
+  sqe->fd = batch->dirfd;
+  sqe->addr = (guintptr) batch->names[index];
+  sqe->len = batch->new_dirfd;
+  sqe->addr2 = (guintptr) batch->new_names[index];
+  sqe->rename_flags = batch->rename_flags;
+}
+
+
+
+/**
+ * thunar_io_uring_statx:
+ * @ring      : a #ThunarIoUring.
+ * @dirfd     : folder the @names are relative to, or %AT_FDCWD.
+ * @names     : the files to stat.
+ * @n_names   : number of @names.
+ * @flags     : flags of statx(), like %AT_SYMLINK_NOFOLLOW.
+ * @mask      : the fields to fill, like %STATX_TYPE.
+ * @statxbufs : @n_names buffers for the results.
+ * @results   : return location for 0 or a negative errno value per name.
+ *
+ * Calls statx() for all @names.
+ *
+ * Return value: %FALSE if the kernel cannot do this, then nothing was done.
+ **/
+gboolean
+thunar_io_uring_statx (ThunarIoUring      *ring,
+                       gint                dirfd,
+                       const gchar *const *names,
+                       guint               n_names,
+                       gint                flags,
+                       guint               mask,
+                       struct statx       *statxbufs,
+                       gint               *results)
+{
+  ThunarIoUringBatch batch = { dirfd, names, NULL, flags, mask, statxbufs, 0, NULL, 0 };
+
+  _thunar_return_val_if_fail (ring != NULL, FALSE);
+  _thunar_return_val_if_fail (names != NULL || n_names == 0, FALSE);
+
+  if (!ring->supported[IORING_OP_STATX])
+    return FALSE;
+
+  thunar_io_uring_run (ring, n_names, thunar_io_uring_prepare_statx, &batch, results);
+  return TRUE;
+}
+
+
+
+/**
+ * thunar_io_uring_unlinkat:
+ * @ring    : a #ThunarIoUring.
+ * @dirfd   : folder the @names are relative to, or %AT_FDCWD.
+ * @names   : the files to delete.
+ * @flags   : flags of unlinkat() per name, %AT_REMOVEDIR for folders.
+ * @n_names : number of @names.
+ * @results : return location for 0 or a negative errno value per name.
+ *
+ * Calls unlinkat() for all @names. They are deleted in no particular
+ * order, so a folder and its contents cannot be in the same batch.
+ *
+ * Return value: %FALSE if the kernel cannot do this, then nothing was done.
+ **/
+gboolean
+thunar_io_uring_unlinkat (ThunarIoUring      *ring,
+                          gint                dirfd,
+                          const gchar *const *names,
+                          const gint         *flags,
+                          guint               n_names,
+                          gint               *results)
+{
+  ThunarIoUringBatch batch = { dirfd, names, flags, 0, 0, NULL, 0, NULL, 0 };
+
+  _thunar_return_val_if_fail (ring != NULL, FALSE);
+  _thunar_return_val_if_fail (names != NULL || n_names == 0, FALSE);
+
+  if (!ring->supported[IORING_OP_UNLINKAT])
+    return FALSE;
+
+  thunar_io_uring_run (ring, n_names, thunar_io_uring_prepare_unlinkat, &batch, results);
+  return TRUE;
+}
+
+
+
+/**
+ * thunar_io_uring_renameat:
+ * @ring      : a #ThunarIoUring.
+ * @dirfd     : folder the @names are relative to, or %AT_FDCWD.
+ * @names     : the files to rename.
+ * @new_dirfd : folder the @new_names are relative to, or %AT_FDCWD.
+ * @new_names : the new names, one per name.
+ * @flags     : flags of renameat2(), like %RENAME_NOREPLACE.
+ * @n_names   : number of @names.
+ * @results   : return location for 0 or a negative errno value per name.
+ *
+ * Calls renameat2() for all @names, in no particular order.
+ *
+ * Return value: %FALSE if the kernel cannot do this, then nothing was done.
+ **/
+gboolean
+thunar_io_uring_renameat (ThunarIoUring      *ring,
+                          gint                dirfd,
+                          const gchar *const *names,
+                          gint                new_dirfd,
+                          const gchar *const *new_names,
+                          guint               flags,
+                          guint               n_names,
+                          gint               *results)
+{
+  ThunarIoUringBatch batch = { dirfd, names, NULL, 0, 0, NULL, new_dirfd, new_names, flags };
+
+  _thunar_return_val_if_fail (ring != NULL, FALSE);
+  _thunar_return_val_if_fail (names != NULL || n_names == 0, FALSE);
+  _thunar_return_val_if_fail (new_names != NULL || n_names == 0, FALSE);
+
+  if (!ring->supported[IORING_OP_RENAMEAT])
+    return FALSE;
+
+  thunar_io_uring_run (ring, n_names, thunar_io_uring_prepare_renameat, &batch, results);
+  return TRUE;
+}
+
+
+
+static void
+thunar_io_uring_queue_chunk (ThunarIoUring      *ring,
+                             ThunarIoUringChunk *chunk,
+                             guint               index,
+                             gint                source_fd,
+                             gint                dest_fd)
+{
+  struct io_uring_sqe *sqe;
+
+  sqe = thunar_io_uring_get_sqe (ring, index);
+  sqe->opcode = chunk->writing ? IORING_OP_WRITE : IORING_OP_READ;
+  sqe->fd = chunk->writing ? dest_fd : source_fd;
+  sqe->addr = (guintptr) (chunk->buffer + chunk->done);
+  sqe->len = chunk->length - chunk->done;
+  sqe->off = chunk->offset + chunk->done;
+}
+
+
+
+/**
+ * thunar_io_uring_copy:
+ * @ring                   : a #ThunarIoUring.
+ * @source_fd              : file to read from.
+ * @dest_fd                : file to write to.
+ * @size                   : number of bytes to copy from the start.
+ * @buffer_size            : size of one read or write, a multiple of 4096
+ *                           bytes if the files are opened with O_DIRECT.
+ * @cancellable            : (nullable): a #GCancellable.
+ * @progress_callback      : (nullable): called as chunks are written.
+ * @progress_callback_data : data for @progress_callback.
+ * @copied_return          : return location for the bytes written.
+ *
+ * Copies the first @size bytes of @source_fd with several chunks being
+ * read and written at the same time. The file offsets are not used or
+ * changed. A shorter source is copied up to its end.
+ *
+ * Return value: 0 on success, or an errno value. %ENOSYS means the kernel
+ *               cannot do this and nothing was done.
+ **/
+gint
+thunar_io_uring_copy (ThunarIoUring        *ring,
+                      gint                  source_fd,
+                      gint                  dest_fd,
+                      goffset               size,
+                      gsize                 buffer_size,
+                      GCancellable         *cancellable,
+                      GFileProgressCallback progress_callback,
+                      gpointer              progress_callback_data,
+                      goffset              *copied_return)
+{
+  struct io_uring_cqe cqe;
+  ThunarIoUringChunk *chunks;
+  ThunarIoUringChunk *chunk;
+  goffset             next_offset = 0;
+  goffset             copied = 0;
+  gpointer            buffer;
+  guint               n_chunks;
+  guint               n_in_flight = 0;
+  guint               n;
+  gint                saved_errno = 0;
+  gint                ret;
+
+  _thunar_return_val_if_fail (ring != NULL, EINVAL);
+  _thunar_return_val_if_fail (buffer_size > 0, EINVAL);
+
+  *copied_return = 0;
+
+  if (!ring->supported[IORING_OP_READ] || !ring->supported[IORING_OP_WRITE])
+    return ENOSYS;
+
+  if (size <= 0)
+    return 0;
+
+  n_chunks = MIN (ring->queue_depth, MAX (COPY_MEMORY / buffer_size, 2));
+  n_chunks = MIN (n_chunks, (size + buffer_size - 1) / buffer_size);
+
+  chunks = g_new0 (ThunarIoUringChunk, n_chunks);
+  for (n = 0; n < n_chunks; n++)
+    {
+      if (posix_memalign (&buffer, COPY_BUFFER_ALIGN, buffer_size) != 0)
+        {
+          saved_errno = ENOMEM;
+          break;
+        }
+      chunks[n].buffer = buffer;
+    }
+
+  /* start reading a chunk into every buffer */
+  for (n = 0; n < n_chunks && saved_errno == 0; n++, n_in_flight++)
+    {
+      chunks[n].offset = next_offset;
+      chunks[n].length = MIN ((goffset) buffer_size, size - next_offset);
+      next_offset += chunks[n].length;
+      thunar_io_uring_queue_chunk (ring, &chunks[n], n, source_fd, dest_fd);
+    }
+
+  while (n_in_flight > 0)
+    {
+      ret = thunar_io_uring_submit_and_wait (ring);
+      if (G_UNLIKELY (ret < 0))
+        {
+          g_warning ("Failed to submit to the io_uring: %s", g_strerror (-ret));
+          thunar_io_uring_drain (ring, n_in_flight, NULL);
+          if (saved_errno == 0)
+            saved_errno = -ret;
+          break;
+        }
+
+      while (thunar_io_uring_next_cqe (ring, &cqe))
+        {
+          n = (guint) cqe.user_data;
+          chunk = &chunks[n];
+          n_in_flight--;
+
+          if (cqe.res == -EINTR || cqe.res == -EAGAIN)
+            {
+              thunar_io_uring_queue_chunk (ring, chunk, n, source_fd, dest_fd);
+              n_in_flight++;
+              continue;
+            }
+
+          if (cqe.res < 0 || (chunk->writing && cqe.res == 0))
+            {
+              if (saved_errno == 0)
+                saved_errno = cqe.res < 0 ? -cqe.res : EIO;
+              continue;
+            }
+
+          chunk->done += cqe.res;
+
+          if (!chunk->writing)
+            {
+              /* the source file was truncated while copying */
+              if (cqe.res == 0)
+                {
+                  chunk->length = chunk->done;
+                  next_offset = size;
+                }
+
+              if (chunk->done < chunk->length)
+                {
+                  thunar_io_uring_queue_chunk (ring, chunk, n, source_fd, dest_fd);
+                  n_in_flight++;
+                  continue;
+                }
+
+              /* write the chunk at the same offset */
+              chunk->writing = TRUE;
+              chunk->done = 0;
+              if (chunk->length > 0)
+                {
+                  thunar_io_uring_queue_chunk (ring, chunk, n, source_fd, dest_fd);
+                  n_in_flight++;
+                  continue;
+                }
+            }
+          else if (chunk->done < chunk->length)
+            {
+              thunar_io_uring_queue_chunk (ring, chunk, n, source_fd, dest_fd);
+              n_in_flight++;
+              continue;
+            }
+          else
+            {
+              copied += chunk->length;
+              if (progress_callback != NULL)
+                (*progress_callback) (copied, size, progress_callback_data);
+            }
+
+          /* the buffer is free, read the next chunk into it */
+          if (saved_errno == 0 && next_offset < size)
+            {
+              if (g_cancellable_is_cancelled (cancellable))
+                {
+                  saved_errno = ECANCELED;
+                  continue;
+                }
+
+              chunk->offset = next_offset;
+              chunk->length = MIN ((goffset) buffer_size, size - next_offset);
+              chunk->done = 0;
+              chunk->writing = FALSE;
+              next_offset += chunk->length;
+              thunar_io_uring_queue_chunk (ring, chunk, n, source_fd, dest_fd);
+              n_in_flight++;
+            }
+        }
+    }
+
+  for (n = 0; n < n_chunks; n++)
+    free (chunks[n].buffer);
+  g_free (chunks);
+
+  *copied_return = copied;
+  return saved_errno;
+}
+
+
+
+#else /* !HAVE_IO_URING */
+
+ThunarIoUring *
+thunar_io_uring_new (void)
+{
+  return NULL;
+}
+
+
+
+void
+thunar_io_uring_free (ThunarIoUring *ring)
+{
+}
+
+
+
+guint
+thunar_io_uring_get_queue_depth (const ThunarIoUring *ring)
+{
+  return 0;
+}
+
+
+
+gboolean
+thunar_io_uring_statx (ThunarIoUring      *ring,
+                       gint                dirfd,
+                       const gchar *const *names,
+                       guint               n_names,
+                       gint                flags,
+                       guint               mask,
+                       struct statx       *statxbufs,
+                       gint               *results)
+{
+  return FALSE;
+}
+
+
+
+gboolean
+thunar_io_uring_unlinkat (ThunarIoUring      *ring,
+                          gint                dirfd,
+                          const gchar *const *names,
+                          const gint         *flags,
+                          guint               n_names,
+                          gint               *results)
+{
+  return FALSE;
+}
+
+
+
+gboolean
+thunar_io_uring_renameat (ThunarIoUring      *ring,
+                          gint                dirfd,
+                          const gchar *const *names,
+                          gint                new_dirfd,
+                          const gchar *const *new_names,
+                          guint               flags,
+                          guint               n_names,
+                          gint               *results)
+{
+  return FALSE;
+}
+
+
+
+gint
+thunar_io_uring_copy (ThunarIoUring        *ring,
+                      gint                  source_fd,
+                      gint                  dest_fd,
+                      goffset               size,
+                      gsize                 buffer_size,
+                      GCancellable         *cancellable,
+                      GFileProgressCallback progress_callback,
+                      gpointer              progress_callback_data,
+                      goffset              *copied_return)
+{
+  *copied_return = 0;
+  return ENOSYS;
+}
+#endif /* !HAVE_IO_URING */
@@ -0,0 +1,80 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * Copyright (c) 2024 The Thunar development team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __THUNAR_IO_URING_H__
+#define __THUNAR_IO_URING_H__
+
+#include "thunar/thunar-preferences.h"
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS;
+
+typedef struct _ThunarIoUring ThunarIoUring;
+
+struct statx;
+
+void
+thunar_io_uring_init (ThunarPreferences *preferences);
+ThunarIoUring *
+thunar_io_uring_new (void);
+void
+thunar_io_uring_free (ThunarIoUring *ring);
+guint
+thunar_io_uring_get_queue_depth (const ThunarIoUring *ring);
+gboolean
+thunar_io_uring_statx (ThunarIoUring      *ring,
+                       gint                dirfd,
+                       const gchar *const *names,
+                       guint               n_names,
+                       gint                flags,
+                       guint               mask,
+                       struct statx       *statxbufs,
+                       gint               *results);
+gboolean
+thunar_io_uring_unlinkat (ThunarIoUring      *ring,
+                          gint                dirfd,
+                          const gchar *const *names,
+                          const gint         *flags,
+                          guint               n_names,
+                          gint               *results);
+gboolean
+thunar_io_uring_renameat (ThunarIoUring      *ring,
+                          gint                dirfd,
+                          const gchar *const *names,
+                          gint                new_dirfd,
+                          const gchar *const *new_names,
+                          guint               flags,
+                          guint               n_names,
+                          gint               *results);
+gint
+thunar_io_uring_copy (ThunarIoUring        *ring,
+                      gint                  source_fd,
+                      gint                  dest_fd,
+                      goffset               size,
+                      gsize                 buffer_size,
+                      GCancellable         *cancellable,
+                      GFileProgressCallback progress_callback,
+                      gpointer              progress_callback_data,
+                      goffset              *copied_return);
+
+G_END_DECLS;
+
+#endif /* !__THUNAR_IO_URING_H__ */
@@ -78,6 +78,13 @@ struct _ThunarJobPrivate
   gboolean               paused; /* the job has been manually paused using the UI */
   gboolean               frozen; /* the job has been automaticaly paused regarding some parallel copy behavior */
   ThunarOperationLogMode log_mode;
+
+  /* time spent paused or waiting for the user to answer a question,
+   * the job thread and the UI both update it */
+  GMutex wait_mutex;
+  gint64 wait_time;  /* us */
+  gint64 wait_start; /* us, monotonic */
+  guint  n_waits;
 };
 
 
@@ -251,6 +258,10 @@ thunar_job_init (ThunarJob *job)
   job->priv->pausable = FALSE;
   job->priv->paused = FALSE;
   job->priv->frozen = FALSE;
+  g_mutex_init (&job->priv->wait_mutex);
+  job->priv->wait_time = 0;
+  job->priv->wait_start = 0;
+  job->priv->n_waits = 0;
 }
 
 
@@ -258,6 +269,10 @@ thunar_job_init (ThunarJob *job)
 static void
 thunar_job_finalize (GObject *object)
 {
+  ThunarJob *job = THUNAR_JOB (object);
+
+  g_mutex_clear (&job->priv->wait_mutex);
+
   (*G_OBJECT_CLASS (thunar_job_parent_class)->finalize) (object);
 }
 
@@ -317,6 +332,28 @@ thunar_job_real_ask_replace (ThunarJob  *job,
 
 
 
+static void
+thunar_job_begin_wait (ThunarJob *job)
+{
+  g_mutex_lock (&job->priv->wait_mutex);
+  if (job->priv->n_waits++ == 0)
+    job->priv->wait_start = g_get_monotonic_time ();
+  g_mutex_unlock (&job->priv->wait_mutex);
+}
+
+
+
+static void
+thunar_job_end_wait (ThunarJob *job)
+{
+  g_mutex_lock (&job->priv->wait_mutex);
+  if (--job->priv->n_waits == 0)
+    job->priv->wait_time += g_get_monotonic_time () - job->priv->wait_start;
+  g_mutex_unlock (&job->priv->wait_mutex);
+}
+
+
+
 static ThunarJobResponse
 _thunar_job_ask_valist (ThunarJob        *job,
                         const gchar      *format,
@@ -339,7 +376,9 @@ _thunar_job_ask_valist (ThunarJob        *job,
   g_free (text);
 
   /* send the question and wait for the answer */
+  thunar_job_begin_wait (job);
   exo_job_emit (EXO_JOB (job), job_signals[ASK], 0, message, choices, &response);
+  thunar_job_end_wait (job);
   g_free (message);
 
   /* cancel the job as per users request */
@@ -550,8 +589,10 @@ thunar_job_ask_replace (ThunarJob *job,
       return THUNAR_JOB_RESPONSE_SKIP;
     }
 
+  thunar_job_begin_wait (job);
   exo_job_emit (EXO_JOB (job), job_signals[ASK_REPLACE], 0,
                 source_file, target_file, &response);
+  thunar_job_end_wait (job);
 
   g_object_unref (source_file);
   g_object_unref (target_file);
@@ -743,6 +784,8 @@ void
 thunar_job_pause (ThunarJob *job)
 {
   _thunar_return_if_fail (THUNAR_IS_JOB (job));
+  if (!job->priv->paused)
+    thunar_job_begin_wait (job);
   job->priv->paused = TRUE;
 }
 
@@ -752,6 +795,8 @@ void
 thunar_job_resume (ThunarJob *job)
 {
   _thunar_return_if_fail (THUNAR_IS_JOB (job));
+  if (job->priv->paused)
+    thunar_job_end_wait (job);
   job->priv->paused = FALSE;
 }
 
@@ -795,6 +840,31 @@ thunar_job_is_frozen (ThunarJob *job)
 
 
 
+/**
+ * thunar_job_get_wait_time:
+ * @job : a #ThunarJob.
+ *
+ * Return value: the time in microseconds @job was paused or waited
+ *               for the user to answer a question so far.
+ **/
+gint64
+thunar_job_get_wait_time (ThunarJob *job)
+{
+  gint64 wait_time;
+
+  _thunar_return_val_if_fail (THUNAR_IS_JOB (job), 0);
+
+  g_mutex_lock (&job->priv->wait_mutex);
+  wait_time = job->priv->wait_time;
+  if (job->priv->n_waits > 0)
+    wait_time += g_get_monotonic_time () - job->priv->wait_start;
+  g_mutex_unlock (&job->priv->wait_mutex);
+
+  return wait_time;
+}
+
+
+
 void
 thunar_job_processing_file (ThunarJob *job,
                             GList     *current_file,
@@ -89,6 +89,8 @@ gboolean
 thunar_job_is_paused (ThunarJob *job);
 gboolean
 thunar_job_is_frozen (ThunarJob *job);
+gint64
+thunar_job_get_wait_time (ThunarJob *job);
 void
 thunar_job_processing_file (ThunarJob *job,
                             GList     *current_file,
@@ -37,6 +37,7 @@
 #include "thunar/thunar-list-model.h"
 #include "thunar/thunar-preferences.h"
 #include "thunar/thunar-private.h"
+#include "thunar/thunar-search-matcher.h"
 #include "thunar/thunar-simple-job.h"
 #include "thunar/thunar-standard-view-model.h"
 #include "thunar/thunar-user.h"
@@ -223,6 +224,9 @@ thunar_list_model_search_finished (ThunarJob       *job,
 static void
 thunar_list_model_add_search_files (ThunarStandardViewModel *model,
                                     GList                   *files);
+static void
+thunar_list_model_remove_search_files (ThunarStandardViewModel *model,
+                                       GList                   *files);
 static gboolean
 thunar_list_model_update_search_files (ThunarListModel *model);
 
@@ -281,7 +285,8 @@ struct _ThunarListModelClass
   /* signals */
   void (*error) (ThunarListModel *store,
                  const GError    *error);
-  void (*search_done) (void);
+  void (*search_done) (ThunarListModel *store,
+                       guint            n_pruned);
 };
 
 struct _ThunarListModel
@@ -305,11 +310,11 @@ struct _ThunarListModel
   ThunarDateStyle       date_style;
   char                 *date_custom_style;
 
-  /* Normalized current search terms.
+  /* Compiled current search query.
    * NULL if not presenting a search's results.
    * Search job may have finished even if this is non-NULL.
    */
-  gchar **search_terms;
+  ThunarSearchMatcher *search_matcher;
 
   /* ids for the "row-inserted" and "row-deleted" signals
    * of GtkTreeModel to speed up folder changing.
@@ -327,9 +332,11 @@ struct _ThunarListModel
    * in the files_to_add list.
    * Periodically the main thread takes all the files in the files_to_add list
    * and adds them in the model. The list is then emptied.
+   * Results the search took back are collected in files_to_remove the same way.
    */
   ThunarJob  *recursive_search_job;
   GHashTable *files_to_add;
+  GHashTable *files_to_remove;
   GMutex      mutex_files_to_add;
 
   /* used to stop the periodic call to thunar_list_model_add_search_files when the search is finished/canceled */
@@ -500,6 +507,7 @@ thunar_list_model_standard_view_model_init (ThunarStandardViewModelIface *iface)
   iface->set_folders_first = thunar_list_model_set_folders_first;
   iface->set_hidden_last = thunar_list_model_set_hidden_last;
   iface->add_search_files = thunar_list_model_add_search_files;
+  iface->remove_search_files = thunar_list_model_remove_search_files;
 }
 
 
@@ -555,7 +563,7 @@ thunar_list_model_init (ThunarListModel *store)
   store->row_inserted_id = g_signal_lookup ("row-inserted", GTK_TYPE_TREE_MODEL);
   store->row_deleted_id = g_signal_lookup ("row-deleted", GTK_TYPE_TREE_MODEL);
 
-  store->search_terms = NULL;
+  store->search_matcher = NULL;
 
   store->sort_case_sensitive = TRUE;
   store->sort_folders_first = TRUE;
@@ -564,6 +572,7 @@ thunar_list_model_init (ThunarListModel *store)
   store->sort_func = thunar_file_compare_by_name;
   store->rows = g_sequence_new (g_object_unref);
   store->files_to_add = g_hash_table_new (g_direct_hash, NULL);
+  store->files_to_remove = g_hash_table_new_full (g_direct_hash, NULL, g_object_unref, NULL);
   g_mutex_init (&store->mutex_files_to_add);
 
   store->loading = FALSE;
@@ -596,13 +605,15 @@ thunar_list_model_finalize (GObject *object)
     }
   g_hash_table_destroy (store->files_to_add);
   store->files_to_add = NULL;
+  g_hash_table_destroy (store->files_to_remove);
+  store->files_to_remove = NULL;
 
   g_sequence_free (store->rows);
   g_mutex_clear (&store->mutex_files_to_add);
 
   g_free (store->date_custom_style);
 
-  g_strfreev (store->search_terms);
+  thunar_search_matcher_free (store->search_matcher);
 
   (*G_OBJECT_CLASS (thunar_list_model_parent_class)->finalize) (object);
 }
@@ -1676,13 +1687,13 @@ thunar_list_model_files_added (ThunarFolder    *folder,
 {
   GHashTable    *filtered;
   ThunarFile    *file;
-  gboolean       matched;
-  gchar         *name_n;
+  GFileInfo     *info;
+  const gchar   *display_name;
   gpointer       key;
   GHashTableIter iter;
 
   /* pass the list directly if not currently showing search results */
-  if (store->search_terms == NULL)
+  if (store->search_matcher == NULL)
     {
       thunar_list_model_insert_files (store, files);
       return;
@@ -1701,18 +1712,18 @@ thunar_list_model_files_added (ThunarFolder    *folder,
           continue;
         }
 
-      name_n = (gchar *) thunar_file_get_display_name (file);
-      if (name_n == NULL)
+      display_name = thunar_file_get_display_name (file);
+      if (display_name == NULL)
         {
           g_warning ("failed to get display name");
           continue;
         }
 
-      name_n = thunar_g_utf8_normalize_for_search (name_n, TRUE, TRUE);
-      matched = thunar_util_search_terms_match (store->search_terms, name_n);
-      g_free (name_n);
-
-      if (matched)
+      /* a file without info cannot be checked, so it does not match */
+      info = thunar_file_get_info (file);
+      if (info != NULL
+          && thunar_search_matcher_match (store->search_matcher, display_name)
+          && thunar_search_matcher_match_info (store->search_matcher, info))
         g_hash_table_add (filtered, file);
     }
   thunar_list_model_insert_files (store, filtered);
@@ -1746,7 +1757,7 @@ thunar_list_model_insert_files (ThunarListModel *store,
   has_handler = g_signal_has_handler_pending (G_OBJECT (store), store->row_inserted_id, 0, FALSE);
 
   /* process all added files */
-  search_mode = (store->search_terms != NULL);
+  search_mode = (store->search_matcher != NULL);
   g_hash_table_iter_init (&file_iter, files);
   while (g_hash_table_iter_next (&file_iter, &key, NULL))
     {
@@ -1807,7 +1818,7 @@ thunar_list_model_files_removed (ThunarFolder    *folder,
   GHashTableIter iter;
 
   /* drop all the referenced files from the model */
-  search_mode = (store->search_terms != NULL);
+  search_mode = (store->search_matcher != NULL);
   g_hash_table_iter_init (&iter, files);
   while (g_hash_table_iter_next (&iter, &key, NULL))
     {
@@ -2084,11 +2095,39 @@ thunar_list_model_add_search_files (ThunarStandardViewModel *model,
 
 
 
+static void
+thunar_list_model_remove_search_files (ThunarStandardViewModel *model,
+                                       GList                   *files)
+{
+  ThunarListModel *_model = THUNAR_LIST_MODEL (model);
+
+  g_mutex_lock (&_model->mutex_files_to_add);
+
+  for (GList *lp = files; lp != NULL; lp = g_list_next (lp))
+    {
+      /* a file which did not make it into the model yet is just dropped */
+      if (g_hash_table_steal (_model->files_to_add, lp->data))
+        g_object_unref (lp->data);
+      else
+        g_hash_table_add (_model->files_to_remove, g_object_ref (lp->data));
+    }
+
+  g_mutex_unlock (&_model->mutex_files_to_add);
+}
+
+
+
 static gboolean
 thunar_list_model_update_search_files (ThunarListModel *model)
 {
   g_mutex_lock (&model->mutex_files_to_add);
 
+  if (g_hash_table_size (model->files_to_remove) > 0)
+    {
+      thunar_list_model_files_removed (NULL, model->files_to_remove, model);
+      g_hash_table_remove_all (model->files_to_remove);
+    }
+
   if (model->files_to_add != NULL)
     {
       thunar_list_model_insert_files (model, model->files_to_add);
@@ -2131,6 +2170,13 @@ static void
 thunar_list_model_search_finished (ThunarJob       *job,
                                    ThunarListModel *store)
 {
+  GArray *param_values;
+  guint   n_pruned;
+
+  /* the search job stores the number of folders left out by the prune rules */
+  param_values = thunar_simple_job_get_param_values (THUNAR_SIMPLE_JOB (job));
+  n_pruned = g_value_get_uint (&g_array_index (param_values, GValue, 8));
+
   if (store->recursive_search_job)
     {
       g_signal_handlers_disconnect_by_data (store->recursive_search_job, store);
@@ -2146,8 +2192,9 @@ thunar_list_model_search_finished (ThunarJob       *job,
     }
 
   g_hash_table_remove_all (store->files_to_add);
+  g_hash_table_remove_all (store->files_to_remove);
 
-  g_signal_emit_by_name (store, "search-done");
+  g_signal_emit_by_name (store, "search-done", n_pruned);
 }
 
 
@@ -2202,6 +2249,7 @@ thunar_list_model_set_folder (ThunarStandardViewModel *model,
           store->update_search_results_timeout_id = 0;
         }
       g_hash_table_remove_all (store->files_to_add);
+      g_hash_table_remove_all (store->files_to_remove);
 
       /* check if we have any handlers connected for "row-deleted" */
       has_handler = g_signal_has_handler_pending (G_OBJECT (store), store->row_deleted_id, 0, FALSE);
@@ -2266,24 +2314,28 @@ thunar_list_model_set_folder (ThunarStandardViewModel *model,
           files = thunar_folder_get_files (folder);
           thunar_list_model_set_loading (store, TRUE);
 
-          if (store->search_terms != NULL)
+          if (store->search_matcher != NULL)
             {
-              g_strfreev (store->search_terms);
-              store->search_terms = NULL;
+              thunar_search_matcher_free (store->search_matcher);
+              store->search_matcher = NULL;
             }
         }
       else
         {
-          gchar *search_query_c; /* normalized */
+          ThunarPreferences *preferences;
+          gboolean           fuzzy;
+
+          preferences = thunar_preferences_get ();
+          g_object_get (G_OBJECT (preferences), "misc-fuzzy-search", &fuzzy, NULL);
+          g_object_unref (preferences);
 
-          search_query_c = thunar_g_utf8_normalize_for_search (search_query, TRUE, TRUE);
-          g_strfreev (store->search_terms);
-          store->search_terms = thunar_util_split_search_query (search_query_c, NULL);
-          if (store->search_terms != NULL)
+          thunar_search_matcher_free (store->search_matcher);
+          store->search_matcher = thunar_search_matcher_new (search_query, fuzzy);
+          if (store->search_matcher != NULL)
             {
               /* search the current folder
                * start a new recursive_search_job */
-              store->recursive_search_job = thunar_io_jobs_search_directory (THUNAR_STANDARD_VIEW_MODEL (store), search_query_c, thunar_folder_get_corresponding_file (folder));
+              store->recursive_search_job = thunar_io_jobs_search_directory (THUNAR_STANDARD_VIEW_MODEL (store), search_query, thunar_folder_get_corresponding_file (folder));
               exo_job_launch (EXO_JOB (store->recursive_search_job));
 
               g_signal_connect (store->recursive_search_job, "error", G_CALLBACK (thunar_list_model_search_error), NULL);
@@ -2292,7 +2344,6 @@ thunar_list_model_set_folder (ThunarStandardViewModel *model,
               /* add new results to the model every X ms */
               store->update_search_results_timeout_id = g_timeout_add (500, G_SOURCE_FUNC (thunar_list_model_update_search_files), store);
             }
-          g_free (search_query_c);
           files = NULL;
         }
 
@@ -103,6 +103,12 @@ enum
   PROP_MISC_OPEN_NEW_WINDOW_AS_TAB,
   PROP_MISC_RECURSIVE_PERMISSIONS,
   PROP_MISC_RECURSIVE_SEARCH,
+  PROP_MISC_FUZZY_SEARCH,
+  PROP_MISC_SEARCH_FILE_CONTENTS,
+  PROP_MISC_PRUNE_PATTERNS,
+  PROP_MISC_PRUNE_MAX_DEPTH,
+  PROP_MISC_PRUNE_HIDDEN_FOLDERS,
+  PROP_MISC_PRUNE_OTHER_FILESYSTEMS,
   PROP_MISC_REMEMBER_GEOMETRY,
   PROP_MISC_SHOW_ABOUT_TEMPLATES,
   PROP_MISC_SHOW_DELETE_ACTION,
@@ -118,9 +124,16 @@ enum
   PROP_MISC_CONFIRM_CLOSE_MULTIPLE_TABS,
   PROP_MISC_STATUS_BAR_ACTIVE_INFO,
   PROP_MISC_PARALLEL_COPY_MODE,
+  PROP_MISC_TRANSFER_MAX_JOBS_PER_DEVICE,
   PROP_MISC_WINDOW_ICON,
   PROP_MISC_TRANSFER_USE_PARTIAL,
   PROP_MISC_TRANSFER_VERIFY_FILE,
+  PROP_MISC_TRANSFER_VERIFY_CHECKSUM_FILE,
+  PROP_MISC_TRANSFER_SKIP_UNCHANGED,
+  PROP_MISC_TRANSFER_BUFFER_SIZE,
+  PROP_MISC_TRANSFER_DIRECT_IO,
+  PROP_MISC_TRANSFER_ARCHIVE_MODE,
+  PROP_MISC_IO_URING_QUEUE_DEPTH,
   PROP_MISC_IMAGE_PREVIEW_FULL,
   PROP_SHORTCUTS_ICON_EMBLEMS,
   PROP_SHORTCUTS_ICON_SIZE,
@@ -903,6 +916,85 @@ thunar_preferences_class_init (ThunarPreferencesClass *klass)
                      THUNAR_RECURSIVE_SEARCH_ALWAYS,
                      EXO_PARAM_READWRITE);
 
+  /**
+   * ThunarPreferences:misc-fuzzy-search:
+   *
+   * Whether search terms only have to appear in order in a file name,
+   * in which case only the best ranked results are shown.
+   **/
+  preferences_props[PROP_MISC_FUZZY_SEARCH] =
+  g_param_spec_boolean ("misc-fuzzy-search",
+                        "MiscFuzzySearch",
+                        NULL,
+                        FALSE,
+                        EXO_PARAM_READWRITE);
+
+  /**
+   * ThunarPreferences:misc-search-file-contents:
+   *
+   * Whether the search also reads regular files whose name does not
+   * match, and shows those which contain all search terms.
+   **/
+  preferences_props[PROP_MISC_SEARCH_FILE_CONTENTS] =
+  g_param_spec_boolean ("misc-search-file-contents",
+                        "MiscSearchFileContents",
+                        NULL,
+                        FALSE,
+                        EXO_PARAM_READWRITE);
+
+  /**
+   * ThunarPreferences:misc-prune-patterns:
+   *
+   * Semicolon separated list of glob patterns, e.g. ".git;node_modules".
+   * Recursive searches and folder size calculations do not enter folders
+   * whose name matches one of them.
+   **/
+  preferences_props[PROP_MISC_PRUNE_PATTERNS] =
+  g_param_spec_string ("misc-prune-patterns",
+                       "MiscPrunePatterns",
+                       NULL,
+                       "",
+                       EXO_PARAM_READWRITE);
+
+  /**
+   * ThunarPreferences:misc-prune-max-depth:
+   *
+   * How many folder levels recursive searches and folder size
+   * calculations descend at most. 0 means no limit.
+   **/
+  preferences_props[PROP_MISC_PRUNE_MAX_DEPTH] =
+  g_param_spec_uint ("misc-prune-max-depth",
+                     "MiscPruneMaxDepth",
+                     NULL,
+                     0u, G_MAXUINT, 0u,
+                     EXO_PARAM_READWRITE);
+
+  /**
+   * ThunarPreferences:misc-prune-hidden-folders:
+   *
+   * Whether recursive searches and folder size calculations skip
+   * hidden folders.
+   **/
+  preferences_props[PROP_MISC_PRUNE_HIDDEN_FOLDERS] =
+  g_param_spec_boolean ("misc-prune-hidden-folders",
+                        "MiscPruneHiddenFolders",
+                        NULL,
+                        FALSE,
+                        EXO_PARAM_READWRITE);
+
+  /**
+   * ThunarPreferences:misc-prune-other-filesystems:
+   *
+   * Whether recursive searches stay on the filesystem of the folder
+   * they were started in, instead of descending into mount points.
+   **/
+  preferences_props[PROP_MISC_PRUNE_OTHER_FILESYSTEMS] =
+  g_param_spec_boolean ("misc-prune-other-filesystems",
+                        "MiscPruneOtherFilesystems",
+                        NULL,
+                        FALSE,
+                        EXO_PARAM_READWRITE);
+
   /**
    * ThunarPreferences:misc-remember-geometry:
    *
@@ -1075,6 +1167,19 @@ thunar_preferences_class_init (ThunarPreferencesClass *klass)
                      THUNAR_PARALLEL_COPY_MODE_ONLY_LOCAL_IDLE_DEVICE,
                      EXO_PARAM_READWRITE);
 
+  /**
+   * ThunarPreferences:misc-transfer-max-jobs-per-device:
+   *
+   * Number of copy jobs which may read from or write to the same device
+   * at once, for the devices the parallel copy mode does limit.
+   **/
+  preferences_props[PROP_MISC_TRANSFER_MAX_JOBS_PER_DEVICE] =
+  g_param_spec_uint ("misc-transfer-max-jobs-per-device",
+                     "MiscTransferMaxJobsPerDevice",
+                     NULL,
+                     1u, G_MAXUINT, 1u,
+                     EXO_PARAM_READWRITE);
+
   /**
    * ThunarPreferences:misc-change-window-icon:
    *
@@ -1113,6 +1218,85 @@ thunar_preferences_class_init (ThunarPreferencesClass *klass)
                      THUNAR_VERIFY_FILE_MODE_DISABLED,
                      EXO_PARAM_READWRITE);
 
+  /**
+   * ThunarPreferences:misc-transfer-skip-unchanged:
+   *
+   * Whether copies skip files whose target already exists unchanged,
+   * and replace older ones without asking, to bring a copy up to date.
+   **/
+  preferences_props[PROP_MISC_TRANSFER_SKIP_UNCHANGED] =
+  g_param_spec_enum ("misc-transfer-skip-unchanged",
+                     "MiscTransferSkipUnchanged",
+                     NULL,
+                     THUNAR_TYPE_SKIP_UNCHANGED_MODE,
+                     THUNAR_SKIP_UNCHANGED_MODE_DISABLED,
+                     EXO_PARAM_READWRITE);
+
+  /**
+   * ThunarPreferences:misc-transfer-verify-checksum-file:
+   *
+   * Whether verifying copied files also compares the source against
+   * a "<name>.sha256" checksum file next to it, if there is one.
+   **/
+  preferences_props[PROP_MISC_TRANSFER_VERIFY_CHECKSUM_FILE] =
+  g_param_spec_boolean ("misc-transfer-verify-checksum-file",
+                        "MiscTransferVerifyChecksumFile",
+                        NULL,
+                        FALSE,
+                        EXO_PARAM_READWRITE);
+
+  /**
+   * ThunarPreferences:misc-transfer-buffer-size:
+   *
+   * Number of KiB copied at once when transferring files.
+   **/
+  preferences_props[PROP_MISC_TRANSFER_BUFFER_SIZE] =
+  g_param_spec_uint ("misc-transfer-buffer-size",
+                     "MiscTransferBufferSize",
+                     NULL,
+                     64u, 1024u * 1024u, 8192u,
+                     EXO_PARAM_READWRITE);
+
+  /**
+   * ThunarPreferences:misc-transfer-direct-io:
+   *
+   * Whether very large local files are copied with O_DIRECT, bypassing
+   * the page cache, when the filesystems support it.
+   **/
+  preferences_props[PROP_MISC_TRANSFER_DIRECT_IO] =
+  g_param_spec_boolean ("misc-transfer-direct-io",
+                        "MiscTransferDirectIO",
+                        NULL,
+                        FALSE,
+                        EXO_PARAM_READWRITE);
+
+  /**
+   * ThunarPreferences:misc-transfer-archive-mode:
+   *
+   * Whether local folders copied to SFTP locations are streamed as a
+   * single tar archive over ssh, which is much faster for many small
+   * files. Falls back to a regular copy if ssh cannot connect.
+   **/
+  preferences_props[PROP_MISC_TRANSFER_ARCHIVE_MODE] =
+  g_param_spec_boolean ("misc-transfer-archive-mode",
+                        "MiscTransferArchiveMode",
+                        NULL,
+                        FALSE,
+                        EXO_PARAM_READWRITE);
+
+  /**
+   * ThunarPreferences:misc-io-uring-queue-depth:
+   *
+   * Number of system calls local jobs keep in flight through an io_uring
+   * when copying, deleting and scanning folders. 0 disables io_uring.
+   **/
+  preferences_props[PROP_MISC_IO_URING_QUEUE_DEPTH] =
+  g_param_spec_uint ("misc-io-uring-queue-depth",
+                     "MiscIoUringQueueDepth",
+                     NULL,
+                     0u, 4096u, 32u,
+                     EXO_PARAM_READWRITE);
+
   /**
    * ThunarPreferences:misc-image-preview-mode:
    *
@@ -240,9 +240,13 @@ launch_waiting_jobs (ThunarProgressDialog *dialog)
           dialog->views_waiting = g_list_remove_link (dialog->views_waiting, lp);
           dialog->views = g_list_concat (lp, dialog->views);
           thunar_progress_view_launch_job (THUNAR_PROGRESS_VIEW (lp->data));
-
-          job_list = g_list_prepend (job_list, thunar_progress_view_get_job (THUNAR_PROGRESS_VIEW (lp->data)));
         }
+
+      /* jobs still waiting keep their place in the queue of their devices,
+       * so later jobs can't overtake them */
+      if (!exo_job_is_cancelled (EXO_JOB (transfer_job)))
+        job_list = g_list_prepend (job_list, transfer_job);
+
       lp = next;
     }
   g_list_free (job_list);
@@ -355,6 +359,7 @@ thunar_progress_dialog_add_job (ThunarProgressDialog *dialog,
   GtkWidget *viewport;
   GtkWidget *view;
   GList     *job_list;
+  GList     *lp;
 
   _thunar_return_if_fail (THUNAR_IS_PROGRESS_DIALOG (dialog));
   _thunar_return_if_fail (THUNAR_IS_JOB (job));
@@ -370,8 +375,14 @@ thunar_progress_dialog_add_job (ThunarProgressDialog *dialog,
   if (dialog->views == NULL)
     gtk_window_set_icon_name (GTK_WINDOW (dialog), icon_name);
 
-  /* Check if the job can start */
+  /* Check if the job can start, after the jobs already waiting */
   job_list = thunar_progress_dialog_list_jobs (dialog);
+  for (lp = dialog->views_waiting; lp != NULL; lp = lp->next)
+    {
+      ThunarJob *waiting_job = thunar_progress_view_get_job (THUNAR_PROGRESS_VIEW (lp->data));
+      if (waiting_job != NULL && !exo_job_is_cancelled (EXO_JOB (waiting_job)))
+        job_list = g_list_prepend (job_list, waiting_job);
+    }
   if (!THUNAR_IS_TRANSFER_JOB (job)
       || thunar_transfer_job_can_start (THUNAR_TRANSFER_JOB (job), job_list))
     {
@@ -0,0 +1,205 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * Copyright (c) 2024 The Thunar development team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "thunar/thunar-preferences.h"
+#include "thunar/thunar-private.h"
+#include "thunar/thunar-prune-rules.h"
+
+
+
+struct _ThunarPruneRules
+{
+  /* compiled "misc-prune-patterns", matched against folder names */
+  GPtrArray *patterns;
+
+  /* folders deeper than this below the starting point are not
+   * entered, 0 for no limit */
+  guint max_depth;
+
+  gboolean skip_hidden;
+  gboolean same_filesystem;
+};
+
+
+
+G_DEFINE_BOXED_TYPE (ThunarPruneRules, thunar_prune_rules, thunar_prune_rules_ref, thunar_prune_rules_unref)
+
+
+
+static void
+thunar_prune_rules_clear (gpointer data)
+{
+  ThunarPruneRules *rules = data;
+
+  g_ptr_array_unref (rules->patterns);
+}
+
+
+
+/**
+ * thunar_prune_rules_new_from_preferences:
+ *
+ * Compiles the folder pruning rules from the "misc-prune-patterns",
+ * "misc-prune-max-depth", "misc-prune-hidden-folders" and
+ * "misc-prune-other-filesystems" preferences. Has to be called from
+ * the main thread, the returned rules may then be used by any job.
+ *
+ * Return value: (transfer full): the current #ThunarPruneRules. Release
+ *               with thunar_prune_rules_unref().
+ **/
+ThunarPruneRules *
+thunar_prune_rules_new_from_preferences (void)
+{
+  ThunarPreferences *preferences;
+  ThunarPruneRules  *rules;
+  gchar             *patterns;
+  gchar            **names;
+
+  rules = g_atomic_rc_box_new0 (ThunarPruneRules);
+  rules->patterns = g_ptr_array_new_with_free_func ((GDestroyNotify) g_pattern_spec_free);
+
+  preferences = thunar_preferences_get ();
+  g_object_get (G_OBJECT (preferences),
+                "misc-prune-patterns", &patterns,
+                "misc-prune-max-depth", &rules->max_depth,
+                "misc-prune-hidden-folders", &rules->skip_hidden,
+                "misc-prune-other-filesystems", &rules->same_filesystem,
+                NULL);
+  g_object_unref (preferences);
+
+  /* patterns are separated by semicolons, like in desktop files */
+  if (patterns != NULL)
+    {
+      names = g_strsplit (patterns, ";", -1);
+      for (guint n = 0; names[n] != NULL; n++)
+        {
+          g_strstrip (names[n]);
+          if (*names[n] != '\0')
+            g_ptr_array_add (rules->patterns, g_pattern_spec_new (names[n]));
+        }
+      g_strfreev (names);
+      g_free (patterns);
+    }
+
+  return rules;
+}
+
+
+
+/**
+ * thunar_prune_rules_ref:
+ * @rules : a #ThunarPruneRules.
+ *
+ * Return value: (transfer full): @rules with an additional reference.
+ **/
+ThunarPruneRules *
+thunar_prune_rules_ref (ThunarPruneRules *rules)
+{
+  return g_atomic_rc_box_acquire (rules);
+}
+
+
+
+/**
+ * thunar_prune_rules_unref:
+ * @rules : a #ThunarPruneRules.
+ *
+ * Drops a reference from @rules, freeing them once the last one is gone.
+ **/
+void
+thunar_prune_rules_unref (ThunarPruneRules *rules)
+{
+  g_atomic_rc_box_release_full (rules, thunar_prune_rules_clear);
+}
+
+
+
+/**
+ * thunar_prune_rules_get_device:
+ * @info : a #GFileInfo queried with %THUNAR_PRUNE_RULES_ATTRIBUTES.
+ *
+ * Return value: the st_dev of the file, or 0 if it is not known.
+ **/
+guint32
+thunar_prune_rules_get_device (GFileInfo *info)
+{
+  if (!g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_UNIX_DEVICE))
+    return 0;
+  return g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_DEVICE);
+}
+
+
+
+/**
+ * thunar_prune_rules_match:
+ * @rules           : a #ThunarPruneRules.
+ * @info            : the #GFileInfo of a folder, queried with at least
+ *                    %THUNAR_PRUNE_RULES_ATTRIBUTES.
+ * @depth           : the depth of the folder below the starting point,
+ *                    1 for its direct subfolders.
+ * @toplevel_device : the st_dev of the starting point, or 0 if unknown.
+ *
+ * Checks whether a recursive operation should skip the folder described
+ * by @info. This only looks at the file info from the parent's enumerator,
+ * so pruned folders are never opened.
+ *
+ * Return value: %TRUE if the folder should not be entered.
+ **/
+gboolean
+thunar_prune_rules_match (const ThunarPruneRules *rules,
+                          GFileInfo              *info,
+                          guint                   depth,
+                          guint32                 toplevel_device)
+{
+  const gchar *name;
+  guint32      device;
+
+  _thunar_return_val_if_fail (rules != NULL, FALSE);
+  _thunar_return_val_if_fail (G_IS_FILE_INFO (info), FALSE);
+
+  if (rules->max_depth > 0 && depth > rules->max_depth)
+    return TRUE;
+
+  if (rules->skip_hidden && g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN))
+    return TRUE;
+
+  /* mount points of other filesystems, e.g. network shares or /proc */
+  if (rules->same_filesystem && toplevel_device != 0)
+    {
+      device = thunar_prune_rules_get_device (info);
+      if (device != 0 && device != toplevel_device)
+        return TRUE;
+    }
+
+  if (rules->patterns->len > 0)
+    {
+      name = g_file_info_get_name (info);
+      for (guint n = 0; name != NULL && n < rules->patterns->len; n++)
+        if (g_pattern_spec_match_string (g_ptr_array_index (rules->patterns, n), name))
+          return TRUE;
+    }
+
+  return FALSE;
+}
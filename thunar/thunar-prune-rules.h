@@ -0,0 +1,56 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * Copyright (c) 2024 The Thunar development team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef __THUNAR_PRUNE_RULES_H__
+#define __THUNAR_PRUNE_RULES_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS;
+
+typedef struct _ThunarPruneRules ThunarPruneRules;
+
+#define THUNAR_TYPE_PRUNE_RULES (thunar_prune_rules_get_type ())
+
+/* the attributes thunar_prune_rules_match() needs in the file info */
+#define THUNAR_PRUNE_RULES_ATTRIBUTES \
+  G_FILE_ATTRIBUTE_STANDARD_NAME "," G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN "," G_FILE_ATTRIBUTE_UNIX_DEVICE
+
+GType
+thunar_prune_rules_get_type (void) G_GNUC_CONST;
+
+ThunarPruneRules *
+thunar_prune_rules_new_from_preferences (void) G_GNUC_MALLOC;
+ThunarPruneRules *
+thunar_prune_rules_ref (ThunarPruneRules *rules);
+void
+thunar_prune_rules_unref (ThunarPruneRules *rules);
+guint32
+thunar_prune_rules_get_device (GFileInfo *info);
+gboolean
+thunar_prune_rules_match (const ThunarPruneRules *rules,
+                          GFileInfo              *info,
+                          guint                   depth,
+                          guint32                 toplevel_device);
+
+G_END_DECLS;
+
+#endif /* !__THUNAR_PRUNE_RULES_H__ */
@@ -0,0 +1,978 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * Copyright (c) 2024 The Thunar development team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef HAVE_STDIO_H
+#include <stdio.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include "thunar/thunar-gobject-extensions.h"
+#include "thunar/thunar-private.h"
+#include "thunar/thunar-search-matcher.h"
+
+
+
+/* display names shorter than this are case folded on the stack,
+ * which covers virtually every name found on disk (NAME_MAX is 255) */
+#define NAME_BUFFER_SIZE 512
+
+/* fuzzy scoring, loosely modelled after fzf */
+#define SCORE_MATCH           16
+#define PENALTY_GAP_START     3
+#define PENALTY_GAP_EXTENSION 1
+#define BONUS_START           10
+#define BONUS_BOUNDARY        8
+#define BONUS_CAMEL_CASE      7
+#define BONUS_CONSECUTIVE     4
+
+
+
+typedef struct _ThunarSearchTerm      ThunarSearchTerm;
+typedef struct _ThunarSearchPredicate ThunarSearchPredicate;
+
+typedef enum
+{
+  PREDICATE_SIZE,
+  PREDICATE_MODIFIED,
+  PREDICATE_TYPE,
+  PREDICATE_EXTENSION,
+} ThunarSearchPredicateKind;
+
+typedef enum
+{
+  COMPARE_LESS,
+  COMPARE_LESS_EQUAL,
+  COMPARE_EQUAL,
+  COMPARE_GREATER_EQUAL,
+  COMPARE_GREATER,
+} ThunarSearchComparison;
+
+struct _ThunarSearchTerm
+{
+  gchar *text;
+  gsize  length;
+};
+
+struct _ThunarSearchPredicate
+{
+  ThunarSearchPredicateKind kind;
+  ThunarSearchComparison    comparison;
+
+  /* size in bytes or modification time in seconds since the epoch;
+   * for a whole day "modified:2024-05-01", the end of that day */
+  guint64 value;
+  guint64 value_end;
+
+  GFileType type;
+
+  /* the extensions, without leading dot, for "ext:jpg,png" */
+  gchar **extensions;
+};
+
+struct _ThunarSearchMatcher
+{
+  ThunarSearchTerm *terms;
+  guint             n_terms;
+
+  /* attribute predicates like "size:>100M", checked on the file info */
+  ThunarSearchPredicate *predicates;
+  guint                  n_predicates;
+
+  /* %TRUE if none of the normalized terms contains a non-ASCII
+   * character, so that plain ASCII names can skip normalization */
+  gboolean ascii_only;
+
+  /* %TRUE to match terms as subsequences and rank the names */
+  gboolean fuzzy;
+};
+
+
+
+static gboolean
+thunar_search_matcher_is_ascii (const gchar *str)
+{
+  for (; *str != '\0'; str++)
+    if ((guchar) *str >= 0x80)
+      return FALSE;
+  return TRUE;
+}
+
+
+
+static gint
+thunar_search_matcher_term_compare (gconstpointer a,
+                                    gconstpointer b)
+{
+  const ThunarSearchTerm *term_a = a;
+  const ThunarSearchTerm *term_b = b;
+
+  /* longest terms first, they are the least likely to match */
+  if (term_a->length == term_b->length)
+    return 0;
+  return (term_a->length > term_b->length) ? -1 : 1;
+}
+
+
+
+static const gchar *
+thunar_search_matcher_parse_comparison (const gchar            *str,
+                                        ThunarSearchComparison *comparison)
+{
+  if (str[0] == '<' && str[1] == '=')
+    *comparison = COMPARE_LESS_EQUAL;
+  else if (str[0] == '>' && str[1] == '=')
+    *comparison = COMPARE_GREATER_EQUAL;
+  else if (str[0] == '<')
+    *comparison = COMPARE_LESS;
+  else if (str[0] == '>')
+    *comparison = COMPARE_GREATER;
+  else if (str[0] == '=')
+    *comparison = COMPARE_EQUAL;
+  else
+    return NULL;
+
+  return str + ((str[1] == '=') ? 2 : 1);
+}
+
+
+
+static gboolean
+thunar_search_matcher_parse_size (const gchar           *str,
+                                  ThunarSearchPredicate *predicate)
+{
+  gchar  *end;
+  guint64 multiplier = 1;
+
+  if (!g_ascii_isdigit (*str))
+    return FALSE;
+
+  /* units are powers of 1024 like in find(1), in either case */
+  predicate->value = g_ascii_strtoull (str, &end, 10);
+  switch (g_ascii_tolower (*end))
+    {
+    case 't': multiplier <<= 10; /* fall through */
+    case 'g': multiplier <<= 10; /* fall through */
+    case 'm': multiplier <<= 10; /* fall through */
+    case 'k': multiplier <<= 10; end++; break;
+    case 'b': end++; break;
+    default: break;
+    }
+
+  if (*end != '\0' || predicate->value > G_MAXUINT64 / multiplier)
+    return FALSE;
+
+  predicate->value *= multiplier;
+  return TRUE;
+}
+
+
+
+static gboolean
+thunar_search_matcher_parse_modified (const gchar           *str,
+                                      gint64                 now,
+                                      gboolean               has_comparison,
+                                      ThunarSearchPredicate *predicate)
+{
+  GDateTime *date;
+  GDateTime *date_end;
+  gchar     *end;
+  guint64    amount;
+  guint64    unit;
+  gint       year, month, day;
+  gchar      trailing;
+
+  /* an absolute day, compared against the whole day in local time */
+  if (sscanf (str, "%4d-%2d-%2d%c", &year, &month, &day, &trailing) == 3)
+    {
+      date = g_date_time_new_local (year, month, day, 0, 0, 0);
+      if (date == NULL)
+        return FALSE;
+
+      /* not always 24 hours, e.g. when daylight saving time starts */
+      date_end = g_date_time_add_days (date, 1);
+      predicate->value = g_date_time_to_unix (date);
+      predicate->value_end = g_date_time_to_unix (date_end);
+      g_date_time_unref (date_end);
+      g_date_time_unref (date);
+      return TRUE;
+    }
+
+  /* an age, e.g. "7d"; "<7d" means newer than 7 days. Only "m" and
+   * "M" are told apart by their case, for minutes and months */
+  if (!g_ascii_isdigit (*str))
+    return FALSE;
+
+  amount = g_ascii_strtoull (str, &end, 10);
+  switch (*end)
+    {
+    case 'm': unit = 60; break;
+    case 'h': case 'H': unit = 60 * 60; break;
+    case 'd': case 'D': unit = 24 * 60 * 60; break;
+    case 'w': case 'W': unit = 7 * 24 * 60 * 60; break;
+    case 'M': unit = 30 * 24 * 60 * 60; break;
+    case 'y': case 'Y': unit = 365 * 24 * 60 * 60; break;
+    default: return FALSE;
+    }
+
+  if (end[1] != '\0' || amount > (guint64) now / unit)
+    return FALSE;
+
+  /* an age is a single second, so "=7d" would hardly ever match. Without
+   * a comparison, "7d" means within the last 7 days, like "<=7d" */
+  if (!has_comparison)
+    predicate->comparison = COMPARE_LESS_EQUAL;
+  else if (predicate->comparison == COMPARE_EQUAL)
+    return FALSE;
+
+  /* turn the age into a point in time, so that the comparison flips */
+  predicate->value = now - amount * unit;
+  switch (predicate->comparison)
+    {
+    case COMPARE_LESS: predicate->comparison = COMPARE_GREATER; break;
+    case COMPARE_LESS_EQUAL: predicate->comparison = COMPARE_GREATER_EQUAL; break;
+    case COMPARE_GREATER_EQUAL: predicate->comparison = COMPARE_LESS_EQUAL; break;
+    case COMPARE_GREATER: predicate->comparison = COMPARE_LESS; break;
+    case COMPARE_EQUAL: break; /* rejected above */
+    }
+  predicate->value_end = 0;
+
+  return TRUE;
+}
+
+
+
+static gchar **
+thunar_search_matcher_parse_extensions (const gchar *str)
+{
+  GPtrArray   *extensions;
+  const gchar *item;
+  gchar      **items;
+
+  extensions = g_ptr_array_new ();
+  items = g_strsplit (str, ",", -1);
+  for (guint n = 0; items[n] != NULL; n++)
+    {
+      /* allow "ext:.log" as well */
+      item = items[n] + (items[n][0] == '.');
+
+      /* skip empty items, like the one after a trailing comma */
+      if (*item != '\0')
+        g_ptr_array_add (extensions, g_strdup (item));
+    }
+  g_strfreev (items);
+
+  if (extensions->len == 0)
+    {
+      g_ptr_array_free (extensions, TRUE);
+      return NULL;
+    }
+
+  g_ptr_array_add (extensions, NULL);
+  return (gchar **) g_ptr_array_free (extensions, FALSE);
+}
+
+
+
+static gboolean
+thunar_search_matcher_has_key (const gchar *term,
+                               const gchar *key)
+{
+  return g_ascii_strncasecmp (term, key, strlen (key)) == 0;
+}
+
+
+
+/* parses "key:value" terms like "size:>100M", "modified:<7d", "type:dir"
+ * or "ext:log" from the query as typed, since case matters for some
+ * units. Everything else, including malformed values, is left to be
+ * matched against the file names */
+static gboolean
+thunar_search_matcher_parse_predicate (const gchar           *term,
+                                       gint64                 now,
+                                       ThunarSearchPredicate *predicate)
+{
+  const gchar *value;
+
+  memset (predicate, 0, sizeof (*predicate));
+  predicate->comparison = COMPARE_EQUAL;
+
+  if (thunar_search_matcher_has_key (term, "size:"))
+    {
+      predicate->kind = PREDICATE_SIZE;
+      value = thunar_search_matcher_parse_comparison (term + 5, &predicate->comparison);
+      return thunar_search_matcher_parse_size (value != NULL ? value : term + 5, predicate);
+    }
+
+  if (thunar_search_matcher_has_key (term, "modified:"))
+    {
+      predicate->kind = PREDICATE_MODIFIED;
+      value = thunar_search_matcher_parse_comparison (term + 9, &predicate->comparison);
+      return thunar_search_matcher_parse_modified (value != NULL ? value : term + 9, now, value != NULL, predicate);
+    }
+
+  if (thunar_search_matcher_has_key (term, "type:"))
+    {
+      predicate->kind = PREDICATE_TYPE;
+      value = term + 5;
+      if (g_ascii_strcasecmp (value, "dir") == 0 || g_ascii_strcasecmp (value, "folder") == 0 || g_ascii_strcasecmp (value, "directory") == 0)
+        predicate->type = G_FILE_TYPE_DIRECTORY;
+      else if (g_ascii_strcasecmp (value, "file") == 0 || g_ascii_strcasecmp (value, "regular") == 0)
+        predicate->type = G_FILE_TYPE_REGULAR;
+      else if (g_ascii_strcasecmp (value, "link") == 0 || g_ascii_strcasecmp (value, "symlink") == 0)
+        predicate->type = G_FILE_TYPE_SYMBOLIC_LINK;
+      else
+        return FALSE;
+      return TRUE;
+    }
+
+  if (thunar_search_matcher_has_key (term, "ext:"))
+    {
+      predicate->kind = PREDICATE_EXTENSION;
+      predicate->extensions = thunar_search_matcher_parse_extensions (term + 4);
+      return predicate->extensions != NULL;
+    }
+
+  return FALSE;
+}
+
+
+
+/* returns the next whitespace separated term of a query, or %NULL */
+static const gchar *
+thunar_search_matcher_next_term (const gchar **p,
+                                 gsize        *length)
+{
+  const gchar *start;
+
+  while (**p != '\0' && g_unichar_isspace (g_utf8_get_char (*p)))
+    *p = g_utf8_next_char (*p);
+
+  if (**p == '\0')
+    return NULL;
+
+  for (start = *p; **p != '\0' && !g_unichar_isspace (g_utf8_get_char (*p));)
+    *p = g_utf8_next_char (*p);
+
+  *length = *p - start;
+  return start;
+}
+
+
+
+/**
+ * thunar_search_matcher_new:
+ * @search_query : the search query as typed by the user.
+ * @fuzzy        : %TRUE to match the terms as subsequences.
+ *
+ * Compiles @search_query into a matcher which can be used to test a
+ * large amount of display names against it. The query is split on
+ * whitespace into terms, all of which must match for a name to match.
+ * The name terms are normalized with thunar_g_utf8_normalize_for_search().
+ *
+ * Terms of the form "key:value" filter on file attributes instead, see
+ * thunar_search_matcher_match_info(). Supported are "size:" with an
+ * optional comparison and a K, M, G or T suffix ("size:>100M"),
+ * "modified:" with an age in m (minutes), h, d, w, M (months) or y or
+ * a YYYY-MM-DD date ("modified:<7d"), "type:" with dir, file or link
+ * and "ext:" with a comma separated list of extensions ("ext:jpg,png").
+ * An age without a comparison means within that time ("modified:7d"),
+ * while "=" only works with dates, which stand for the whole day.
+ *
+ * If @fuzzy is %TRUE, the characters of a term only have to appear in
+ * the same order in a name, and thunar_search_matcher_score() ranks
+ * how well they do.
+ *
+ * The matcher is immutable once created, so it may be used from the
+ * search job thread and the main thread at the same time.
+ *
+ * Return value: (transfer full): a new #ThunarSearchMatcher or %NULL
+ *               if @search_query is not valid UTF-8. Free it with
+ *               thunar_search_matcher_free().
+ **/
+ThunarSearchMatcher *
+thunar_search_matcher_new (const gchar *search_query,
+                           gboolean     fuzzy)
+{
+  ThunarSearchMatcher  *matcher;
+  ThunarSearchTerm      term;
+  ThunarSearchPredicate predicate;
+  GArray               *terms;
+  GArray               *predicates;
+  GString              *name_terms;
+  gint64                now;
+  gchar                *normalized;
+  gchar                *text;
+  const gchar          *start;
+  const gchar          *p;
+  gsize                 length;
+
+  _thunar_return_val_if_fail (search_query != NULL, NULL);
+
+  if (G_UNLIKELY (!g_utf8_validate (search_query, -1, NULL)))
+    return NULL;
+
+  /* pick the predicates from the query as typed */
+  predicates = g_array_new (FALSE, FALSE, sizeof (ThunarSearchPredicate));
+  name_terms = g_string_new (NULL);
+  now = g_get_real_time () / G_USEC_PER_SEC;
+  for (p = search_query; (start = thunar_search_matcher_next_term (&p, &length)) != NULL;)
+    {
+      text = g_strndup (start, length);
+      if (thunar_search_matcher_parse_predicate (text, now, &predicate))
+        g_array_append_val (predicates, predicate);
+      else
+        g_string_append_printf (name_terms, "%s ", text);
+      g_free (text);
+    }
+
+  /* only the remaining terms are matched against names, so only they
+   * are normalized and case folded; they are valid UTF-8 by now */
+  normalized = thunar_g_utf8_normalize_for_search (name_terms->str, TRUE, TRUE);
+  g_string_free (name_terms, TRUE);
+  _thunar_assert (normalized != NULL);
+
+  /* split them on whitespace, dropping empty terms */
+  terms = g_array_new (FALSE, FALSE, sizeof (ThunarSearchTerm));
+  for (p = normalized; (start = thunar_search_matcher_next_term (&p, &term.length)) != NULL;)
+    {
+      term.text = g_strndup (start, term.length);
+      g_array_append_val (terms, term);
+    }
+  g_free (normalized);
+
+  g_array_sort (terms, thunar_search_matcher_term_compare);
+
+  matcher = g_slice_new0 (ThunarSearchMatcher);
+  matcher->fuzzy = fuzzy;
+  matcher->ascii_only = TRUE;
+  for (guint n = 0; n < terms->len; n++)
+    if (!thunar_search_matcher_is_ascii (g_array_index (terms, ThunarSearchTerm, n).text))
+      matcher->ascii_only = FALSE;
+
+  matcher->n_terms = terms->len;
+  matcher->terms = (ThunarSearchTerm *) (gpointer) g_array_free (terms, FALSE);
+  matcher->n_predicates = predicates->len;
+  matcher->predicates = (ThunarSearchPredicate *) (gpointer) g_array_free (predicates, FALSE);
+
+  return matcher;
+}
+
+
+
+/**
+ * thunar_search_matcher_free:
+ * @matcher : a #ThunarSearchMatcher or %NULL.
+ *
+ * Releases all resources held by @matcher.
+ **/
+void
+thunar_search_matcher_free (ThunarSearchMatcher *matcher)
+{
+  if (matcher == NULL)
+    return;
+
+  for (guint n = 0; n < matcher->n_terms; n++)
+    g_free (matcher->terms[n].text);
+  g_free (matcher->terms);
+
+  for (guint n = 0; n < matcher->n_predicates; n++)
+    g_strfreev (matcher->predicates[n].extensions);
+  g_free (matcher->predicates);
+
+  g_slice_free (ThunarSearchMatcher, matcher);
+}
+
+
+
+/**
+ * thunar_search_matcher_is_fuzzy:
+ * @matcher : a #ThunarSearchMatcher.
+ *
+ * Return value: %TRUE if @matcher ranks names by fuzzy matching.
+ **/
+gboolean
+thunar_search_matcher_is_fuzzy (const ThunarSearchMatcher *matcher)
+{
+  _thunar_return_val_if_fail (matcher != NULL, FALSE);
+  return matcher->fuzzy;
+}
+
+
+
+/**
+ * thunar_search_matcher_has_predicates:
+ * @matcher : a #ThunarSearchMatcher.
+ *
+ * Return value: %TRUE if the query of @matcher contained attribute
+ *               predicates which thunar_search_matcher_match_info() checks.
+ **/
+gboolean
+thunar_search_matcher_has_predicates (const ThunarSearchMatcher *matcher)
+{
+  _thunar_return_val_if_fail (matcher != NULL, FALSE);
+  return matcher->n_predicates > 0;
+}
+
+
+
+static inline gboolean
+thunar_search_matcher_compare (ThunarSearchComparison comparison,
+                               guint64                value,
+                               guint64                reference)
+{
+  switch (comparison)
+    {
+    case COMPARE_LESS: return value < reference;
+    case COMPARE_LESS_EQUAL: return value <= reference;
+    case COMPARE_EQUAL: return value == reference;
+    case COMPARE_GREATER_EQUAL: return value >= reference;
+    case COMPARE_GREATER: return value > reference;
+    }
+
+  return FALSE;
+}
+
+
+
+static gboolean
+thunar_search_matcher_match_modified (const ThunarSearchPredicate *predicate,
+                                      guint64                      mtime)
+{
+  /* relative ages are single points in time */
+  if (predicate->value_end == 0)
+    return thunar_search_matcher_compare (predicate->comparison, mtime, predicate->value);
+
+  /* whole days: "<" is before the day, "<=" is until its end etc. */
+  switch (predicate->comparison)
+    {
+    case COMPARE_LESS: return mtime < predicate->value;
+    case COMPARE_LESS_EQUAL: return mtime < predicate->value_end;
+    case COMPARE_EQUAL: return mtime >= predicate->value && mtime < predicate->value_end;
+    case COMPARE_GREATER_EQUAL: return mtime >= predicate->value;
+    case COMPARE_GREATER: return mtime >= predicate->value_end;
+    }
+
+  return FALSE;
+}
+
+
+
+static gboolean
+thunar_search_matcher_match_extension (const ThunarSearchPredicate *predicate,
+                                       const gchar                 *name)
+{
+  const gchar *dot;
+
+  dot = strrchr (name, '.');
+  if (dot == NULL || dot == name)
+    return FALSE;
+
+  for (guint n = 0; predicate->extensions[n] != NULL; n++)
+    if (g_ascii_strcasecmp (dot + 1, predicate->extensions[n]) == 0)
+      return TRUE;
+
+  return FALSE;
+}
+
+
+
+/**
+ * thunar_search_matcher_match_info:
+ * @matcher : a #ThunarSearchMatcher.
+ * @info    : the #GFileInfo of a candidate, queried with at least
+ *            %THUNAR_SEARCH_MATCHER_ATTRIBUTES.
+ *
+ * Checks the attribute predicates of @matcher against @info. This only
+ * needs the file info, so the search job can drop candidates before a
+ * #GFile or #ThunarFile is created for them.
+ *
+ * Return value: %TRUE if all predicates hold, or there are none.
+ **/
+gboolean
+thunar_search_matcher_match_info (const ThunarSearchMatcher *matcher,
+                                  GFileInfo                 *info)
+{
+  const ThunarSearchPredicate *predicate;
+  GFileType                    type;
+  gboolean                     matched = TRUE;
+
+  _thunar_return_val_if_fail (matcher != NULL, FALSE);
+
+  if (matcher->n_predicates == 0)
+    return TRUE;
+
+  _thunar_return_val_if_fail (G_IS_FILE_INFO (info), FALSE);
+
+  for (guint n = 0; matched && n < matcher->n_predicates; n++)
+    {
+      predicate = &matcher->predicates[n];
+      switch (predicate->kind)
+        {
+        case PREDICATE_SIZE:
+          /* folders have no meaningful size */
+          type = g_file_info_get_file_type (info);
+          matched = type != G_FILE_TYPE_DIRECTORY
+                    && thunar_search_matcher_compare (predicate->comparison,
+                                                      g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_STANDARD_SIZE),
+                                                      predicate->value);
+          break;
+
+        case PREDICATE_MODIFIED:
+          matched = g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_TIME_MODIFIED)
+                    && thunar_search_matcher_match_modified (predicate, g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED));
+          break;
+
+        case PREDICATE_TYPE:
+          matched = g_file_info_get_file_type (info) == predicate->type;
+          break;
+
+        case PREDICATE_EXTENSION:
+          matched = g_file_info_get_file_type (info) != G_FILE_TYPE_DIRECTORY
+                    && thunar_search_matcher_match_extension (predicate, g_file_info_get_display_name (info));
+          break;
+        }
+    }
+
+  return matched;
+}
+
+
+
+static inline gboolean
+thunar_search_matcher_match_terms (const ThunarSearchMatcher *matcher,
+                                   const gchar               *haystack,
+                                   gsize                      length)
+{
+  const ThunarSearchTerm *term;
+
+  for (guint n = 0; n < matcher->n_terms; n++)
+    {
+      term = &matcher->terms[n];
+
+      /* terms are sorted by length, so no shorter one can match either */
+      if (term->length > length)
+        return FALSE;
+
+      /* single byte terms only need the memchr() scan, the libc strstr()
+       * uses the same vectorized first-byte filter for the longer ones */
+      if (term->length == 1)
+        {
+          if (memchr (haystack, term->text[0], length) == NULL)
+            return FALSE;
+        }
+      else if (strstr (haystack, term->text) == NULL)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+
+
+static inline gint
+thunar_search_matcher_bonus (const gchar *haystack,
+                             const gchar *original,
+                             const gchar *position)
+{
+  gsize offset;
+
+  if (position == haystack)
+    return BONUS_START;
+
+  /* start of a word, e.g. after a space, dash, underscore or dot */
+  if (!g_unichar_isalnum (g_utf8_get_char (g_utf8_prev_char (position))))
+    return BONUS_BOUNDARY;
+
+  /* camelCase humps are only known if the name was plain ASCII,
+   * since only then the case folded offsets match the original */
+  if (original != NULL)
+    {
+      offset = position - haystack;
+      if (g_ascii_isupper (original[offset]) && g_ascii_islower (original[offset - 1]))
+        return BONUS_CAMEL_CASE;
+    }
+
+  return 0;
+}
+
+
+
+static gint
+thunar_search_matcher_fuzzy_score_term (const ThunarSearchTerm *term,
+                                        const gchar            *haystack,
+                                        const gchar            *original)
+{
+  const gchar *h;
+  const gchar *t;
+  const gchar *start;
+  const gchar *end;
+  gint         score = 0;
+  gint         consecutive = 0;
+
+  /* forward pass: find where the first complete subsequence ends */
+  for (h = haystack, t = term->text; *h != '\0' && *t != '\0'; h = g_utf8_next_char (h))
+    if (g_utf8_get_char (h) == g_utf8_get_char (t))
+      t = g_utf8_next_char (t);
+
+  if (*t != '\0')
+    return -1;
+  end = h;
+
+  /* backward pass: narrow it down to the shortest window ending there */
+  for (t = term->text + term->length; t > term->text;)
+    {
+      h = g_utf8_prev_char (h);
+      if (g_utf8_get_char (h) == g_utf8_get_char (g_utf8_prev_char (t)))
+        t = g_utf8_prev_char (t);
+    }
+  start = h;
+
+  /* score the window, rewarding consecutive and word start matches */
+  for (h = start, t = term->text; h < end; h = g_utf8_next_char (h))
+    {
+      if (*t != '\0' && g_utf8_get_char (h) == g_utf8_get_char (t))
+        {
+          score += SCORE_MATCH + thunar_search_matcher_bonus (haystack, original, h);
+          if (consecutive > 0)
+            score += BONUS_CONSECUTIVE;
+          consecutive++;
+          t = g_utf8_next_char (t);
+        }
+      else
+        {
+          score -= (consecutive > 0) ? PENALTY_GAP_START : PENALTY_GAP_EXTENSION;
+          consecutive = 0;
+        }
+    }
+
+  return MAX (score, 0);
+}
+
+
+
+static inline gint
+thunar_search_matcher_score_haystack (const ThunarSearchMatcher *matcher,
+                                      const gchar               *haystack,
+                                      gsize                      length,
+                                      const gchar               *original)
+{
+  gint score = 0;
+  gint term_score;
+
+  if (!matcher->fuzzy)
+    return thunar_search_matcher_match_terms (matcher, haystack, length) ? 0 : -1;
+
+  for (guint n = 0; n < matcher->n_terms; n++)
+    {
+      if (matcher->terms[n].length > length)
+        return -1;
+
+      term_score = thunar_search_matcher_fuzzy_score_term (&matcher->terms[n], haystack, original);
+      if (term_score < 0)
+        return -1;
+      score += term_score;
+    }
+
+  return score;
+}
+
+
+
+/**
+ * thunar_search_matcher_score:
+ * @matcher      : a #ThunarSearchMatcher.
+ * @display_name : the display name to test, as returned by the file info.
+ *
+ * Checks whether all terms of @matcher are found in @display_name and
+ * ranks the match. Without fuzzy matching every match scores 0.
+ *
+ * Names which are plain ASCII (the vast majority) are case folded into
+ * a stack buffer and matched directly, since normalizing an ASCII
+ * string only lowers its case. Only other names are passed through
+ * thunar_g_utf8_normalize_for_search(), so scoring an ASCII name never
+ * allocates.
+ *
+ * Return value: the score of @display_name, higher is better, or -1
+ *               if it does not match.
+ **/
+gint
+thunar_search_matcher_score (const ThunarSearchMatcher *matcher,
+                             const gchar               *display_name)
+{
+  gchar  buffer[NAME_BUFFER_SIZE];
+  gchar *normalized;
+  gint   score;
+  gsize  n;
+  guchar c;
+
+  _thunar_return_val_if_fail (matcher != NULL, -1);
+  _thunar_return_val_if_fail (display_name != NULL, -1);
+
+  if (matcher->n_terms == 0)
+    return 0;
+
+  /* try the ASCII fast path */
+  for (n = 0; n < sizeof (buffer); n++)
+    {
+      c = display_name[n];
+      if (c == '\0' || c >= 0x80)
+        break;
+      buffer[n] = g_ascii_tolower (c);
+    }
+
+  if (G_LIKELY (n < sizeof (buffer) && display_name[n] == '\0'))
+    {
+      /* a term with non-ASCII characters can never match an ASCII name */
+      if (!matcher->ascii_only)
+        return -1;
+
+      buffer[n] = '\0';
+      return thunar_search_matcher_score_haystack (matcher, buffer, n, display_name);
+    }
+
+  /* non-ASCII or very long name, normalize it first */
+  normalized = thunar_g_utf8_normalize_for_search (display_name, TRUE, TRUE);
+  if (G_UNLIKELY (normalized == NULL))
+    return -1;
+
+  score = thunar_search_matcher_score_haystack (matcher, normalized, strlen (normalized), NULL);
+  g_free (normalized);
+
+  return score;
+}
+
+
+
+/**
+ * thunar_search_matcher_match:
+ * @matcher      : a #ThunarSearchMatcher.
+ * @display_name : the display name to test, as returned by the file info.
+ *
+ * Checks whether all terms of @matcher are found in @display_name.
+ * See thunar_search_matcher_score() for details.
+ *
+ * Return value: %TRUE if all terms matched, %FALSE otherwise.
+ **/
+gboolean
+thunar_search_matcher_match (const ThunarSearchMatcher *matcher,
+                             const gchar               *display_name)
+{
+  return thunar_search_matcher_score (matcher, display_name) >= 0;
+}
+
+
+
+/**
+ * thunar_search_matcher_get_overlap:
+ * @matcher : a #ThunarSearchMatcher.
+ *
+ * Returns the number of bytes at the end of a chunk which have to be
+ * passed again at the start of the next one to thunar_search_matcher_match_contents(),
+ * so that no term is missed if it straddles two chunks.
+ *
+ * Return value: the overlap between two chunks in bytes.
+ **/
+gsize
+thunar_search_matcher_get_overlap (const ThunarSearchMatcher *matcher)
+{
+  _thunar_return_val_if_fail (matcher != NULL, 0);
+
+  /* terms are sorted by length */
+  return (matcher->n_terms > 0) ? matcher->terms[0].length - 1 : 0;
+}
+
+
+
+static const gchar *
+thunar_search_matcher_find (const gchar            *haystack,
+                            gsize                   length,
+                            const ThunarSearchTerm *term)
+{
+  const gchar *end = haystack + length - term->length;
+  const gchar *p;
+
+  for (p = haystack; p <= end; p++)
+    {
+      p = memchr (p, term->text[0], end - p + 1);
+      if (p == NULL)
+        return NULL;
+      if (memcmp (p + 1, term->text + 1, term->length - 1) == 0)
+        return p;
+    }
+
+  return NULL;
+}
+
+
+
+/**
+ * thunar_search_matcher_match_contents:
+ * @matcher     : a #ThunarSearchMatcher.
+ * @chunk       : a chunk of the file contents, lowered in place.
+ * @length      : the length of @chunk in bytes.
+ * @found_terms : bitmask of the terms found in previous chunks of
+ *                the same file, 0 for the first chunk.
+ *
+ * Looks for the terms of @matcher in @chunk, which is the next part of a
+ * file read in pieces. Terms are always matched as plain substrings, even
+ * for a fuzzy @matcher. Only ASCII letters are matched case insensitively,
+ * and since the terms are normalized, terms with diacritics are only found
+ * in their normalized form.
+ *
+ * Chunks have to overlap by thunar_search_matcher_get_overlap() bytes.
+ *
+ * Return value: %TRUE once all terms were found in the file.
+ **/
+gboolean
+thunar_search_matcher_match_contents (const ThunarSearchMatcher *matcher,
+                                      gchar                     *chunk,
+                                      gsize                      length,
+                                      guint64                   *found_terms)
+{
+  guint64 all_terms;
+
+  _thunar_return_val_if_fail (matcher != NULL, FALSE);
+  _thunar_return_val_if_fail (found_terms != NULL, FALSE);
+
+  /* the bitmask can only track that many terms */
+  if (matcher->n_terms == 0 || matcher->n_terms > 64)
+    return FALSE;
+
+  for (gsize n = 0; n < length; n++)
+    chunk[n] = g_ascii_tolower (chunk[n]);
+
+  all_terms = (matcher->n_terms == 64) ? G_MAXUINT64 : (G_GUINT64_CONSTANT (1) << matcher->n_terms) - 1;
+  for (guint n = 0; n < matcher->n_terms; n++)
+    {
+      if ((*found_terms & (G_GUINT64_CONSTANT (1) << n)) != 0 || matcher->terms[n].length > length)
+        continue;
+
+      if (thunar_search_matcher_find (chunk, length, &matcher->terms[n]) != NULL)
+        *found_terms |= G_GUINT64_CONSTANT (1) << n;
+    }
+
+  return *found_terms == all_terms;
+}
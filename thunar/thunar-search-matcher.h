@@ -0,0 +1,62 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * Copyright (c) 2024 The Thunar development team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __THUNAR_SEARCH_MATCHER_H__
+#define __THUNAR_SEARCH_MATCHER_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS;
+
+typedef struct _ThunarSearchMatcher ThunarSearchMatcher;
+
+/* the attributes thunar_search_matcher_match_info() needs in the file info */
+#define THUNAR_SEARCH_MATCHER_ATTRIBUTES \
+  G_FILE_ATTRIBUTE_STANDARD_TYPE "," G_FILE_ATTRIBUTE_STANDARD_SIZE "," G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME "," G_FILE_ATTRIBUTE_TIME_MODIFIED
+
+ThunarSearchMatcher *
+thunar_search_matcher_new (const gchar *search_query,
+                           gboolean     fuzzy);
+void
+thunar_search_matcher_free (ThunarSearchMatcher *matcher);
+gboolean
+thunar_search_matcher_is_fuzzy (const ThunarSearchMatcher *matcher);
+gboolean
+thunar_search_matcher_has_predicates (const ThunarSearchMatcher *matcher);
+gboolean
+thunar_search_matcher_match_info (const ThunarSearchMatcher *matcher,
+                                  GFileInfo                 *info);
+gint
+thunar_search_matcher_score (const ThunarSearchMatcher *matcher,
+                             const gchar               *display_name);
+gboolean
+thunar_search_matcher_match (const ThunarSearchMatcher *matcher,
+                             const gchar               *display_name);
+gsize
+thunar_search_matcher_get_overlap (const ThunarSearchMatcher *matcher);
+gboolean
+thunar_search_matcher_match_contents (const ThunarSearchMatcher *matcher,
+                                      gchar                     *chunk,
+                                      gsize                      length,
+                                      guint64                   *found_terms);
+
+G_END_DECLS;
+
+#endif /* !__THUNAR_SEARCH_MATCHER_H__ */
@@ -81,6 +81,7 @@ thunar_size_label_status_update (ThunarDeepCountJob *job,
                                  guint               file_count,
                                  guint               directory_count,
                                  guint               unreadable_directory_count,
+                                 guint               pruned_directory_count,
                                  ThunarSizeLabel    *size_label);
 static GList *
 thunar_size_label_get_files (ThunarSizeLabel *size_label);
@@ -439,6 +440,7 @@ thunar_size_label_status_update (ThunarDeepCountJob *job,
                                  guint               file_count,
                                  guint               directory_count,
                                  guint               unreadable_directory_count,
+                                 guint               pruned_directory_count,
                                  ThunarSizeLabel    *size_label)
 {
   gchar *size_string;
@@ -447,6 +449,7 @@ thunar_size_label_status_update (ThunarDeepCountJob *job,
   gchar *text;
   guint  n;
   gchar *unreable_text;
+  gchar *pruned_text;
 
   _thunar_return_if_fail (THUNAR_IS_DEEP_COUNT_JOB (job));
   _thunar_return_if_fail (THUNAR_IS_SIZE_LABEL (size_label));
@@ -495,6 +498,16 @@ thunar_size_label_status_update (ThunarDeepCountJob *job,
           text = unreable_text;
         }
 
+      if (pruned_directory_count > 0)
+        {
+          /* TRANSLATORS: this is shown if folders were not counted because
+           * of the prune rules, e.g. because they match "misc-prune-patterns" */
+          pruned_text = g_strdup_printf (ngettext ("%s\n(%u folder skipped)", "%s\n(%u folders skipped)", pruned_directory_count),
+                                         text, pruned_directory_count);
+          g_free (text);
+          text = pruned_text;
+        }
+
       gtk_label_set_text (GTK_LABEL (size_label->label), text);
       g_free (text);
     }
@@ -225,8 +225,8 @@ thunar_standard_view_model_class_init (gpointer klass)
 
       /**
        * ThunarStandardViewModel::search-done:
-       * @store : a #ThunarStandardViewModel.
-       * @error : a #GError that describes the problem.
+       * @store    : a #ThunarStandardViewModel.
+       * @n_pruned : the number of folders the prune rules left out.
        *
        * Emitted when a recursive search finishes.
        **/
@@ -237,7 +237,7 @@ thunar_standard_view_model_class_init (gpointer klass)
                     G_STRUCT_OFFSET (ThunarStandardViewModelIface, search_done),
                     NULL, NULL,
                     NULL,
-                    G_TYPE_NONE, 0);
+                    G_TYPE_NONE, 1, G_TYPE_UINT);
     }
 }
 
@@ -440,6 +440,20 @@ thunar_standard_view_model_set_job (ThunarStandardViewModel *model,
 
 
 
+/**
+ * thunar_standard_view_model_add_search_files:
+ * @model : a #ThunarStandardViewModel.
+ * @files : a #GList of #ThunarFile<!---->s.
+ *
+ * Adds @files to the search results. This is called from the search
+ * job, not from the main thread, so implementations only queue @files
+ * under a lock and insert them from the main thread later on. The job
+ * makes one call at a time, even though it searches file contents in
+ * several threads.
+ *
+ * The model takes over the references on @files, the list stays with
+ * the caller.
+ **/
 void
 thunar_standard_view_model_add_search_files (ThunarStandardViewModel *model,
                                              GList                   *files)
@@ -450,6 +464,29 @@ thunar_standard_view_model_add_search_files (ThunarStandardViewModel *model,
 
 
 
+/**
+ * thunar_standard_view_model_remove_search_files:
+ * @model : a #ThunarStandardViewModel.
+ * @files : a #GList of #ThunarFile<!---->s.
+ *
+ * Takes @files out of the search results again, e.g. because the
+ * search found better ranked files. Like
+ * thunar_standard_view_model_add_search_files(), this is called from
+ * the search job and only queues the change for the main thread.
+ * Files which are still queued to be added are simply dropped.
+ *
+ * The caller keeps its references on @files and the list.
+ **/
+void
+thunar_standard_view_model_remove_search_files (ThunarStandardViewModel *model,
+                                                GList                   *files)
+{
+  _thunar_return_if_fail (THUNAR_IS_STANDARD_VIEW_MODEL (model));
+  return (*THUNAR_STANDARD_VIEW_MODEL_GET_IFACE (model)->remove_search_files) (model, files);
+}
+
+
+
 static gboolean
 _thunar_standard_view_model_match_pattern_foreach (GtkTreeModel *model,
                                                    GtkTreePath  *path,
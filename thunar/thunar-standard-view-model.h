@@ -87,7 +87,8 @@ struct _ThunarStandardViewModelIface
   /* signals */
   void (*error) (ThunarStandardViewModel *model,
                  const GError            *error);
-  void (*search_done) (void);
+  void (*search_done) (ThunarStandardViewModel *model,
+                       guint                    n_pruned);
 
   /* virtual methods */
   ThunarFolder *(*get_folder) (ThunarStandardViewModel *model);
@@ -114,6 +115,8 @@ struct _ThunarStandardViewModelIface
                    ThunarJob               *job);
   void (*add_search_files) (ThunarStandardViewModel *model,
                             GList                   *files);
+  void (*remove_search_files) (ThunarStandardViewModel *model,
+                               GList                   *files);
 };
 
 GType
@@ -165,6 +168,9 @@ thunar_standard_view_model_set_job (ThunarStandardViewModel *model,
 void
 thunar_standard_view_model_add_search_files (ThunarStandardViewModel *model,
                                              GList                   *files);
+void
+thunar_standard_view_model_remove_search_files (ThunarStandardViewModel *model,
+                                                GList                   *files);
 
 G_END_DECLS;
 
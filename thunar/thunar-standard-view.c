@@ -311,6 +311,7 @@ thunar_standard_view_error (ThunarStandardViewModel *model,
                             ThunarStandardView      *standard_view);
 static void
 thunar_standard_view_search_done (ThunarStandardViewModel *model,
+                                  guint                    n_pruned,
                                   ThunarStandardView      *standard_view);
 static void
 thunar_standard_view_sort_column_changed (GtkTreeSortable    *tree_sortable,
@@ -463,6 +464,9 @@ struct _ThunarStandardViewPrivate
    * we don't want to show the spinner when the search query is empty (i.e. "") */
   gboolean active_search;
 
+  /* number of folders the prune rules left out of the last search, shown in the statusbar */
+  guint search_n_pruned;
+
   /* used to restore the view type after a search is completed */
   GType type;
 
@@ -3875,6 +3879,7 @@ thunar_standard_view_error (ThunarStandardViewModel *model,
 
 static void
 thunar_standard_view_search_done (ThunarStandardViewModel *model,
+                                  guint                    n_pruned,
                                   ThunarStandardView      *standard_view)
 {
   _thunar_return_if_fail (THUNAR_IS_STANDARD_VIEW_MODEL (model));
@@ -3883,6 +3888,13 @@ thunar_standard_view_search_done (ThunarStandardViewModel *model,
 
   standard_view->priv->active_search = FALSE;
 
+  /* let the statusbar tell how much the search left out */
+  if (standard_view->priv->search_n_pruned != n_pruned)
+    {
+      standard_view->priv->search_n_pruned = n_pruned;
+      thunar_standard_view_update_statusbar_text (standard_view);
+    }
+
   /* notify listeners */
   g_object_notify_by_pspec (G_OBJECT (standard_view), standard_view_props[PROP_SEARCHING]);
 }
@@ -4610,11 +4622,12 @@ thunar_standard_view_set_searching (ThunarStandardView *standard_view,
     return;
 
   if (standard_view->priv->search_query != NULL && search_query == NULL)
-    thunar_standard_view_search_done (standard_view->model, standard_view);
+    thunar_standard_view_search_done (standard_view->model, 0, standard_view);
 
   /* save the new query (used for switching between views) */
   g_free (standard_view->priv->search_query);
   standard_view->priv->search_query = g_strdup (search_query);
+  standard_view->priv->search_n_pruned = 0;
 
   /* initiate the search */
   /* set_folder() can emit a large number of row-deleted signals for large folders,
@@ -4672,6 +4685,28 @@ thunar_standard_view_get_search_query (ThunarStandardView *standard_view)
 
 
 
+/**
+ * thunar_standard_view_get_search_n_pruned:
+ * @standard_view : a #ThunarStandardView.
+ *
+ * Returns the number of folders the prune rules left out of the
+ * last finished search, or 0 if there is no search result shown.
+ *
+ * Return value: the number of pruned folders.
+ **/
+guint
+thunar_standard_view_get_search_n_pruned (ThunarStandardView *standard_view)
+{
+  _thunar_return_val_if_fail (THUNAR_IS_STANDARD_VIEW (standard_view), 0);
+
+  if (standard_view->priv->search_query == NULL)
+    return 0;
+
+  return standard_view->priv->search_n_pruned;
+}
+
+
+
 void
 thunar_standard_view_save_view_type (ThunarStandardView *standard_view,
                                      GType               type)
@@ -34,6 +34,16 @@
 #define _thumbnail_cache_lock(cache) g_mutex_lock (&((cache)->lock))
 #define _thumbnail_cache_unlock(cache) g_mutex_unlock (&((cache)->lock))
 
+/* number of queued files from which a queue is processed right away,
+ * instead of waiting for the files to stop coming */
+#define THUMBNAIL_CACHE_MAX_QUEUED (10000)
+
+/* number of URIs sent to the cache service in one call */
+#define THUMBNAIL_CACHE_CHUNK_SIZE (1000)
+
+/* the timeout to process a queue in, if it holds @n_queued files */
+#define _thumbnail_cache_interval(n_queued, interval) ((n_queued) >= THUMBNAIL_CACHE_MAX_QUEUED ? 0 : (interval))
+
 
 
 static void
@@ -62,16 +72,20 @@ struct _ThunarThumbnailCache
 
   GList *move_source_queue;
   GList *move_target_queue;
+  guint  move_queue_length;
   guint  move_queue_idle_id;
 
   GList *copy_source_queue;
   GList *copy_target_queue;
+  guint  copy_queue_length;
   guint  copy_queue_idle_id;
 
   GList *delete_queue;
+  guint  delete_queue_length;
   guint  delete_queue_idle_id;
 
   GList *cleanup_queue;
+  guint  cleanup_queue_length;
   guint  cleanup_queue_idle_id;
 
   GMutex lock;
@@ -287,10 +301,10 @@ thunar_thumbnail_cache_process_queue (ThunarThumbnailCache *cache,
   GList  *tp;
   gchar **source_uris;
   gchar **target_uris;
-  guint   n_uris;
   guint   n;
   GList  *source_queue;
   GList  *target_queue;
+  GList  *chunk_targets = NULL;
 
   _thunar_return_val_if_fail (THUNAR_IS_THUMBNAIL_CACHE (cache), FALSE);
 
@@ -304,6 +318,7 @@ thunar_thumbnail_cache_process_queue (ThunarThumbnailCache *cache,
       cache->copy_source_queue = NULL;
       target_queue = cache->copy_target_queue;
       cache->copy_target_queue = NULL;
+      cache->copy_queue_length = 0;
     }
   else
     {
@@ -311,56 +326,66 @@ thunar_thumbnail_cache_process_queue (ThunarThumbnailCache *cache,
       cache->move_source_queue = NULL;
       target_queue = cache->move_target_queue;
       cache->move_target_queue = NULL;
+      cache->move_queue_length = 0;
     }
 
-  /* compute how many URIs there are */
-  n_uris = g_list_length (source_queue);
+  /* allocate string arrays for one chunk of URIs */
+  source_uris = g_new0 (gchar *, THUMBNAIL_CACHE_CHUNK_SIZE + 1);
+  target_uris = g_new0 (gchar *, THUMBNAIL_CACHE_CHUNK_SIZE + 1);
 
-  /* allocate a string array for the URIs */
-  source_uris = g_new0 (gchar *, n_uris + 1);
-  target_uris = g_new0 (gchar *, n_uris + 1);
-
-  /* fill URI array with file URIs from the move queue */
+  /* fill URI arrays with file URIs from the queue, oldest first */
   for (n = 0,
       sp = g_list_last (source_queue),
       tp = g_list_last (target_queue);
        sp != NULL && tp != NULL;
-       sp = sp->prev, tp = tp->prev, ++n)
+       sp = sp->prev, tp = tp->prev)
     {
       source_uris[n] = g_file_get_uri (sp->data);
       target_uris[n] = g_file_get_uri (tp->data);
 
-      /* release the source object */
+      /* release the source object, the target goes to the reply */
       g_object_unref (sp->data);
-    }
+      chunk_targets = g_list_prepend (chunk_targets, tp->data);
 
-  /* NULL-terminate the URI arrays */
-  source_uris[n] = NULL;
-  target_uris[n] = NULL;
+      /* send the chunk once it is full or the queue is done */
+      if (++n < THUMBNAIL_CACHE_CHUNK_SIZE && sp->prev != NULL && tp->prev != NULL)
+        continue;
 
-  if (copy_async)
-    {
-      /* asynchronously copy the thumbnails */
-      thunar_thumbnail_cache_copy_async (cache,
-                                         (const gchar **) source_uris,
-                                         (const gchar **) target_uris,
-                                         target_queue);
-    }
-  else
-    {
-      /* asynchronously move the thumbnails */
-      thunar_thumbnail_cache_move_async (cache,
-                                         (const gchar **) source_uris,
-                                         (const gchar **) target_uris,
-                                         target_queue);
+      if (copy_async)
+        {
+          /* asynchronously copy the thumbnails */
+          thunar_thumbnail_cache_copy_async (cache,
+                                             (const gchar **) source_uris,
+                                             (const gchar **) target_uris,
+                                             chunk_targets);
+        }
+      else
+        {
+          /* asynchronously move the thumbnails */
+          thunar_thumbnail_cache_move_async (cache,
+                                             (const gchar **) source_uris,
+                                             (const gchar **) target_uris,
+                                             chunk_targets);
+        }
+
+      /* clear the URI arrays for the next chunk */
+      for (; n > 0; n--)
+        {
+          g_free (source_uris[n - 1]);
+          g_free (target_uris[n - 1]);
+          source_uris[n - 1] = NULL;
+          target_uris[n - 1] = NULL;
+        }
+      chunk_targets = NULL;
     }
 
   /* free the URI arrays */
-  g_strfreev (source_uris);
-  g_strfreev (target_uris);
+  g_free (source_uris);
+  g_free (target_uris);
 
-  /* release the move queue lists */
+  /* release the queue lists */
   g_list_free (source_queue);
+  g_list_free (target_queue);
 
   /* release the cache lock */
   _thumbnail_cache_unlock (cache);
@@ -402,47 +427,73 @@ thunar_thumbnail_cache_process_copy_queue_destroy (gpointer user_data)
 
 
 
-static gboolean
-thunar_thumbnail_cache_process_delete_queue (gpointer user_data)
+/* Sends the URIs of @queue, oldest first, in chunks to the cache service
+ * and releases the queue */
+static void
+thunar_thumbnail_cache_send_queue (ThunarThumbnailCache *cache,
+                                   GList                *queue,
+                                   gboolean              cleanup)
 {
-  ThunarThumbnailCache *cache = user_data;
-  GList                *lp;
-  gchar               **uris;
-  guint                 n_uris;
-  guint                 n;
-
-  _thunar_return_val_if_fail (THUNAR_IS_THUMBNAIL_CACHE (cache), FALSE);
-
-  /* acquire a cache lock */
-  _thumbnail_cache_lock (cache);
+  GList  *lp;
+  gchar **uris;
+  guint   n = 0;
 
-  /* compute how many URIs there are */
-  n_uris = g_list_length (cache->delete_queue);
+  /* allocate a string array for one chunk of URIs */
+  uris = g_new0 (gchar *, THUMBNAIL_CACHE_CHUNK_SIZE + 1);
 
-  /* allocate a string array for the URIs */
-  uris = g_new0 (gchar *, n_uris + 1);
-
-  /* fill URI array with file URIs from the delete queue */
-  for (lp = g_list_last (cache->delete_queue), n = 0; lp != NULL; lp = lp->prev, ++n)
+  for (lp = g_list_last (queue); lp != NULL; lp = lp->prev)
     {
       uris[n] = g_file_get_uri (lp->data);
 
+#ifndef NDEBUG
+      if (cleanup)
+        g_debug ("cleanup: %s", uris[n]);
+#endif
+
       /* release the file object */
       g_object_unref (lp->data);
-    }
 
-  /* NULL-terminate the URI array */
-  uris[n] = NULL;
+      /* send the chunk once it is full or the queue is done */
+      if (++n < THUMBNAIL_CACHE_CHUNK_SIZE && lp->prev != NULL)
+        continue;
+
+      /* asynchronously delete or cleanup the thumbnails */
+      if (cleanup)
+        thunar_thumbnail_cache_cleanup_async (cache, (const gchar *const *) uris);
+      else
+        thunar_thumbnail_cache_delete_async (cache, (const gchar **) uris);
 
-  /* asynchronously delete the thumbnails */
-  thunar_thumbnail_cache_delete_async (cache, (const gchar **) uris);
+      /* clear the URI array for the next chunk */
+      for (; n > 0; n--)
+        {
+          g_free (uris[n - 1]);
+          uris[n - 1] = NULL;
+        }
+    }
 
   /* free the URI array */
-  g_strfreev (uris);
+  g_free (uris);
+
+  /* release the queue list */
+  g_list_free (queue);
+}
+
+
 
-  /* release the delete queue list */
-  g_list_free (cache->delete_queue);
+static gboolean
+thunar_thumbnail_cache_process_delete_queue (gpointer user_data)
+{
+  ThunarThumbnailCache *cache = user_data;
+
+  _thunar_return_val_if_fail (THUNAR_IS_THUMBNAIL_CACHE (cache), FALSE);
+
+  /* acquire a cache lock */
+  _thumbnail_cache_lock (cache);
+
+  /* send and release the delete queue */
+  thunar_thumbnail_cache_send_queue (cache, cache->delete_queue, FALSE);
   cache->delete_queue = NULL;
+  cache->delete_queue_length = 0;
 
   /* reset the delete queue idle ID */
   cache->delete_queue_idle_id = 0;
@@ -459,51 +510,16 @@ static gboolean
 thunar_thumbnail_cache_process_cleanup_queue (gpointer user_data)
 {
   ThunarThumbnailCache *cache = user_data;
-  GList                *lp;
-  gchar               **uris;
-  guint                 n_uris;
-  guint                 n;
 
   _thunar_return_val_if_fail (THUNAR_IS_THUMBNAIL_CACHE (cache), FALSE);
 
   /* acquire a cache lock */
   _thumbnail_cache_lock (cache);
 
-  /* compute how many URIs there are */
-  n_uris = g_list_length (cache->cleanup_queue);
-
-  /* allocate a string array for the URIs */
-  uris = g_new0 (gchar *, n_uris + 1);
-
-#ifndef NDEBUG
-  g_debug ("cleanup:");
-#endif
-
-  /* fill URI array with file URIs from the cleanup queue */
-  for (lp = g_list_last (cache->cleanup_queue), n = 0; lp != NULL; lp = lp->prev, ++n)
-    {
-      uris[n] = g_file_get_uri (lp->data);
-
-#ifndef NDEBUG
-      g_debug ("  %s", uris[n]);
-#endif
-
-      /* release the file object */
-      g_object_unref (lp->data);
-    }
-
-  /* NULL-terminate the URI array */
-  uris[n] = NULL;
-
-  /* asynchronously cleanup the thumbnails */
-  thunar_thumbnail_cache_cleanup_async (cache, (const gchar *const *) uris);
-
-  /* free the URI array */
-  g_strfreev (uris);
-
-  /* release the cleanup queue list */
-  g_list_free (cache->cleanup_queue);
+  /* send and release the cleanup queue */
+  thunar_thumbnail_cache_send_queue (cache, cache->cleanup_queue, TRUE);
   cache->cleanup_queue = NULL;
+  cache->cleanup_queue_length = 0;
 
   /* reset the cleanup queue idle ID */
   cache->cleanup_queue_idle_id = 0;
@@ -564,6 +580,7 @@ thunar_thumbnail_cache_move_file (ThunarThumbnailCache *cache,
                                                  g_object_ref (source_file));
       cache->move_target_queue = g_list_prepend (cache->move_target_queue,
                                                  g_object_ref (target_file));
+      cache->move_queue_length++;
     }
 
   if (cache->proxy_state == THUNAR_THUMBNAIL_CACHE_PROXY_AVAILABLE)
@@ -575,9 +592,10 @@ thunar_thumbnail_cache_move_file (ThunarThumbnailCache *cache,
           cache->move_queue_idle_id = 0;
         }
 
-      /* process the move queue in a 250ms timeout */
+      /* process the move queue in a 250ms timeout, or right away if it grew long */
       cache->move_queue_idle_id =
-      g_timeout_add_full (G_PRIORITY_DEFAULT_IDLE, 250, thunar_thumbnail_cache_process_move_queue,
+      g_timeout_add_full (G_PRIORITY_DEFAULT_IDLE, _thumbnail_cache_interval (cache->move_queue_length, 250),
+                          thunar_thumbnail_cache_process_move_queue,
                           cache, thunar_thumbnail_cache_process_move_queue_destroy);
     }
 
@@ -624,6 +642,7 @@ thunar_thumbnail_cache_copy_file (ThunarThumbnailCache *cache,
                                                  g_object_ref (source_file));
       cache->copy_target_queue = g_list_prepend (cache->copy_target_queue,
                                                  g_object_ref (target_file));
+      cache->copy_queue_length++;
     }
 
   if (cache->proxy_state == THUNAR_THUMBNAIL_CACHE_PROXY_AVAILABLE)
@@ -635,9 +654,10 @@ thunar_thumbnail_cache_copy_file (ThunarThumbnailCache *cache,
           cache->copy_queue_idle_id = 0;
         }
 
-      /* process the copy queue in a 250ms timeout */
+      /* process the copy queue in a 500ms timeout, or right away if it grew long */
       cache->copy_queue_idle_id =
-      g_timeout_add_full (G_PRIORITY_DEFAULT_IDLE, 500, thunar_thumbnail_cache_process_copy_queue,
+      g_timeout_add_full (G_PRIORITY_DEFAULT_IDLE, _thumbnail_cache_interval (cache->copy_queue_length, 500),
+                          thunar_thumbnail_cache_process_copy_queue,
                           cache, thunar_thumbnail_cache_process_copy_queue_destroy);
     }
 
@@ -662,6 +682,7 @@ thunar_thumbnail_cache_delete_file (ThunarThumbnailCache *cache,
     {
       /* add the file to the delete queue */
       cache->delete_queue = g_list_prepend (cache->delete_queue, g_object_ref (file));
+      cache->delete_queue_length++;
     }
 
   if (cache->proxy_state == THUNAR_THUMBNAIL_CACHE_PROXY_AVAILABLE)
@@ -673,9 +694,10 @@ thunar_thumbnail_cache_delete_file (ThunarThumbnailCache *cache,
           cache->delete_queue_idle_id = 0;
         }
 
-      /* process the delete queue in a 250ms timeout */
+      /* process the delete queue in a 500ms timeout, or right away if it grew long */
       cache->delete_queue_idle_id =
-      g_timeout_add (500, thunar_thumbnail_cache_process_delete_queue, cache);
+      g_timeout_add (_thumbnail_cache_interval (cache->delete_queue_length, 500),
+                     thunar_thumbnail_cache_process_delete_queue, cache);
     }
 
   /* release the cache lock */
@@ -699,6 +721,7 @@ thunar_thumbnail_cache_cleanup_file (ThunarThumbnailCache *cache,
     {
       /* add the file to the cleanup queue */
       cache->cleanup_queue = g_list_prepend (cache->cleanup_queue, g_object_ref (file));
+      cache->cleanup_queue_length++;
     }
 
   if (cache->proxy_state == THUNAR_THUMBNAIL_CACHE_PROXY_AVAILABLE)
@@ -710,9 +733,10 @@ thunar_thumbnail_cache_cleanup_file (ThunarThumbnailCache *cache,
           cache->cleanup_queue_idle_id = 0;
         }
 
-      /* process the cleanup queue in a 250ms timeout */
+      /* process the cleanup queue in a 1s timeout, or right away if it grew long */
       cache->cleanup_queue_idle_id =
-      g_timeout_add (1000, thunar_thumbnail_cache_process_cleanup_queue, cache);
+      g_timeout_add (_thumbnail_cache_interval (cache->cleanup_queue_length, 1000),
+                     thunar_thumbnail_cache_process_cleanup_queue, cache);
     }
 
   /* release the cache lock */
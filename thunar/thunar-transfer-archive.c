@@ -0,0 +1,607 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * Copyright (c) 2024 The Thunar development team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Copying a directory with many small files to a SFTP location pays
+ * several round trips per file. If the host can be reached with ssh
+ * directly, the directory is instead packed into a tar stream which is
+ * unpacked on the remote host in one go:
+ *
+ *   ssh -o BatchMode=yes host 'echo && exec tar -x -k -p -f - -C <target parent>'
+ *
+ * BatchMode makes ssh fail instead of asking for a password. The stream is
+ * only written once the remote side announced itself with the echo, so if
+ * ssh fails nothing was transferred and the copy is left to gvfs. The stream
+ * is written in the GNU tar format, which both GNU tar and bsdtar read. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef HAVE_SIGNAL_H
+#include <signal.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include "thunar/thunar-private.h"
+#include "thunar/thunar-transfer-archive.h"
+
+#include <libxfce4util/libxfce4util.h>
+
+
+
+#define ARCHIVE_BLOCK_SIZE  (512)
+#define ARCHIVE_BUFFER_SIZE (1024 * 256)
+
+/* attributes needed to write the header of an archive entry */
+#define ARCHIVE_ATTRIBUTES                                       \
+  G_FILE_ATTRIBUTE_STANDARD_TYPE "," G_FILE_ATTRIBUTE_STANDARD_NAME "," \
+  G_FILE_ATTRIBUTE_STANDARD_SIZE "," G_FILE_ATTRIBUTE_STANDARD_SYMLINK_TARGET "," \
+  G_FILE_ATTRIBUTE_TIME_MODIFIED "," G_FILE_ATTRIBUTE_UNIX_MODE
+
+/* ssh exits with this status if the connection failed */
+#define SSH_EXIT_STATUS_ERROR (255)
+
+
+
+typedef struct
+{
+  gchar name[100];
+  gchar mode[8];
+  gchar uid[8];
+  gchar gid[8];
+  gchar size[12];
+  gchar mtime[12];
+  gchar checksum[8];
+  gchar typeflag;
+  gchar linkname[100];
+  gchar magic[8];
+  gchar uname[32];
+  gchar gname[32];
+  gchar devmajor[8];
+  gchar devminor[8];
+  gchar prefix[155];
+  gchar padding[12];
+} ThunarTransferArchiveHeader;
+
+G_STATIC_ASSERT (sizeof (ThunarTransferArchiveHeader) == ARCHIVE_BLOCK_SIZE);
+
+typedef struct
+{
+  GOutputStream        *stream;
+  GCancellable         *cancellable;
+  GFileProgressCallback progress_callback;
+  gpointer              progress_callback_data;
+  goffset               copied;
+  guchar               *buffer;
+
+  /* everything written to the pipe, including headers */
+  goffset               written;
+} ThunarTransferArchive;
+
+
+
+/**
+ * thunar_transfer_archive_is_supported:
+ * @target_file : the target of a copy.
+ *
+ * Return value: %TRUE if @target_file is on a SFTP location and ssh
+ *               is available to stream files to it.
+ **/
+gboolean
+thunar_transfer_archive_is_supported (GFile *target_file)
+{
+  gchar *ssh_path;
+
+  _thunar_return_val_if_fail (G_IS_FILE (target_file), FALSE);
+
+  if (!g_file_has_uri_scheme (target_file, "sftp"))
+    return FALSE;
+
+  ssh_path = g_find_program_in_path ("ssh");
+  g_free (ssh_path);
+
+  return ssh_path != NULL;
+}
+
+
+
+/* Returns the ssh command line which unpacks a tar stream next to
+ * @target_file on the remote host, or %NULL */
+static gchar **
+thunar_transfer_archive_get_command (GFile *target_file)
+{
+  GPtrArray *argv;
+  GUri      *uri;
+  gchar     *uri_string;
+  gchar     *path;
+  gchar     *parent_path;
+  gchar     *quoted_path;
+
+  uri_string = g_file_get_uri (target_file);
+  uri = g_uri_parse (uri_string, G_URI_FLAGS_ENCODED_PATH, NULL);
+  g_free (uri_string);
+
+  if (uri == NULL)
+    return NULL;
+
+  /* the path is percent-encoded in the uri, an encoded '/' is not a path on the remote host */
+  path = g_uri_unescape_string (g_uri_get_path (uri), "/");
+  if (g_strcmp0 (g_uri_get_scheme (uri), "sftp") != 0 || g_uri_get_host (uri) == NULL || path == NULL)
+    {
+      g_free (path);
+      g_uri_unref (uri);
+      return NULL;
+    }
+
+  argv = g_ptr_array_new ();
+  g_ptr_array_add (argv, g_strdup ("ssh"));
+  g_ptr_array_add (argv, g_strdup ("-o"));
+  g_ptr_array_add (argv, g_strdup ("BatchMode=yes"));
+
+  if (g_uri_get_port (uri) > 0)
+    {
+      g_ptr_array_add (argv, g_strdup ("-p"));
+      g_ptr_array_add (argv, g_strdup_printf ("%d", g_uri_get_port (uri)));
+    }
+
+  if (g_uri_get_user (uri) != NULL)
+    {
+      g_ptr_array_add (argv, g_strdup ("-l"));
+      g_ptr_array_add (argv, g_strdup (g_uri_get_user (uri)));
+    }
+
+  g_ptr_array_add (argv, g_strdup ("--"));
+  g_ptr_array_add (argv, g_strdup (g_uri_get_host (uri)));
+
+  /* refuse to replace existing files, conflicts are left to the user */
+  parent_path = g_path_get_dirname (path);
+  quoted_path = g_shell_quote (parent_path);
+  g_ptr_array_add (argv, g_strdup_printf ("echo && exec tar -x -k -p -f - -C %s", quoted_path));
+  g_free (quoted_path);
+  g_free (parent_path);
+  g_free (path);
+
+  g_ptr_array_add (argv, NULL);
+  g_uri_unref (uri);
+
+  return (gchar **) g_ptr_array_free (argv, FALSE);
+}
+
+
+
+/* Stores @value as octal number in a header field, or base-256 encoded
+ * (a GNU extension) if it is too large for that */
+static void
+thunar_transfer_archive_set_number (gchar  *field,
+                                    gsize   length,
+                                    guint64 value)
+{
+  gsize n;
+
+  if ((length - 1) * 3 >= 64 || value < (G_GUINT64_CONSTANT (1) << ((length - 1) * 3)))
+    {
+      g_snprintf (field, length, "%0*" G_GINT64_MODIFIER "o", (gint) (length - 1), value);
+      return;
+    }
+
+  field[0] = (gchar) 0x80;
+  for (n = length - 1; n > 0; n--, value >>= 8)
+    field[n] = (gchar) (value & 0xff);
+}
+
+
+
+static gboolean
+thunar_transfer_archive_write (ThunarTransferArchive *archive,
+                               const void            *data,
+                               gsize                  length,
+                               GError               **error)
+{
+  gsize    bytes_written = 0;
+  gboolean succeed;
+
+  succeed = g_output_stream_write_all (archive->stream, data, length, &bytes_written, archive->cancellable, error);
+  archive->written += bytes_written;
+
+  return succeed;
+}
+
+
+
+static gboolean
+thunar_transfer_archive_write_block_header (ThunarTransferArchive *archive,
+                                            const gchar           *name,
+                                            gchar                  typeflag,
+                                            guint32                mode,
+                                            guint64                size,
+                                            guint64                mtime,
+                                            const gchar           *linkname,
+                                            GError               **error)
+{
+  ThunarTransferArchiveHeader header;
+  const guchar               *bytes = (const guchar *) &header;
+  guint                       checksum = 0;
+  gsize                       n;
+
+  memset (&header, 0, sizeof (header));
+
+  strncpy (header.name, name, sizeof (header.name));
+  thunar_transfer_archive_set_number (header.mode, sizeof (header.mode), mode);
+  thunar_transfer_archive_set_number (header.uid, sizeof (header.uid), 0);
+  thunar_transfer_archive_set_number (header.gid, sizeof (header.gid), 0);
+  thunar_transfer_archive_set_number (header.size, sizeof (header.size), size);
+  thunar_transfer_archive_set_number (header.mtime, sizeof (header.mtime), mtime);
+  header.typeflag = typeflag;
+  if (linkname != NULL)
+    strncpy (header.linkname, linkname, sizeof (header.linkname));
+
+  /* GNU format, magic and version share the field */
+  memcpy (header.magic, "ustar  ", sizeof (header.magic));
+
+  /* the checksum is computed with the checksum field set to spaces */
+  memset (header.checksum, ' ', sizeof (header.checksum));
+  for (n = 0; n < sizeof (header); n++)
+    checksum += bytes[n];
+  g_snprintf (header.checksum, sizeof (header.checksum) - 1, "%06o", checksum);
+
+  return thunar_transfer_archive_write (archive, &header, sizeof (header), error);
+}
+
+
+
+/* Pads the data of an entry of @size bytes to the block size */
+static gboolean
+thunar_transfer_archive_write_padding (ThunarTransferArchive *archive,
+                                       guint64                size,
+                                       GError               **error)
+{
+  static const guchar zeros[ARCHIVE_BLOCK_SIZE] = { 0, };
+  gsize               remainder = size % ARCHIVE_BLOCK_SIZE;
+
+  if (remainder == 0)
+    return TRUE;
+
+  return thunar_transfer_archive_write (archive, zeros, ARCHIVE_BLOCK_SIZE - remainder, error);
+}
+
+
+
+/* Writes an entry holding a name which doesn't fit into a header */
+static gboolean
+thunar_transfer_archive_write_long_name (ThunarTransferArchive *archive,
+                                         gchar                  typeflag,
+                                         const gchar           *name,
+                                         GError               **error)
+{
+  gsize length = strlen (name) + 1;
+
+  return thunar_transfer_archive_write_block_header (archive, "././@LongLink", typeflag, 0, length, 0, NULL, error)
+         && thunar_transfer_archive_write (archive, name, length, error)
+         && thunar_transfer_archive_write_padding (archive, length, error);
+}
+
+
+
+static gboolean
+thunar_transfer_archive_write_header (ThunarTransferArchive *archive,
+                                      const gchar           *name,
+                                      gchar                  typeflag,
+                                      guint32                mode,
+                                      guint64                size,
+                                      guint64                mtime,
+                                      const gchar           *linkname,
+                                      GError               **error)
+{
+  if (strlen (name) >= G_SIZEOF_MEMBER (ThunarTransferArchiveHeader, name)
+      && !thunar_transfer_archive_write_long_name (archive, 'L', name, error))
+    return FALSE;
+
+  if (linkname != NULL && strlen (linkname) >= G_SIZEOF_MEMBER (ThunarTransferArchiveHeader, linkname)
+      && !thunar_transfer_archive_write_long_name (archive, 'K', linkname, error))
+    return FALSE;
+
+  return thunar_transfer_archive_write_block_header (archive, name, typeflag, mode, size, mtime, linkname, error);
+}
+
+
+
+static gboolean
+thunar_transfer_archive_write_contents (ThunarTransferArchive *archive,
+                                        GFile                 *file,
+                                        guint64                size,
+                                        GError               **error)
+{
+  GFileInputStream *input;
+  guint64           remaining = size;
+  gssize            n;
+
+  input = g_file_read (file, archive->cancellable, error);
+  if (input == NULL)
+    return FALSE;
+
+  while (remaining > 0)
+    {
+      n = g_input_stream_read (G_INPUT_STREAM (input), archive->buffer, MIN (remaining, ARCHIVE_BUFFER_SIZE),
+                               archive->cancellable, error);
+      if (n < 0)
+        break;
+
+      /* the header already announced the size, the stream would be corrupt */
+      if (n == 0)
+        {
+          g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                       _("The file \"%s\" was truncated while copying"), g_file_peek_path (file));
+          break;
+        }
+
+      if (!thunar_transfer_archive_write (archive, archive->buffer, n, error))
+        break;
+
+      remaining -= n;
+      archive->copied += n;
+
+      /* the total size of the stream is not known */
+      if (archive->progress_callback != NULL)
+        archive->progress_callback (archive->copied, 0, archive->progress_callback_data);
+    }
+
+  g_object_unref (input);
+
+  return remaining == 0 && thunar_transfer_archive_write_padding (archive, size, error);
+}
+
+
+
+static gboolean
+thunar_transfer_archive_add_file (ThunarTransferArchive *archive,
+                                  GFile                 *file,
+                                  GFileInfo             *info,
+                                  const gchar           *name,
+                                  GError               **error)
+{
+  GFileEnumerator *enumerator;
+  GFileInfo       *child_info;
+  GFile           *child_file;
+  GError          *err = NULL;
+  gchar           *dir_name;
+  gchar           *child_name;
+  guint32          mode;
+  guint64          mtime;
+  guint64          size;
+
+  mode = g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_MODE) & 07777;
+  mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+
+  switch (g_file_info_get_file_type (info))
+    {
+    case G_FILE_TYPE_DIRECTORY:
+      enumerator = g_file_enumerate_children (file, ARCHIVE_ATTRIBUTES, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                              archive->cancellable, error);
+      if (enumerator == NULL)
+        return FALSE;
+
+      dir_name = g_strconcat (name, "/", NULL);
+      if (thunar_transfer_archive_write_header (archive, dir_name, '5', mode != 0 ? mode : 0755, 0, mtime, NULL, &err))
+        {
+          while (err == NULL && (child_info = g_file_enumerator_next_file (enumerator, archive->cancellable, &err)) != NULL)
+            {
+              child_file = g_file_enumerator_get_child (enumerator, child_info);
+              child_name = g_strconcat (dir_name, g_file_info_get_name (child_info), NULL);
+
+              thunar_transfer_archive_add_file (archive, child_file, child_info, child_name, &err);
+
+              g_free (child_name);
+              g_object_unref (child_file);
+              g_object_unref (child_info);
+            }
+        }
+      g_free (dir_name);
+      g_object_unref (enumerator);
+
+      if (err != NULL)
+        {
+          g_propagate_error (error, err);
+          return FALSE;
+        }
+      return TRUE;
+
+    case G_FILE_TYPE_SYMBOLIC_LINK:
+      return thunar_transfer_archive_write_header (archive, name, '2', 0777, 0, mtime,
+                                                   g_file_info_get_symlink_target (info), error);
+
+    case G_FILE_TYPE_REGULAR:
+      size = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_STANDARD_SIZE);
+      return thunar_transfer_archive_write_header (archive, name, '0', mode != 0 ? mode : 0644, size, mtime, NULL, error)
+             && thunar_transfer_archive_write_contents (archive, file, size, error);
+
+    default:
+      /* like g_file_copy() */
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                   _("Cannot copy special file \"%s\""), g_file_peek_path (file));
+      return FALSE;
+    }
+}
+
+
+
+/* Writing to the pipe after ssh exited raises SIGPIPE, which terminates the
+ * process unless it is ignored. Block it in the calling thread instead,
+ * so the write fails with EPIPE */
+static void
+thunar_transfer_archive_block_sigpipe (sigset_t *old_mask)
+{
+  sigset_t mask;
+
+  sigemptyset (&mask);
+  sigaddset (&mask, SIGPIPE);
+  pthread_sigmask (SIG_BLOCK, &mask, old_mask);
+}
+
+
+
+static void
+thunar_transfer_archive_unblock_sigpipe (const sigset_t *old_mask)
+{
+  static const struct timespec no_wait = { 0, 0 };
+  sigset_t                     mask;
+
+  /* the mask was set by someone else, leave pending signals to them */
+  if (sigismember (old_mask, SIGPIPE))
+    return;
+
+  /* drop the SIGPIPE raised by a failed write, before it is delivered */
+  sigemptyset (&mask);
+  sigaddset (&mask, SIGPIPE);
+  while (sigtimedwait (&mask, NULL, &no_wait) == SIGPIPE)
+    ;
+
+  pthread_sigmask (SIG_SETMASK, old_mask, NULL);
+}
+
+
+
+/* Waits for the line the remote command echoes before unpacking, so
+ * nothing is written to the pipe if ssh can not connect */
+static gboolean
+thunar_transfer_archive_wait_for_remote (GSubprocess  *subprocess,
+                                         GCancellable *cancellable)
+{
+  gchar c;
+
+  return g_input_stream_read (g_subprocess_get_stdout_pipe (subprocess), &c, 1, cancellable, NULL) == 1;
+}
+
+
+
+/**
+ * thunar_transfer_archive_copy:
+ * @source_file            : a local directory.
+ * @target_file            : a SFTP location, which must not exist yet.
+ * @cancellable            : (nullable): a #GCancellable.
+ * @progress_callback      : (nullable): called with the number of copied bytes.
+ * @progress_callback_data : user data for @progress_callback.
+ * @success                : return location for the result of the copy.
+ * @error                  : return location for errors.
+ *
+ * Copies @source_file and everything below it to @target_file by
+ * streaming a tar archive to the remote host over ssh.
+ *
+ * Return value: %FALSE if the host could not be reached and the copy
+ *               should be done file by file instead, otherwise the
+ *               result is stored in @success.
+ **/
+gboolean
+thunar_transfer_archive_copy (GFile                *source_file,
+                              GFile                *target_file,
+                              GCancellable         *cancellable,
+                              GFileProgressCallback progress_callback,
+                              gpointer              progress_callback_data,
+                              gboolean             *success,
+                              GError              **error)
+{
+  static const guchar   end_of_archive[2 * ARCHIVE_BLOCK_SIZE] = { 0, };
+  ThunarTransferArchive archive;
+  GSubprocess          *subprocess;
+  GFileInfo            *info;
+  GError               *err = NULL;
+  sigset_t              old_mask;
+  gchar               **argv;
+  gchar                *name;
+  gint                  exit_status;
+
+  _thunar_return_val_if_fail (G_IS_FILE (source_file), FALSE);
+  _thunar_return_val_if_fail (G_IS_FILE (target_file), FALSE);
+  _thunar_return_val_if_fail (success != NULL, FALSE);
+
+  argv = thunar_transfer_archive_get_command (target_file);
+  if (argv == NULL)
+    return FALSE;
+
+  info = g_file_query_info (source_file, ARCHIVE_ATTRIBUTES, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, cancellable, NULL);
+  if (info == NULL)
+    {
+      g_strfreev (argv);
+      return FALSE;
+    }
+
+  subprocess = g_subprocess_newv ((const gchar *const *) argv,
+                                  G_SUBPROCESS_FLAGS_STDIN_PIPE | G_SUBPROCESS_FLAGS_STDOUT_PIPE | G_SUBPROCESS_FLAGS_STDERR_SILENCE,
+                                  NULL);
+  g_strfreev (argv);
+
+  if (subprocess == NULL)
+    {
+      g_object_unref (info);
+      return FALSE;
+    }
+
+  archive.stream = g_subprocess_get_stdin_pipe (subprocess);
+  archive.cancellable = cancellable;
+  archive.progress_callback = progress_callback;
+  archive.progress_callback_data = progress_callback_data;
+  archive.copied = 0;
+  archive.written = 0;
+  archive.buffer = g_malloc (ARCHIVE_BUFFER_SIZE);
+
+  thunar_transfer_archive_block_sigpipe (&old_mask);
+
+  if (thunar_transfer_archive_wait_for_remote (subprocess, cancellable))
+    {
+      name = g_file_get_basename (target_file);
+      if (thunar_transfer_archive_add_file (&archive, source_file, info, name, &err))
+        thunar_transfer_archive_write (&archive, end_of_archive, sizeof (end_of_archive), &err);
+      g_free (name);
+    }
+
+  g_output_stream_close (archive.stream, NULL, NULL);
+
+  /* don't leave the remote side waiting for more */
+  if (g_cancellable_is_cancelled (cancellable))
+    g_subprocess_force_exit (subprocess);
+  g_subprocess_wait (subprocess, NULL, NULL);
+
+  thunar_transfer_archive_unblock_sigpipe (&old_mask);
+
+  exit_status = g_subprocess_get_if_exited (subprocess) ? g_subprocess_get_exit_status (subprocess) : -1;
+  if (err == NULL && exit_status != 0)
+    {
+      g_set_error (&err, G_IO_ERROR, G_IO_ERROR_FAILED,
+                   _("Failed to unpack the files on the remote host (exit status %d)"), exit_status);
+    }
+
+  g_object_unref (subprocess);
+  g_object_unref (info);
+  g_free (archive.buffer);
+
+  /* ssh could not connect, so nothing was written on the remote host */
+  if (exit_status == SSH_EXIT_STATUS_ERROR && archive.written == 0 && !g_cancellable_is_cancelled (cancellable))
+    {
+      g_clear_error (&err);
+      return FALSE;
+    }
+
+  if (err != NULL)
+    g_propagate_error (error, err);
+
+  *success = (err == NULL);
+  return TRUE;
+}
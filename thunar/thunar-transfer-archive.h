@@ -0,0 +1,41 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * Copyright (c) 2024 The Thunar development team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __THUNAR_TRANSFER_ARCHIVE_H__
+#define __THUNAR_TRANSFER_ARCHIVE_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS;
+
+gboolean
+thunar_transfer_archive_is_supported (GFile *target_file);
+gboolean
+thunar_transfer_archive_copy (GFile                *source_file,
+                              GFile                *target_file,
+                              GCancellable         *cancellable,
+                              GFileProgressCallback progress_callback,
+                              gpointer              progress_callback_data,
+                              gboolean             *success,
+                              GError              **error);
+
+G_END_DECLS;
+
+#endif /* !__THUNAR_TRANSFER_ARCHIVE_H__ */
@@ -32,15 +32,38 @@
 #include "thunar/thunar-preferences.h"
 #include "thunar/thunar-private.h"
 #include "thunar/thunar-thumbnail-cache.h"
+#include "thunar/thunar-transfer-archive.h"
 #include "thunar/thunar-transfer-job.h"
+#include "thunar/thunar-transfer-journal.h"
+#include "thunar/thunar-transfer-rate.h"
 
 #include <gio/gio.h>
+#include <glib/gstdio.h>
 
 
 
 /* seconds before we show the transfer rate + remaining time */
 #define MINIMUM_TRANSFER_TIME (2 * G_USEC_PER_SEC) /* 2 seconds */
 
+/* number of worker threads copying regular files in parallel */
+#define MAX_COPY_WORKERS 8
+
+/* number of regular files handed to the workers but not yet collected by the job */
+#define MAX_QUEUED_LEAVES (4 * MAX_COPY_WORKERS)
+
+/* number of copied files of a move whose source is not deleted yet */
+#define MAX_QUEUED_DELETES (8 * MAX_QUEUED_LEAVES)
+
+/* time to wait for the size of the source files before copying
+ * starts anyway, so small copies still check the free space first */
+#define COUNT_WAIT_TIME (1 * G_TIME_SPAN_SECOND)
+
+/* attributes needed to sum up the size of the source files */
+#define COUNT_ATTRIBUTES G_FILE_ATTRIBUTE_STANDARD_TYPE "," G_FILE_ATTRIBUTE_STANDARD_SIZE
+
+/* how long the free space of a cached filesystem info is trusted */
+#define FREE_SPACE_MAX_AGE (1 * G_TIME_SPAN_SECOND)
+
 
 
 /* Property identifiers */
@@ -49,13 +72,21 @@ enum
   PROP_0,
   PROP_FILE_SIZE_BINARY,
   PROP_PARALLEL_COPY_MODE,
+  PROP_TRANSFER_MAX_JOBS_PER_DEVICE,
   PROP_TRANSFER_USE_PARTIAL,
   PROP_TRANSFER_VERIFY_FILE,
+  PROP_TRANSFER_VERIFY_CHECKSUM_FILE,
+  PROP_TRANSFER_SKIP_UNCHANGED,
+  PROP_TRANSFER_BUFFER_SIZE,
+  PROP_TRANSFER_DIRECT_IO,
+  PROP_TRANSFER_ARCHIVE_MODE,
 };
 
 
 
+typedef struct _ThunarTransferInfo ThunarTransferInfo;
 typedef struct _ThunarTransferNode ThunarTransferNode;
+typedef struct _ThunarTransferLeaf ThunarTransferLeaf;
 
 
 
@@ -78,6 +109,15 @@ thunar_transfer_job_execute (ExoJob  *job,
                              GError **error);
 static void
 thunar_transfer_node_free (gpointer data);
+static void
+thunar_transfer_fs_info_free (gpointer data);
+static gboolean
+thunar_transfer_job_verify_counted_destination (ThunarTransferJob *transfer_job,
+                                                GError           **error);
+static void
+thunar_transfer_job_mount_changed (GVolumeMonitor *monitor,
+                                   GMount         *mount,
+                                   gpointer        user_data);
 
 
 
@@ -98,20 +138,75 @@ struct _ThunarTransferJob
   gchar                *target_device_fs_id;
   gboolean              is_target_device_local;
 
-  gint64  start_time;          /* us(microseconds) */
-  gint64  last_update_time;    /* us */
-  guint64 last_total_progress; /* byte */
+  gint64 start_time;       /* us(microseconds) */
+  gint64 start_wait_time;  /* us the job waited before the transfer started */
+  gint64 last_update_time; /* us */
 
-  guint64 total_size;     /* byte */
+  guint64 total_size;     /* byte, grows while total_size_known is FALSE */
   guint64 total_progress; /* byte */
+  guint64 total_files;    /* grows like total_size */
+  guint64 files_progress; /* completed files */
+  guint64 n_skipped_files; /* unchanged files which were not copied */
+  guint64 skipped_size;    /* byte, size of the skipped files */
   guint64 file_progress;  /* byte */
-  guint64 transfer_rate;  /* byte/s */
+  guint64 percentage;     /* last one emitted */
+
+  /* estimates the rate and the remaining time from the progress, the
+   * results are copied for the UI, which must not touch the estimator */
+  ThunarTransferRate *rate;
+  guint64             transfer_rate;  /* byte/s */
+  gint64              remaining_time; /* s, -1 if unknown */
+
+  ThunarPreferences      *preferences;
+  gboolean                file_size_binary;
+  ThunarParallelCopyMode  parallel_copy_mode;
+  guint                   transfer_max_jobs_per_device;
+  ThunarUsePartialMode    transfer_use_partial;
+  ThunarVerifyFileMode    transfer_verify_file;
+  gboolean                transfer_verify_checksum_file;
+  ThunarSkipUnchangedMode transfer_skip_unchanged;
+  guint                   transfer_buffer_size; /* KiB */
+  gboolean                transfer_direct_io;
+  gboolean                transfer_archive_mode;
+
+  /* pool copying regular files in parallel, the mutex protects
+   * the leaf queues and total_progress while the pool is running */
+  GThreadPool *copy_pool;
+  GMutex       leaf_mutex;
+  GCond        leaf_cond;
+  guint        n_pending_leaves;
+  GList       *finished_leaves;
+  GList       *failed_leaves;
+  gint64       last_leaf_message_time; /* us */
+
+  /* worker deleting the sources of a move right after they were copied,
+   * n_pending_deletes and failed_deletes are protected by the leaf mutex.
+   * the source directories are deleted by the job thread at the end */
+  GThreadPool *delete_pool;
+  guint        n_pending_deletes;
+  GList       *failed_deletes;
+  GList       *source_directories;
+
+  /* records the copied files so an interrupted copy can be resumed */
+  ThunarTransferJournal *journal;
+
+  /* sums up the size of the source files while copying, total_size
+   * and total_size_known are protected by the leaf mutex meanwhile */
+  GThread *count_thread;
+  gint     count_stopped; /* atomic */
+  gboolean total_size_known;
+  gboolean destination_verified;
+};
 
-  ThunarPreferences     *preferences;
-  gboolean               file_size_binary;
-  ThunarParallelCopyMode parallel_copy_mode;
-  ThunarUsePartialMode   transfer_use_partial;
-  ThunarVerifyFileMode   transfer_verify_file;
+/* source file information gathered while collecting, so the copy
+ * does not need to query it again. file_type is G_FILE_TYPE_UNKNOWN
+ * if the node was not collected */
+struct _ThunarTransferInfo
+{
+  GFileType file_type;
+  guint64   size;       /* byte */
+  guint64   mtime;      /* s, 0 if unknown */
+  guint32   mtime_usec; /* us */
 };
 
 struct _ThunarTransferNode
@@ -121,8 +216,38 @@ struct _ThunarTransferNode
   GFile              *source_file;
   gboolean            replace_confirmed;
   gboolean            rename_confirmed;
+  ThunarTransferInfo  info;
+};
+
+struct _ThunarTransferLeaf
+{
+  ThunarTransferJob  *job;
+  ThunarJobOperation *operation;
+  GFile              *source_file;
+  GFile              *target_file;
+  GFile              *target_parent_file;
+  ThunarTransferInfo  info;
+  gboolean            explicit_target;
+  GList             **target_file_list_return;
+  guint64             file_progress;
+  GError             *error;
 };
 
+/* filesystem info of a destination, see thunar_transfer_job_query_fs_info() */
+typedef struct
+{
+  GFileInfo *info;
+  gint64     time; /* monotonic time of the query */
+} ThunarTransferFsInfo;
+
+
+
+/* filesystem info by destination filesystem, shared by all transfer
+ * jobs and forgotten whenever the mounts change */
+G_LOCK_DEFINE_STATIC (fs_info_cache);
+static GHashTable     *fs_info_cache = NULL;
+static GVolumeMonitor *fs_info_volume_monitor = NULL;
+
 
 
 G_DEFINE_TYPE (ThunarTransferJob, thunar_transfer_job, THUNAR_TYPE_JOB)
@@ -171,6 +296,19 @@ thunar_transfer_job_class_init (ThunarTransferJobClass *klass)
                                                       THUNAR_PARALLEL_COPY_MODE_ONLY_LOCAL,
                                                       EXO_PARAM_READWRITE));
 
+  /**
+   * ThunarTransferJob:transfer_max_jobs_per_device:
+   *
+   * Number of jobs which may transfer from or to the same device at once
+   **/
+  g_object_class_install_property (gobject_class,
+                                   PROP_TRANSFER_MAX_JOBS_PER_DEVICE,
+                                   g_param_spec_uint ("transfer-max-jobs-per-device",
+                                                      "TransferMaxJobsPerDevice",
+                                                      NULL,
+                                                      1u, G_MAXUINT, 1u,
+                                                      EXO_PARAM_READWRITE));
+
   /**
    * ThunarPropertiesdialog:transfer_use_partial:
    *
@@ -198,6 +336,79 @@ thunar_transfer_job_class_init (ThunarTransferJobClass *klass)
                                                       THUNAR_TYPE_VERIFY_FILE_MODE,
                                                       THUNAR_VERIFY_FILE_MODE_DISABLED,
                                                       EXO_PARAM_READWRITE));
+
+  /**
+   * ThunarTransferJob:transfer_skip_unchanged:
+   *
+   * Whether to skip copying files whose target exists unchanged
+   **/
+  g_object_class_install_property (gobject_class,
+                                   PROP_TRANSFER_SKIP_UNCHANGED,
+                                   g_param_spec_enum ("transfer-skip-unchanged",
+                                                      "TransferSkipUnchanged",
+                                                      NULL,
+                                                      THUNAR_TYPE_SKIP_UNCHANGED_MODE,
+                                                      THUNAR_SKIP_UNCHANGED_MODE_DISABLED,
+                                                      EXO_PARAM_READWRITE));
+
+  /**
+   * ThunarTransferJob:transfer_verify_checksum_file:
+   *
+   * Whether to compare verified files against their checksum file
+   **/
+  g_object_class_install_property (gobject_class,
+                                   PROP_TRANSFER_VERIFY_CHECKSUM_FILE,
+                                   g_param_spec_boolean ("transfer-verify-checksum-file",
+                                                         "TransferVerifyChecksumFile",
+                                                         NULL,
+                                                         FALSE,
+                                                         EXO_PARAM_READWRITE));
+
+  /**
+   * ThunarTransferJob:transfer_buffer_size:
+   *
+   * Number of KiB to copy at once
+   **/
+  g_object_class_install_property (gobject_class,
+                                   PROP_TRANSFER_BUFFER_SIZE,
+                                   g_param_spec_uint ("transfer-buffer-size",
+                                                      "TransferBufferSize",
+                                                      NULL,
+                                                      64u, 1024u * 1024u, 8192u,
+                                                      EXO_PARAM_READWRITE));
+
+  /**
+   * ThunarTransferJob:transfer_direct_io:
+   *
+   * Whether to copy very large local files with O_DIRECT
+   **/
+  g_object_class_install_property (gobject_class,
+                                   PROP_TRANSFER_DIRECT_IO,
+                                   g_param_spec_boolean ("transfer-direct-io",
+                                                         "TransferDirectIO",
+                                                         NULL,
+                                                         FALSE,
+                                                         EXO_PARAM_READWRITE));
+
+  /**
+   * ThunarTransferJob:transfer_archive_mode:
+   *
+   * Whether to stream folders copied to SFTP locations as tar archive
+   **/
+  g_object_class_install_property (gobject_class,
+                                   PROP_TRANSFER_ARCHIVE_MODE,
+                                   g_param_spec_boolean ("transfer-archive-mode",
+                                                         "TransferArchiveMode",
+                                                         NULL,
+                                                         FALSE,
+                                                         EXO_PARAM_READWRITE));
+
+  /* the volume monitor emits in the main loop, the jobs lock the cache */
+  fs_info_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, thunar_transfer_fs_info_free);
+  fs_info_volume_monitor = g_volume_monitor_get ();
+  g_signal_connect (fs_info_volume_monitor, "mount-added", G_CALLBACK (thunar_transfer_job_mount_changed), NULL);
+  g_signal_connect (fs_info_volume_monitor, "mount-changed", G_CALLBACK (thunar_transfer_job_mount_changed), NULL);
+  g_signal_connect (fs_info_volume_monitor, "mount-removed", G_CALLBACK (thunar_transfer_job_mount_changed), NULL);
 }
 
 
@@ -212,12 +423,30 @@ thunar_transfer_job_init (ThunarTransferJob *job)
   g_object_bind_property (job->preferences, "misc-parallel-copy-mode",
                           job, "parallel-copy-mode",
                           G_BINDING_SYNC_CREATE);
+  g_object_bind_property (job->preferences, "misc-transfer-max-jobs-per-device",
+                          job, "transfer-max-jobs-per-device",
+                          G_BINDING_SYNC_CREATE);
   g_object_bind_property (job->preferences, "misc-transfer-use-partial",
                           job, "transfer-use-partial",
                           G_BINDING_SYNC_CREATE);
   g_object_bind_property (job->preferences, "misc-transfer-verify-file",
                           job, "transfer-verify-file",
                           G_BINDING_SYNC_CREATE);
+  g_object_bind_property (job->preferences, "misc-transfer-verify-checksum-file",
+                          job, "transfer-verify-checksum-file",
+                          G_BINDING_SYNC_CREATE);
+  g_object_bind_property (job->preferences, "misc-transfer-skip-unchanged",
+                          job, "transfer-skip-unchanged",
+                          G_BINDING_SYNC_CREATE);
+  g_object_bind_property (job->preferences, "misc-transfer-buffer-size",
+                          job, "transfer-buffer-size",
+                          G_BINDING_SYNC_CREATE);
+  g_object_bind_property (job->preferences, "misc-transfer-direct-io",
+                          job, "transfer-direct-io",
+                          G_BINDING_SYNC_CREATE);
+  g_object_bind_property (job->preferences, "misc-transfer-archive-mode",
+                          job, "transfer-archive-mode",
+                          G_BINDING_SYNC_CREATE);
 
   job->type = 0;
   job->source_node_list = NULL;
@@ -229,10 +458,37 @@ thunar_transfer_job_init (ThunarTransferJob *job)
   job->total_size = 0;
   job->total_progress = 0;
   job->file_progress = 0;
+  job->total_files = 0;
+  job->files_progress = 0;
+  job->n_skipped_files = 0;
+  job->skipped_size = 0;
   job->last_update_time = 0;
-  job->last_total_progress = 0;
+  job->rate = thunar_transfer_rate_new ();
   job->transfer_rate = 0;
+  job->remaining_time = -1;
   job->start_time = 0;
+  job->start_wait_time = 0;
+
+  job->copy_pool = NULL;
+  g_mutex_init (&job->leaf_mutex);
+  g_cond_init (&job->leaf_cond);
+  job->n_pending_leaves = 0;
+  job->finished_leaves = NULL;
+  job->failed_leaves = NULL;
+  job->last_leaf_message_time = 0;
+
+  job->delete_pool = NULL;
+  job->n_pending_deletes = 0;
+  job->failed_deletes = NULL;
+  job->source_directories = NULL;
+
+  job->journal = NULL;
+
+  job->count_thread = NULL;
+  job->count_stopped = FALSE;
+  job->total_size_known = TRUE;
+  job->destination_verified = FALSE;
+  job->percentage = 0;
 }
 
 
@@ -249,6 +505,11 @@ thunar_transfer_job_finalize (GObject *object)
 
   thunar_g_list_free_full (job->target_file_list);
 
+  g_mutex_clear (&job->leaf_mutex);
+  g_cond_clear (&job->leaf_cond);
+
+  thunar_transfer_rate_free (job->rate);
+
   g_object_unref (job->preferences);
 
   (*G_OBJECT_CLASS (thunar_transfer_job_parent_class)->finalize) (object);
@@ -272,12 +533,30 @@ thunar_transfer_job_get_property (GObject    *object,
     case PROP_PARALLEL_COPY_MODE:
       g_value_set_enum (value, job->parallel_copy_mode);
       break;
+    case PROP_TRANSFER_MAX_JOBS_PER_DEVICE:
+      g_value_set_uint (value, job->transfer_max_jobs_per_device);
+      break;
     case PROP_TRANSFER_USE_PARTIAL:
       g_value_set_enum (value, job->transfer_use_partial);
       break;
     case PROP_TRANSFER_VERIFY_FILE:
       g_value_set_enum (value, job->transfer_verify_file);
       break;
+    case PROP_TRANSFER_VERIFY_CHECKSUM_FILE:
+      g_value_set_boolean (value, job->transfer_verify_checksum_file);
+      break;
+    case PROP_TRANSFER_SKIP_UNCHANGED:
+      g_value_set_enum (value, job->transfer_skip_unchanged);
+      break;
+    case PROP_TRANSFER_BUFFER_SIZE:
+      g_value_set_uint (value, job->transfer_buffer_size);
+      break;
+    case PROP_TRANSFER_DIRECT_IO:
+      g_value_set_boolean (value, job->transfer_direct_io);
+      break;
+    case PROP_TRANSFER_ARCHIVE_MODE:
+      g_value_set_boolean (value, job->transfer_archive_mode);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -302,12 +581,30 @@ thunar_transfer_job_set_property (GObject      *object,
     case PROP_PARALLEL_COPY_MODE:
       job->parallel_copy_mode = g_value_get_enum (value);
       break;
+    case PROP_TRANSFER_MAX_JOBS_PER_DEVICE:
+      job->transfer_max_jobs_per_device = g_value_get_uint (value);
+      break;
     case PROP_TRANSFER_USE_PARTIAL:
       job->transfer_use_partial = g_value_get_enum (value);
       break;
     case PROP_TRANSFER_VERIFY_FILE:
       job->transfer_verify_file = g_value_get_enum (value);
       break;
+    case PROP_TRANSFER_VERIFY_CHECKSUM_FILE:
+      job->transfer_verify_checksum_file = g_value_get_boolean (value);
+      break;
+    case PROP_TRANSFER_SKIP_UNCHANGED:
+      job->transfer_skip_unchanged = g_value_get_enum (value);
+      break;
+    case PROP_TRANSFER_BUFFER_SIZE:
+      job->transfer_buffer_size = g_value_get_uint (value);
+      break;
+    case PROP_TRANSFER_DIRECT_IO:
+      job->transfer_direct_io = g_value_get_boolean (value);
+      break;
+    case PROP_TRANSFER_ARCHIVE_MODE:
+      job->transfer_archive_mode = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -328,60 +625,158 @@ thunar_transfer_job_check_pause (ThunarTransferJob *job)
 
 
 
+static void
+thunar_transfer_job_update_progress (ThunarTransferJob *job,
+                                     gboolean           force)
+{
+  guint64  total_progress;
+  guint64  total_size;
+  guint64  total_files;
+  guint64  files_progress;
+  guint64  n_skipped_files;
+  guint64  skipped_size;
+  gboolean total_size_known;
+  guint64  new_percentage;
+  gint64   current_time;
+  gint64   expired_time;
+  gint64   active_time;
+
+  _thunar_return_if_fail (THUNAR_IS_TRANSFER_JOB (job));
+
+  /* the copy pool workers and the count thread update these concurrently */
+  g_mutex_lock (&job->leaf_mutex);
+  total_progress = job->total_progress;
+  total_size = job->total_size;
+  total_files = job->total_files;
+  files_progress = job->files_progress;
+  n_skipped_files = job->n_skipped_files;
+  skipped_size = job->skipped_size;
+  total_size_known = job->total_size_known;
+  g_mutex_unlock (&job->leaf_mutex);
+
+  if (G_UNLIKELY (total_size == 0 && total_size_known))
+    return;
+
+  /* compute the new percentage after the progress we've made. While the
+   * source files are still counted, estimate it from what was found so
+   * far, without going back or reaching the end before the count does */
+  if (total_size_known)
+    new_percentage = MIN ((total_progress * 100.0) / total_size, 100);
+  else if (total_size > 0)
+    new_percentage = MAX (job->percentage, MIN ((total_progress * 100.0) / total_size, 99));
+  else
+    new_percentage = job->percentage;
+
+  /* get current time */
+  current_time = g_get_real_time ();
+  expired_time = current_time - job->last_update_time;
+
+  /* notify callers not more then every 500ms */
+  if (expired_time > (500 * 1000) || force)
+    {
+      /* the time spent paused or in dialogs doesn't count for the rate */
+      if (job->start_time > 0)
+        {
+          active_time = current_time - job->start_time
+                        - (thunar_job_get_wait_time (THUNAR_JOB (job)) - job->start_wait_time);
+          /* skipped files took no time, they would make the rate look too good */
+          thunar_transfer_rate_add_sample (job->rate, active_time,
+                                           total_progress - skipped_size,
+                                           files_progress - n_skipped_files);
+
+          job->transfer_rate = thunar_transfer_rate_get_bytes_per_second (job->rate);
+          job->remaining_time = thunar_transfer_rate_get_remaining_time (job->rate,
+                                                                         total_size - MIN (total_progress, total_size),
+                                                                         total_files - MIN (files_progress, total_files));
+        }
+
+      /* emit the percent signal */
+      exo_job_percent (EXO_JOB (job), new_percentage);
+      job->percentage = new_percentage;
+
+      /* update internals */
+      job->last_update_time = current_time;
+    }
+}
+
+
+
 static void
 thunar_transfer_job_progress (goffset  current_num_bytes,
                               goffset  total_num_bytes,
                               gpointer user_data)
 {
   ThunarTransferJob *job = user_data;
-  guint64            new_percentage;
-  gint64             current_time;
-  gint64             expired_time;
-  guint64            transfer_rate;
 
   _thunar_return_if_fail (THUNAR_IS_TRANSFER_JOB (job));
 
   thunar_transfer_job_check_pause (job);
 
-  if (G_LIKELY (job->total_size > 0))
-    {
-      /* update total progress */
-      job->total_progress += (current_num_bytes - job->file_progress);
+  /* update total progress */
+  g_mutex_lock (&job->leaf_mutex);
+  job->total_progress += (current_num_bytes - job->file_progress);
+  g_mutex_unlock (&job->leaf_mutex);
 
-      /* update file progress */
-      job->file_progress = current_num_bytes;
+  /* update file progress */
+  job->file_progress = current_num_bytes;
 
-      /* compute the new percentage after the progress we've made */
-      new_percentage = (job->total_progress * 100.0) / job->total_size;
+  /* force update after transfer when it took more than (approx.) 500ms */
+  /* the actual code checks if (file size [byte]) > (transfer rate [byte/s]) * (0.5 [s]) */
+  /* which means that the file is bigger than what is transferred in 500ms on average */
+  thunar_transfer_job_update_progress (job, current_num_bytes == total_num_bytes
+                                            && total_num_bytes > (goffset) (job->transfer_rate / 2));
+}
 
-      /* get current time */
-      current_time = g_get_real_time ();
-      expired_time = current_time - job->last_update_time;
 
-      /* notify callers not more then every 500ms */
-      /* force update after transfer when it took more than (approx.) 500ms */
-      /* the actual code checks if (file size [byte]) > (transfer rate [byte/s]) * (0.5 [s]) */
-      /* which means that the file is bigger than what is transferred in 500ms on average */
-      if (expired_time > (500 * 1000)
-          || (current_num_bytes == total_num_bytes && total_num_bytes > (goffset) (job->transfer_rate / 2)))
-        {
-          /* calculate the transfer rate in the last expired time */
-          transfer_rate = (job->total_progress - job->last_total_progress) / ((gfloat) expired_time / G_USEC_PER_SEC);
 
-          /* take the average of the last 10 rates (5 sec), so the output is less jumpy */
-          if (job->transfer_rate > 0)
-            job->transfer_rate = ((job->transfer_rate * 10) + transfer_rate) / 11;
-          else
-            job->transfer_rate = transfer_rate;
+static void
+thunar_transfer_job_leaf_progress (goffset  current_num_bytes,
+                                   goffset  total_num_bytes,
+                                   gpointer user_data)
+{
+  ThunarTransferLeaf *leaf = user_data;
+  ThunarTransferJob  *job = leaf->job;
 
-          /* emit the percent signal */
-          exo_job_percent (EXO_JOB (job), new_percentage);
+  thunar_transfer_job_check_pause (job);
 
-          /* update internals */
-          job->last_update_time = current_time;
-          job->last_total_progress = job->total_progress;
-        }
-    }
+  /* the leaf is copied by a pool worker, only account the bytes here
+   * and leave emitting the progress to the job thread */
+  g_mutex_lock (&job->leaf_mutex);
+  job->total_progress += (current_num_bytes - leaf->file_progress);
+  g_mutex_unlock (&job->leaf_mutex);
+
+  leaf->file_progress = current_num_bytes;
+}
+
+
+
+/* Fills the info of @node, without looking at its children */
+static gboolean
+thunar_transfer_job_query_node (ThunarTransferJob  *job,
+                                ThunarTransferNode *node,
+                                GError            **error)
+{
+  GFileInfo *info;
+
+  info = g_file_query_info (node->source_file,
+                            G_FILE_ATTRIBUTE_STANDARD_SIZE "," G_FILE_ATTRIBUTE_STANDARD_TYPE ","
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED "," G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+                            G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                            exo_job_get_cancellable (EXO_JOB (job)),
+                            error);
+
+  if (G_UNLIKELY (info == NULL))
+    return FALSE;
+
+  /* remember what we need during the copy */
+  node->info.file_type = g_file_info_get_file_type (info);
+  node->info.size = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_STANDARD_SIZE);
+  node->info.mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+  node->info.mtime_usec = g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+
+  g_object_unref (info);
+
+  return TRUE;
 }
 
 
@@ -389,14 +784,70 @@ thunar_transfer_job_progress (goffset  current_num_bytes,
 static gboolean
 thunar_transfer_job_collect_node (ThunarTransferJob  *job,
                                   ThunarTransferNode *node,
-                                  GError            **error)
+                                  GError            **error);
+
+
+
+/* Creates the child nodes of the directory @node. If @recursive is %FALSE,
+ * only the immediate children are collected and failing to query one of
+ * them is left to the copy, which reports it like any other copy error */
+static gboolean
+thunar_transfer_job_collect_children (ThunarTransferJob  *job,
+                                      ThunarTransferNode *node,
+                                      gboolean            recursive,
+                                      GError            **error)
 {
   ThunarTransferNode *child_node;
-  GFileInfo          *info;
   GError             *err = NULL;
   GList              *file_list;
   GList              *lp;
 
+  /* scan the directory for immediate children */
+  file_list = thunar_io_scan_directory (THUNAR_JOB (job), node->source_file,
+                                        G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                        FALSE, FALSE, FALSE, NULL, &err);
+
+  /* add children to the transfer node */
+  for (lp = file_list; err == NULL && lp != NULL; lp = lp->next)
+    {
+      thunar_transfer_job_check_pause (job);
+
+      /* allocate a new transfer node for the child */
+      child_node = g_slice_new0 (ThunarTransferNode);
+      child_node->source_file = g_object_ref (lp->data);
+      child_node->replace_confirmed = node->replace_confirmed;
+      child_node->rename_confirmed = FALSE;
+
+      /* hook the child node into the child list */
+      child_node->next = node->children;
+      node->children = child_node;
+
+      /* collect the child node */
+      if (recursive)
+        thunar_transfer_job_collect_node (job, child_node, &err);
+      else if (!thunar_transfer_job_query_node (job, child_node, NULL))
+        exo_job_set_error_if_cancelled (EXO_JOB (job), &err);
+    }
+
+  /* release the child files */
+  thunar_g_list_free_full (file_list);
+
+  if (G_UNLIKELY (err != NULL))
+    {
+      g_propagate_error (error, err);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+
+
+static gboolean
+thunar_transfer_job_collect_node (ThunarTransferJob  *job,
+                                  ThunarTransferNode *node,
+                                  GError            **error)
+{
   _thunar_return_val_if_fail (THUNAR_IS_TRANSFER_JOB (job), FALSE);
   _thunar_return_val_if_fail (node != NULL && G_IS_FILE (node->source_file), FALSE);
   _thunar_return_val_if_fail (error == NULL || *error == NULL, FALSE);
@@ -404,104 +855,200 @@ thunar_transfer_job_collect_node (ThunarTransferJob  *job,
   if (exo_job_set_error_if_cancelled (EXO_JOB (job), error))
     return FALSE;
 
-  info = g_file_query_info (node->source_file,
-                            G_FILE_ATTRIBUTE_STANDARD_SIZE "," G_FILE_ATTRIBUTE_STANDARD_TYPE,
-                            G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
-                            exo_job_get_cancellable (EXO_JOB (job)),
-                            &err);
-
-  if (G_UNLIKELY (info == NULL))
+  /* failing to query the node is reported by the copy */
+  if (!thunar_transfer_job_query_node (job, node, NULL))
     return FALSE;
 
-  job->total_size += g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_STANDARD_SIZE);
+  job->total_size += node->info.size;
+  job->total_files++;
 
   /* check if we have a directory here */
-  if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
-    {
-      /* scan the directory for immediate children */
-      file_list = thunar_io_scan_directory (THUNAR_JOB (job), node->source_file,
-                                            G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
-                                            FALSE, FALSE, FALSE, NULL, &err);
+  if (node->info.file_type == G_FILE_TYPE_DIRECTORY)
+    return thunar_transfer_job_collect_children (job, node, TRUE, error);
+
+  return TRUE;
+}
+
 
-      /* add children to the transfer node */
-      for (lp = file_list; err == NULL && lp != NULL; lp = lp->next)
-        {
-          thunar_transfer_job_check_pause (job);
 
-          /* allocate a new transfer node for the child */
-          child_node = g_slice_new0 (ThunarTransferNode);
-          child_node->source_file = g_object_ref (lp->data);
-          child_node->replace_confirmed = node->replace_confirmed;
-          child_node->rename_confirmed = FALSE;
+/* Adds the size of @file and everything below it to the total size of the
+ * job. This runs in the count thread, so errors are left to the copy */
+static void
+thunar_transfer_job_count_file (ThunarTransferJob *job,
+                                GFile             *file,
+                                GFileInfo         *info,
+                                GCancellable      *cancellable)
+{
+  GFileEnumerator *enumerator;
+  GFileInfo       *child_info;
+  GFile           *child_file;
+  guint64          size;
+  guint64          n_files = 1;
 
-          /* hook the child node into the child list */
-          child_node->next = node->children;
-          node->children = child_node;
+  size = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_STANDARD_SIZE);
+
+  if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
+    {
+      enumerator = g_file_enumerate_children (file, COUNT_ATTRIBUTES,
+                                              G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                              cancellable, NULL);
+      while (enumerator != NULL
+             && !g_atomic_int_get (&job->count_stopped)
+             && (child_info = g_file_enumerator_next_file (enumerator, cancellable, NULL)) != NULL)
+        {
+          if (g_file_info_get_file_type (child_info) == G_FILE_TYPE_DIRECTORY)
+            {
+              child_file = g_file_enumerator_get_child (enumerator, child_info);
+              thunar_transfer_job_count_file (job, child_file, child_info, cancellable);
+              g_object_unref (child_file);
+            }
+          else
+            {
+              size += g_file_info_get_attribute_uint64 (child_info, G_FILE_ATTRIBUTE_STANDARD_SIZE);
+              n_files++;
+            }
 
-          /* collect the child node */
-          thunar_transfer_job_collect_node (job, child_node, &err);
+          g_object_unref (child_info);
         }
 
-      /* release the child files */
-      thunar_g_list_free_full (file_list);
+      g_clear_object (&enumerator);
     }
 
-  /* release file info */
-  g_object_unref (info);
+  g_mutex_lock (&job->leaf_mutex);
+  job->total_size += size;
+  job->total_files += n_files;
+  g_mutex_unlock (&job->leaf_mutex);
+}
 
-  if (G_UNLIKELY (err != NULL))
+
+
+static gpointer
+thunar_transfer_job_count (gpointer data)
+{
+  ThunarTransferJob *job = THUNAR_TRANSFER_JOB (data);
+  GCancellable      *cancellable = exo_job_get_cancellable (EXO_JOB (job));
+  GFileInfo         *info;
+  GList             *lp;
+
+  for (lp = job->source_node_list; lp != NULL && !g_atomic_int_get (&job->count_stopped); lp = lp->next)
     {
-      g_propagate_error (error, err);
-      return FALSE;
+      info = g_file_query_info (((ThunarTransferNode *) lp->data)->source_file, COUNT_ATTRIBUTES,
+                                G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, cancellable, NULL);
+      if (info != NULL)
+        {
+          thunar_transfer_job_count_file (job, ((ThunarTransferNode *) lp->data)->source_file, info, cancellable);
+          g_object_unref (info);
+        }
     }
 
-  return TRUE;
+  g_mutex_lock (&job->leaf_mutex);
+  job->total_size_known = TRUE;
+  g_cond_broadcast (&job->leaf_cond);
+  g_mutex_unlock (&job->leaf_mutex);
+
+  return NULL;
+}
+
+
+
+/* Starts summing up the size of the source files next to the copy and
+ * waits a moment, so the total is known right away for small copies */
+static void
+thunar_transfer_job_start_counting (ThunarTransferJob *job)
+{
+  gint64 end_time;
+
+  _thunar_return_if_fail (job->count_thread == NULL);
+
+  job->total_size_known = FALSE;
+  job->count_thread = g_thread_new ("ThunarTransferCount", thunar_transfer_job_count, job);
+
+  end_time = g_get_monotonic_time () + COUNT_WAIT_TIME;
+
+  g_mutex_lock (&job->leaf_mutex);
+  while (!job->total_size_known)
+    if (!g_cond_wait_until (&job->leaf_cond, &job->leaf_mutex, end_time))
+      break;
+  g_mutex_unlock (&job->leaf_mutex);
+}
+
+
+
+static void
+thunar_transfer_job_stop_counting (ThunarTransferJob *job)
+{
+  if (job->count_thread == NULL)
+    return;
+
+  /* the copy is over, there is nothing left to count for */
+  g_atomic_int_set (&job->count_stopped, TRUE);
+  g_thread_join (job->count_thread);
+  job->count_thread = NULL;
 }
 
 
 
 static gboolean
-ttj_copy_file (ThunarTransferJob  *job,
-               ThunarJobOperation *operation,
-               GFile              *source_file,
-               GFile              *target_file,
-               GFileCopyFlags      copy_flags,
-               GError            **error)
+ttj_copy_file (ThunarTransferJob        *job,
+               ThunarJobOperation       *operation,
+               GFile                    *source_file,
+               const ThunarTransferInfo *source_info,
+               GFile                    *target_file,
+               GFileCopyFlags            copy_flags,
+               GFileProgressCallback     progress_callback,
+               gpointer                  progress_callback_data,
+               GError                  **error)
 {
-  GFileInfo *info;
-  GFileType  source_type;
-  GFileType  target_type;
-  gboolean   target_exists;
-  gboolean   use_partial;
-  gboolean   verify_file;
-  gboolean   add_to_operation = TRUE;
-  GError    *err = NULL;
+  GFileInfo      *info;
+  GFileType       source_type;
+  GFileType       target_type;
+  gboolean        target_exists;
+  gboolean        use_partial;
+  gboolean        verify_file;
+  gboolean        add_to_operation = TRUE;
+  ThunarChecksum *checksum;
+  gchar          *expected_digest = NULL;
+  GError         *err = NULL;
 
   _thunar_return_val_if_fail (THUNAR_IS_TRANSFER_JOB (job), FALSE);
   _thunar_return_val_if_fail (G_IS_FILE (source_file), FALSE);
   _thunar_return_val_if_fail (G_IS_FILE (target_file), FALSE);
   _thunar_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
-  /* reset the file progress */
-  job->file_progress = 0;
-
   if (exo_job_set_error_if_cancelled (EXO_JOB (job), error))
     return FALSE;
   thunar_transfer_job_check_pause (job);
 
-  source_type = g_file_query_file_type (source_file, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
-                                        exo_job_get_cancellable (EXO_JOB (job)));
+  /* use the type from the collect phase if possible */
+  if (source_info != NULL && source_info->file_type != G_FILE_TYPE_UNKNOWN)
+    {
+      source_type = source_info->file_type;
+    }
+  else
+    {
+      source_type = g_file_query_file_type (source_file, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                            exo_job_get_cancellable (EXO_JOB (job)));
 
-  if (exo_job_set_error_if_cancelled (EXO_JOB (job), error))
-    return FALSE;
-  thunar_transfer_job_check_pause (job);
+      if (exo_job_set_error_if_cancelled (EXO_JOB (job), error))
+        return FALSE;
+      thunar_transfer_job_check_pause (job);
+    }
 
-  target_type = g_file_query_file_type (target_file, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
-                                        exo_job_get_cancellable (EXO_JOB (job)));
+  /* the target type is only needed up front if we are about to overwrite it,
+   * otherwise it is queried below in case the target turns out to exist */
+  if ((copy_flags & G_FILE_COPY_OVERWRITE) != 0)
+    {
+      target_type = g_file_query_file_type (target_file, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                            exo_job_get_cancellable (EXO_JOB (job)));
 
-  if (exo_job_set_error_if_cancelled (EXO_JOB (job), error))
-    return FALSE;
-  thunar_transfer_job_check_pause (job);
+      if (exo_job_set_error_if_cancelled (EXO_JOB (job), error))
+        return FALSE;
+      thunar_transfer_job_check_pause (job);
+    }
+  else
+    {
+      target_type = G_FILE_TYPE_UNKNOWN;
+    }
 
   /* check if the target is a symlink and we are in overwrite mode */
   if (target_type == G_FILE_TYPE_SYMBOLIC_LINK && (copy_flags & G_FILE_COPY_OVERWRITE) != 0)
@@ -526,11 +1073,6 @@ ttj_copy_file (ThunarTransferJob  *job,
       use_partial = FALSE;
     }
 
-  /* try to copy the file */
-  thunar_g_file_copy (source_file, target_file, copy_flags, use_partial,
-                      exo_job_get_cancellable (EXO_JOB (job)),
-                      thunar_transfer_job_progress, job, &err);
-
   switch (job->transfer_verify_file)
     {
     case THUNAR_VERIFY_FILE_MODE_REMOTE_ONLY:
@@ -544,29 +1086,62 @@ ttj_copy_file (ThunarTransferJob  *job,
     }
 
   /* Only verify when the file is a regular file */
-  verify_file = verify_file && (g_file_query_file_type (source_file, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, exo_job_get_cancellable (EXO_JOB (job))) == G_FILE_TYPE_REGULAR);
+  verify_file = verify_file && source_type == G_FILE_TYPE_REGULAR;
+
+  /* the source may have been corrupted before we even started. Look for
+   * its checksum file first, so it is only hashed with SHA-256 as well if
+   * there is one */
+  if (verify_file && job->transfer_verify_checksum_file)
+    expected_digest = thunar_g_file_read_checksum_file (source_file, exo_job_get_cancellable (EXO_JOB (job)));
+
+  /* hash the source while copying, so only the target has to be read again */
+  checksum = verify_file ? thunar_checksum_new (expected_digest != NULL) : NULL;
+
+  /* try to copy the file */
+  thunar_g_file_copy (source_file, target_file, copy_flags, use_partial,
+                      (gsize) job->transfer_buffer_size * 1024, job->transfer_direct_io,
+                      exo_job_get_cancellable (EXO_JOB (job)),
+                      progress_callback, progress_callback_data,
+                      checksum, &err);
 
   if (verify_file && err == NULL)
     {
-      gboolean is_equal;
-      exo_job_info_message (EXO_JOB (job), _("Verifying file contents..."));
-      is_equal = thunar_g_file_compare_contents (source_file, target_file,
-                                                 exo_job_get_cancellable (EXO_JOB (job)), &err);
+      gchar *target_digest;
+
+      /* copy pool workers must not emit on the job */
+      if (progress_callback_data == job)
+        exo_job_info_message (EXO_JOB (job), _("Verifying file contents..."));
 
-      /* if the copied file is corrupted and yet no error*/
-      if (!is_equal && err == NULL)
+      if (expected_digest != NULL && g_strcmp0 (expected_digest, thunar_checksum_get_sha256_string (checksum)) != 0)
         {
           err = g_error_new (G_FILE_ERROR,
                              G_FILE_ERROR_AGAIN,
-                             "Copied file does not match with the original");
+                             "Original file does not match its checksum file");
         }
-    }
 
-  /**
-   * MR !127 notes:
-   * (Discussion: https://gitlab.xfce.org/xfce/thunar/-/merge_requests/127)
-   *
-   * Proper solution for copying lost metadata requires
+      if (err == NULL)
+        {
+          target_digest = thunar_g_file_compute_checksum (target_file, exo_job_get_cancellable (EXO_JOB (job)), &err);
+
+          /* if the copied file is corrupted and yet no error*/
+          if (target_digest != NULL && g_strcmp0 (target_digest, thunar_checksum_get_string (checksum)) != 0)
+            {
+              err = g_error_new (G_FILE_ERROR,
+                                 G_FILE_ERROR_AGAIN,
+                                 "Copied file does not match with the original");
+            }
+          g_free (target_digest);
+        }
+    }
+
+  thunar_checksum_free (checksum);
+  g_free (expected_digest);
+
+  /**
+   * MR !127 notes:
+   * (Discussion: https://gitlab.xfce.org/xfce/thunar/-/merge_requests/127)
+   *
+   * Proper solution for copying lost metadata requires
    * `g_file_build_attribute_list_for_copy`, which is
    * added in Glib 2.68 (which is too recent a version
    * to add for now) so we leave a comment here. Patch
@@ -574,8 +1149,18 @@ ttj_copy_file (ThunarTransferJob  *job,
    **/
   if (G_UNLIKELY (err == NULL && !g_file_is_native (source_file)))
     {
-      info = g_file_query_info (source_file, G_FILE_ATTRIBUTE_TIME_MODIFIED, G_FILE_QUERY_INFO_NONE,
-                                exo_job_get_cancellable (EXO_JOB (job)), &err);
+      if (source_info != NULL && source_info->mtime != 0)
+        {
+          /* the modification time is already known from the collect phase */
+          info = g_file_info_new ();
+          g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED, source_info->mtime);
+          g_file_info_set_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC, source_info->mtime_usec);
+        }
+      else
+        {
+          info = g_file_query_info (source_file, G_FILE_ATTRIBUTE_TIME_MODIFIED, G_FILE_QUERY_INFO_NONE,
+                                    exo_job_get_cancellable (EXO_JOB (job)), &err);
+        }
 
       g_file_set_attributes_from_info (target_file, info, G_FILE_QUERY_INFO_NONE,
                                        exo_job_get_cancellable (EXO_JOB (job)), &err);
@@ -594,6 +1179,15 @@ ttj_copy_file (ThunarTransferJob  *job,
         }
     }
 
+  /* the target exists, now we need to know whether it is a directory */
+  if (G_UNLIKELY (err != NULL && target_type == G_FILE_TYPE_UNKNOWN
+                  && source_type == G_FILE_TYPE_DIRECTORY
+                  && g_error_matches (err, G_IO_ERROR, G_IO_ERROR_EXISTS)))
+    {
+      target_type = g_file_query_file_type (target_file, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                            exo_job_get_cancellable (EXO_JOB (job)));
+    }
+
   /* check if there were errors */
   if (G_UNLIKELY (err != NULL && err->domain == G_IO_ERROR))
     {
@@ -668,6 +1262,12 @@ ttj_copy_file (ThunarTransferJob  *job,
 
           thunar_job_operation_add (operation, source_file, target_file);
         }
+
+      /* the time per file is part of the remaining time estimate */
+      g_mutex_lock (&job->leaf_mutex);
+      job->files_progress++;
+      g_mutex_unlock (&job->leaf_mutex);
+
       return TRUE;
     }
 }
@@ -678,6 +1278,7 @@ ttj_copy_file (ThunarTransferJob  *job,
  * thunar_transfer_job_copy_file:
  * @job                : a #ThunarTransferJob.
  * @source_file        : the source #GFile to copy.
+ * @source_info        : what is known about @source_file from the collect phase or %NULL.
  * @target_file        : the destination #GFile to copy to.
  * @replace_confirmed  : whether the user has already confirmed that this file should replace an existing one
  * @rename_confirmed   : whether the user has already confirmed that this file should be renamed to a new unique file name
@@ -701,13 +1302,14 @@ ttj_copy_file (ThunarTransferJob  *job,
  *               on error or cancellation.
  **/
 static GFile *
-thunar_transfer_job_copy_file (ThunarTransferJob  *job,
-                               ThunarJobOperation *operation,
-                               GFile              *source_file,
-                               GFile              *target_file,
-                               gboolean            replace_confirmed,
-                               gboolean            rename_confirmed,
-                               GError            **error)
+thunar_transfer_job_copy_file (ThunarTransferJob        *job,
+                               ThunarJobOperation       *operation,
+                               GFile                    *source_file,
+                               const ThunarTransferInfo *source_info,
+                               GFile                    *target_file,
+                               gboolean                  replace_confirmed,
+                               gboolean                  rename_confirmed,
+                               GError                  **error)
 {
   ThunarJobResponse response;
   GFile            *dest_file = target_file;
@@ -738,68 +1340,638 @@ thunar_transfer_job_copy_file (ThunarTransferJob  *job,
 
       if (err == NULL)
         {
-          /* try to copy the file from source file to the duplicate file */
-          if (ttj_copy_file (job, operation, source_file, target, copy_flags, &err))
-            return target;
-          else /* go to error case */
-            g_object_unref (target);
+          /* reset the file progress */
+          job->file_progress = 0;
+
+          /* try to copy the file from source file to the duplicate file */
+          if (ttj_copy_file (job, operation, source_file, source_info, target, copy_flags,
+                             thunar_transfer_job_progress, job, &err))
+            return target;
+          else /* go to error case */
+            g_object_unref (target);
+        }
+
+      /* check if we can recover from this error */
+      if (err->domain == G_IO_ERROR && err->code == G_IO_ERROR_EXISTS)
+        {
+          /* reset the error */
+          g_clear_error (&err);
+
+          /* if necessary, ask the user whether to replace or rename the target file */
+          if (replace_confirmed)
+            response = THUNAR_JOB_RESPONSE_REPLACE;
+          else if (rename_confirmed)
+            response = THUNAR_JOB_RESPONSE_RENAME;
+          else
+            response = thunar_job_ask_replace (THUNAR_JOB (job), source_file,
+                                               dest_file, &err);
+
+          if (err != NULL)
+            break;
+
+          /* add overwrite flag and retry if we should overwrite */
+          if (response == THUNAR_JOB_RESPONSE_REPLACE)
+            {
+              replace_confirmed = TRUE;
+              copy_flags |= G_FILE_COPY_OVERWRITE;
+              continue;
+            }
+          else if (response == THUNAR_JOB_RESPONSE_RENAME)
+            {
+              GFile *renamed_file;
+              renamed_file = thunar_io_jobs_util_next_renamed_file (THUNAR_JOB (job),
+                                                                    source_file,
+                                                                    dest_file,
+                                                                    ++n_rename, &err);
+              if (renamed_file != NULL)
+                {
+                  if (err != NULL)
+                    g_object_unref (renamed_file);
+                  else
+                    {
+                      dest_file = renamed_file;
+                      rename_confirmed = TRUE;
+                    }
+                }
+            }
+
+          /* tell the caller we skipped the file if the user
+           * doesn't want to retry/overwrite */
+          if (response == THUNAR_JOB_RESPONSE_SKIP)
+            return g_object_ref (source_file);
+        }
+    }
+
+  _thunar_assert (err != NULL);
+
+  g_propagate_error (error, err);
+  return NULL;
+}
+
+
+
+static void
+thunar_transfer_leaf_free (ThunarTransferLeaf *leaf)
+{
+  g_object_unref (leaf->source_file);
+  g_object_unref (leaf->target_file);
+  g_object_unref (leaf->target_parent_file);
+  g_clear_error (&leaf->error);
+  g_slice_free (ThunarTransferLeaf, leaf);
+}
+
+
+
+static void
+thunar_transfer_job_copy_leaf (gpointer data,
+                               gpointer user_data)
+{
+  ThunarTransferLeaf *leaf = data;
+  ThunarTransferJob  *job = THUNAR_TRANSFER_JOB (user_data);
+
+  /* copy the regular file, conflicts and errors are left to the job thread. the
+   * operation is updated by the job thread when collecting the leaf */
+  if (!exo_job_set_error_if_cancelled (EXO_JOB (job), &leaf->error))
+    {
+      ttj_copy_file (job, NULL, leaf->source_file, &leaf->info, leaf->target_file,
+                     G_FILE_COPY_NOFOLLOW_SYMLINKS,
+                     thunar_transfer_job_leaf_progress, leaf,
+                     &leaf->error);
+    }
+
+  g_mutex_lock (&job->leaf_mutex);
+
+  /* a failed leaf is copied again by the job thread, drop its progress */
+  if (leaf->error != NULL)
+    job->total_progress -= leaf->file_progress;
+
+  job->finished_leaves = g_list_prepend (job->finished_leaves, leaf);
+  job->n_pending_leaves--;
+  g_cond_signal (&job->leaf_cond);
+
+  g_mutex_unlock (&job->leaf_mutex);
+}
+
+
+
+static void
+thunar_transfer_job_delete_leaf (gpointer data,
+                                 gpointer user_data)
+{
+  ThunarThumbnailCache *thumbnail_cache;
+  ThunarApplication    *application;
+  ThunarTransferJob    *job = THUNAR_TRANSFER_JOB (user_data);
+  GFile                *source_file = data;
+
+  /* a cancelled move keeps the remaining sources, they are copied already */
+  if (exo_job_is_cancelled (EXO_JOB (job)))
+    {
+      g_clear_object (&source_file);
+    }
+  else if (g_file_delete (source_file, exo_job_get_cancellable (EXO_JOB (job)), NULL))
+    {
+      /* notify the thumbnail cache of the delete operation */
+      application = thunar_application_get ();
+      thumbnail_cache = thunar_application_get_thumbnail_cache (application);
+      g_object_unref (application);
+
+      thunar_thumbnail_cache_delete_file (thumbnail_cache, source_file);
+
+      g_object_unref (thumbnail_cache);
+      g_clear_object (&source_file);
+    }
+
+  g_mutex_lock (&job->leaf_mutex);
+
+  /* the job thread asks the user about the files which could not be deleted */
+  if (source_file != NULL)
+    job->failed_deletes = g_list_prepend (job->failed_deletes, source_file);
+
+  job->n_pending_deletes--;
+  g_cond_signal (&job->leaf_cond);
+
+  g_mutex_unlock (&job->leaf_mutex);
+}
+
+
+
+static void
+thunar_transfer_job_push_delete (ThunarTransferJob *job,
+                                 GFile             *source_file)
+{
+  _thunar_return_if_fail (THUNAR_IS_TRANSFER_JOB (job));
+  _thunar_return_if_fail (job->delete_pool != NULL);
+
+  /* don't let the copy run too far ahead, so a move doesn't need
+   * much more space than the largest files in flight */
+  g_mutex_lock (&job->leaf_mutex);
+  while (job->n_pending_deletes >= MAX_QUEUED_DELETES)
+    g_cond_wait (&job->leaf_cond, &job->leaf_mutex);
+  job->n_pending_deletes++;
+  g_mutex_unlock (&job->leaf_mutex);
+
+  g_thread_pool_push (job->delete_pool, g_object_ref (source_file), NULL);
+}
+
+
+
+static void
+thunar_transfer_job_collect_leaves (ThunarTransferJob *job,
+                                    guint              max_pending)
+{
+  ThunarThumbnailCache *thumbnail_cache;
+  ThunarApplication    *application;
+  ThunarTransferLeaf   *leaf;
+  GList                *finished_leaves;
+  GList                *lp;
+  guint                 n_pending;
+
+  _thunar_return_if_fail (THUNAR_IS_TRANSFER_JOB (job));
+
+  do
+    {
+      g_mutex_lock (&job->leaf_mutex);
+
+      /* wait for a worker to finish, but wake up regularly to report the progress */
+      if (job->n_pending_leaves > max_pending)
+        g_cond_wait_until (&job->leaf_cond, &job->leaf_mutex, g_get_monotonic_time () + 500 * G_TIME_SPAN_MILLISECOND);
+
+      finished_leaves = job->finished_leaves;
+      job->finished_leaves = NULL;
+      n_pending = job->n_pending_leaves;
+
+      g_mutex_unlock (&job->leaf_mutex);
+
+      if (finished_leaves != NULL)
+        {
+          /* take a reference on the thumbnail cache */
+          application = thunar_application_get ();
+          thumbnail_cache = thunar_application_get_thumbnail_cache (application);
+          g_object_unref (application);
+
+          finished_leaves = g_list_reverse (finished_leaves);
+          for (lp = finished_leaves; lp != NULL; lp = lp->next)
+            {
+              leaf = lp->data;
+
+              /* keep failed leaves around to copy them through the job later */
+              if (leaf->error != NULL)
+                {
+                  job->failed_leaves = g_list_prepend (job->failed_leaves, leaf);
+                  continue;
+                }
+
+              /* notify the thumbnail cache of the copy operation */
+              thunar_thumbnail_cache_copy_file (thumbnail_cache, leaf->source_file, leaf->target_file);
+
+              /* add the target file to the return list */
+              if (leaf->target_file_list_return != NULL)
+                *leaf->target_file_list_return = thunar_g_list_prepend_deep (*leaf->target_file_list_return, leaf->target_file);
+
+              if (leaf->operation != NULL)
+                thunar_job_operation_add (leaf->operation, leaf->source_file, leaf->target_file);
+
+              if (job->journal != NULL)
+                thunar_transfer_journal_add (job->journal, leaf->target_file, leaf->info.mtime, leaf->info.size);
+
+              /* the copy is complete (and verified), the source of a move can go */
+              if (job->delete_pool != NULL)
+                thunar_transfer_job_push_delete (job, leaf->source_file);
+
+              thunar_transfer_leaf_free (leaf);
+            }
+
+          g_list_free (finished_leaves);
+
+          /* release the thumbnail cache */
+          g_object_unref (thumbnail_cache);
+        }
+
+      thunar_transfer_job_update_progress (job, FALSE);
+    }
+  while (n_pending > max_pending);
+}
+
+
+
+/* The target of a regular file is only looked at once, both to compare it
+ * with the source and to keep existing targets away from the copy pool.
+ * Returns %NULL if there is no target, or nothing needs to know */
+static GFileInfo *
+thunar_transfer_job_query_target (ThunarTransferJob  *job,
+                                  ThunarTransferNode *node,
+                                  GFile              *target_file)
+{
+  gboolean skip_unchanged;
+
+  if (node->info.file_type != G_FILE_TYPE_REGULAR)
+    return NULL;
+
+  skip_unchanged = (job->transfer_skip_unchanged != THUNAR_SKIP_UNCHANGED_MODE_DISABLED
+                    && job->type == THUNAR_TRANSFER_JOB_COPY);
+  if (!skip_unchanged && job->copy_pool == NULL)
+    return NULL;
+
+  return g_file_query_info (target_file,
+                            G_FILE_ATTRIBUTE_STANDARD_TYPE "," G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED,
+                            G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                            exo_job_get_cancellable (EXO_JOB (job)), NULL);
+}
+
+
+
+static gboolean
+thunar_transfer_job_skip_copied (ThunarTransferJob  *job,
+                                 ThunarTransferNode *node,
+                                 GFile              *target_file)
+{
+  GFileInfo *info;
+  gboolean   copied;
+  guint64    mtime;
+  guint64    size;
+  guint64    target_mtime;
+
+  /* check whether an interrupted run of this job already copied the file */
+  if (job->journal == NULL
+      || node->info.file_type != G_FILE_TYPE_REGULAR
+      || !thunar_transfer_journal_lookup (job->journal, target_file, &mtime, &size, &target_mtime))
+    return FALSE;
+
+  /* the source changed in the meantime */
+  if (mtime != node->info.mtime || size != node->info.size)
+    return FALSE;
+
+  /* the target is still there and nobody touched it since, no need to read it */
+  info = g_file_query_info (target_file,
+                            G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED,
+                            G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                            exo_job_get_cancellable (EXO_JOB (job)), NULL);
+  copied = info != NULL
+           && (guint64) g_file_info_get_size (info) == size
+           && g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) == target_mtime;
+  g_clear_object (&info);
+
+  if (copied)
+    {
+      g_mutex_lock (&job->leaf_mutex);
+      job->total_progress += size;
+      job->files_progress++;
+      g_mutex_unlock (&job->leaf_mutex);
+    }
+
+  return copied;
+}
+
+
+
+/* Returns %TRUE if the target of the regular file @node is up to date, so
+ * the copy can be skipped. @info is the target as queried by
+ * thunar_transfer_job_query_target(). A changed target that is older than
+ * the source is replaced without asking, any other is left to the
+ * overwrite dialog */
+static gboolean
+thunar_transfer_job_skip_unchanged (ThunarTransferJob  *job,
+                                    ThunarTransferNode *node,
+                                    GFile              *target_file,
+                                    GFileInfo          *info,
+                                    gboolean            coarse_mtime)
+{
+  GCancellable *cancellable = exo_job_get_cancellable (EXO_JOB (job));
+  gboolean      unchanged = FALSE;
+  guint64       mtime;
+  gchar        *source_digest;
+  gchar        *target_digest;
+
+  if (job->transfer_skip_unchanged == THUNAR_SKIP_UNCHANGED_MODE_DISABLED
+      || job->type != THUNAR_TRANSFER_JOB_COPY
+      || node->info.file_type != G_FILE_TYPE_REGULAR)
+    return FALSE;
+
+  /* a missing target is simply copied, anything but a regular
+   * file is left to the usual conflict handling */
+  if (info == NULL || g_file_info_get_file_type (info) != G_FILE_TYPE_REGULAR)
+    return FALSE;
+
+  /* FAT stores the modification time in steps of two seconds */
+  mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+
+  if ((guint64) g_file_info_get_size (info) == node->info.size)
+    {
+      if (job->transfer_skip_unchanged == THUNAR_SKIP_UNCHANGED_MODE_MTIME)
+        {
+          unchanged = node->info.mtime != 0
+                      && (mtime == node->info.mtime
+                          || (coarse_mtime && mtime + 2 >= node->info.mtime && mtime <= node->info.mtime + 2));
+        }
+      else
+        {
+          source_digest = thunar_g_file_compute_checksum (node->source_file, cancellable, NULL);
+          target_digest = thunar_g_file_compute_checksum (target_file, cancellable, NULL);
+          unchanged = source_digest != NULL && g_strcmp0 (source_digest, target_digest) == 0;
+          g_free (source_digest);
+          g_free (target_digest);
+        }
+    }
+
+  if (!unchanged)
+    {
+      /* bring an outdated target up to date, but never silently
+       * replace a target that was changed after the source */
+      if (node->info.mtime > mtime + (coarse_mtime ? 2 : 0))
+        node->replace_confirmed = TRUE;
+      return FALSE;
+    }
+
+  g_mutex_lock (&job->leaf_mutex);
+  job->total_progress += node->info.size;
+  job->files_progress++;
+  job->n_skipped_files++;
+  job->skipped_size += node->info.size;
+  g_mutex_unlock (&job->leaf_mutex);
+
+  return TRUE;
+}
+
+
+
+static gboolean
+thunar_transfer_job_can_copy_leaf (ThunarTransferJob  *job,
+                                   ThunarTransferNode *node,
+                                   GFile              *target_file,
+                                   GFileInfo          *target_info)
+{
+  /* only regular files without pending user decisions go to the copy pool,
+   * everything else takes the regular path with dialogs and retries. That
+   * includes existing targets, so the user is asked about them in order */
+  return job->copy_pool != NULL
+         && node->info.file_type == G_FILE_TYPE_REGULAR
+         && node->children == NULL
+         && !node->replace_confirmed
+         && !node->rename_confirmed
+         && g_file_is_native (node->source_file)
+         && g_file_is_native (target_file)
+         && !g_file_equal (node->source_file, target_file)
+         && target_info == NULL;
+}
+
+
+
+static void
+thunar_transfer_job_push_leaf (ThunarTransferJob  *job,
+                               ThunarJobOperation *operation,
+                               ThunarTransferNode *node,
+                               GFile              *target_file,
+                               GFile              *target_parent_file,
+                               gboolean            explicit_target,
+                               GList             **target_file_list_return,
+                               const gchar        *display_name)
+{
+  ThunarTransferLeaf *leaf;
+  gint64              current_time;
+
+  _thunar_return_if_fail (THUNAR_IS_TRANSFER_JOB (job));
+  _thunar_return_if_fail (job->copy_pool != NULL);
+
+  /* keep the number of queued files bounded */
+  thunar_transfer_job_collect_leaves (job, MAX_QUEUED_LEAVES - 1);
+
+  /* update progress information, but don't flood the main loop */
+  current_time = g_get_real_time ();
+  if (current_time - job->last_leaf_message_time > (500 * 1000))
+    {
+      exo_job_info_message (EXO_JOB (job), "%s", display_name);
+      job->last_leaf_message_time = current_time;
+    }
+
+  leaf = g_slice_new0 (ThunarTransferLeaf);
+  leaf->job = job;
+  leaf->operation = operation;
+  leaf->source_file = g_object_ref (node->source_file);
+  leaf->target_file = g_object_ref (target_file);
+  leaf->target_parent_file = g_object_ref (target_parent_file);
+  leaf->info = node->info;
+  leaf->explicit_target = explicit_target;
+  leaf->target_file_list_return = target_file_list_return;
+
+  g_mutex_lock (&job->leaf_mutex);
+  job->n_pending_leaves++;
+  g_mutex_unlock (&job->leaf_mutex);
+
+  g_thread_pool_push (job->copy_pool, leaf, NULL);
+}
+
+
+
+static gboolean
+thunar_transfer_job_can_copy_archive (ThunarTransferJob  *job,
+                                      ThunarTransferNode *node,
+                                      GFile              *target_file)
+{
+  /* only new folders are streamed, so tar never runs into conflicts */
+  return job->transfer_archive_mode
+         && job->type == THUNAR_TRANSFER_JOB_COPY
+         && node->info.file_type == G_FILE_TYPE_DIRECTORY
+         && !node->replace_confirmed
+         && !node->rename_confirmed
+         && g_file_is_native (node->source_file)
+         && !g_file_is_native (target_file)
+         && thunar_transfer_archive_is_supported (target_file)
+         && !g_file_query_exists (target_file, exo_job_get_cancellable (EXO_JOB (job)));
+}
+
+
+
+/* Returns %FALSE if the folder has to be copied file by file */
+static gboolean
+thunar_transfer_job_copy_archive (ThunarTransferJob  *job,
+                                  ThunarJobOperation *operation,
+                                  ThunarTransferNode *node,
+                                  GFile              *target_file,
+                                  GList             **target_file_list_return,
+                                  GError            **error)
+{
+  gboolean success;
+
+  job->file_progress = 0;
+
+  if (!thunar_transfer_archive_copy (node->source_file, target_file,
+                                     exo_job_get_cancellable (EXO_JOB (job)),
+                                     thunar_transfer_job_progress, job,
+                                     &success, error))
+    return FALSE;
+
+  if (success)
+    {
+      if (operation != NULL)
+        thunar_job_operation_add (operation, node->source_file, target_file);
+
+      if (G_LIKELY (target_file_list_return != NULL))
+        *target_file_list_return = thunar_g_list_prepend_deep (*target_file_list_return, target_file);
+
+      /* the contents went with the archive */
+      thunar_transfer_node_free (node->children);
+      node->children = NULL;
+    }
+
+  return TRUE;
+}
+
+
+
+static void
+thunar_transfer_fs_info_free (gpointer data)
+{
+  ThunarTransferFsInfo *fs_info = data;
+
+  g_object_unref (fs_info->info);
+  g_slice_free (ThunarTransferFsInfo, fs_info);
+}
+
+
+
+static void
+thunar_transfer_job_mount_changed (GVolumeMonitor *monitor,
+                                   GMount         *mount,
+                                   gpointer        user_data)
+{
+  G_LOCK (fs_info_cache);
+  g_hash_table_remove_all (fs_info_cache);
+  G_UNLOCK (fs_info_cache);
+}
+
+
+
+/* Returns a key for the filesystem of @file which can be found without a
+ * round trip to the backend, or %NULL if there is none */
+static gchar *
+thunar_transfer_job_get_fs_info_key (GFile *file)
+{
+  GStatBuf statbuf;
+  GMount  *mount;
+  GFile   *root;
+  gchar   *key = NULL;
+
+  if (g_file_is_native (file))
+    {
+      if (g_stat (g_file_peek_path (file), &statbuf) == 0)
+        key = g_strdup_printf ("dev:%" G_GUINT64_FORMAT, (guint64) statbuf.st_dev);
+    }
+  else
+    {
+      /* gvfs looks this up in its local mount tracker */
+      mount = g_file_find_enclosing_mount (file, NULL, NULL);
+      if (mount != NULL)
+        {
+          root = g_mount_get_root (mount);
+          key = g_file_get_uri (root);
+          g_object_unref (root);
+          g_object_unref (mount);
         }
+    }
 
-      /* check if we can recover from this error */
-      if (err->domain == G_IO_ERROR && err->code == G_IO_ERROR_EXISTS)
-        {
-          /* reset the error */
-          g_clear_error (&err);
+  return key;
+}
 
-          /* if necessary, ask the user whether to replace or rename the target file */
-          if (replace_confirmed)
-            response = THUNAR_JOB_RESPONSE_REPLACE;
-          else if (rename_confirmed)
-            response = THUNAR_JOB_RESPONSE_RENAME;
-          else
-            response = thunar_job_ask_replace (THUNAR_JOB (job), source_file,
-                                               dest_file, &err);
 
-          if (err != NULL)
-            break;
 
-          /* add overwrite flag and retry if we should overwrite */
-          if (response == THUNAR_JOB_RESPONSE_REPLACE)
-            {
-              replace_confirmed = TRUE;
-              copy_flags |= G_FILE_COPY_OVERWRITE;
-              continue;
-            }
-          else if (response == THUNAR_JOB_RESPONSE_RENAME)
-            {
-              GFile *renamed_file;
-              renamed_file = thunar_io_jobs_util_next_renamed_file (THUNAR_JOB (job),
-                                                                    source_file,
-                                                                    dest_file,
-                                                                    ++n_rename, &err);
-              if (renamed_file != NULL)
-                {
-                  if (err != NULL)
-                    g_object_unref (renamed_file);
-                  else
-                    {
-                      dest_file = renamed_file;
-                      rename_confirmed = TRUE;
-                    }
-                }
-            }
+/**
+ * thunar_transfer_job_query_fs_info:
+ * @job     : a #ThunarTransferJob.
+ * @file    : an existing folder on the destination.
+ * @max_age : how old a cached info may be, in microseconds.
+ *
+ * Queries the filesystem info of @file, or takes it from the cache if it
+ * was queried for the same filesystem less than @max_age ago. The type of
+ * a mounted filesystem doesn't change, so only the free space needs a
+ * short @max_age.
+ *
+ * Return value: (transfer full) (nullable): the filesystem info of @file.
+ **/
+static GFileInfo *
+thunar_transfer_job_query_fs_info (ThunarTransferJob *job,
+                                   GFile             *file,
+                                   gint64             max_age)
+{
+  ThunarTransferFsInfo *fs_info;
+  GFileInfo            *info = NULL;
+  gint64                now = g_get_monotonic_time ();
+  gchar                *key;
 
-          /* tell the caller we skipped the file if the user
-           * doesn't want to retry/overwrite */
-          if (response == THUNAR_JOB_RESPONSE_SKIP)
-            return g_object_ref (source_file);
+  key = thunar_transfer_job_get_fs_info_key (file);
+  if (key != NULL)
+    {
+      G_LOCK (fs_info_cache);
+      fs_info = g_hash_table_lookup (fs_info_cache, key);
+      if (fs_info != NULL && now - fs_info->time <= max_age)
+        info = g_object_ref (fs_info->info);
+      G_UNLOCK (fs_info_cache);
+
+      if (info != NULL)
+        {
+          g_free (key);
+          return info;
         }
     }
 
-  _thunar_assert (err != NULL);
+  info = g_file_query_filesystem_info (file, THUNARX_FILESYSTEM_INFO_NAMESPACE,
+                                       exo_job_get_cancellable (EXO_JOB (job)),
+                                       NULL);
+  if (info != NULL && key != NULL)
+    {
+      fs_info = g_slice_new (ThunarTransferFsInfo);
+      fs_info->info = g_object_ref (info);
+      fs_info->time = now;
 
-  g_propagate_error (error, err);
-  return NULL;
+      G_LOCK (fs_info_cache);
+      g_hash_table_replace (fs_info_cache, g_steal_pointer (&key), fs_info);
+      G_UNLOCK (fs_info_cache);
+    }
+
+  g_free (key);
+
+  return info;
 }
 
 
@@ -819,12 +1991,15 @@ thunar_transfer_job_copy_node (ThunarTransferJob  *job,
   ThunarJobResponse     response;
   GFileInfo            *info;
   GFileInfo            *fs_info;
+  GFileInfo            *target_info;
   GError               *err = NULL;
   GFile                *real_target_file = NULL;
   gchar                *base_name;
+  gchar                *display_name;
   const gchar          *fs_type;
   gboolean              should_use_copy_name;
   gboolean              use_fat_name_scheme;
+  gboolean              explicit_target = (target_file != NULL);
 
   _thunar_return_if_fail (THUNAR_IS_TRANSFER_JOB (job));
   _thunar_return_if_fail (node != NULL && G_IS_FILE (node->source_file));
@@ -858,9 +2033,8 @@ thunar_transfer_job_copy_node (ThunarTransferJob  *job,
     g_object_ref (target_parent_file);
   g_assert (target_parent_file != NULL);
 
-  fs_info = g_file_query_filesystem_info (target_parent_file,
-                                          G_FILE_ATTRIBUTE_FILESYSTEM_TYPE,
-                                          NULL, NULL);
+  /* asked for every folder copied, so take it from the cache */
+  fs_info = thunar_transfer_job_query_fs_info (job, target_parent_file, G_MAXINT64);
   if (fs_info != NULL)
     {
       fs_type = g_file_info_get_attribute_string (fs_info, G_FILE_ATTRIBUTE_FILESYSTEM_TYPE);
@@ -882,26 +2056,33 @@ thunar_transfer_job_copy_node (ThunarTransferJob  *job,
 
   for (; err == NULL && node != NULL; node = node->next)
     {
-      /* query file info */
-      info = g_file_query_info (node->source_file,
-                                G_FILE_ATTRIBUTE_STANDARD_COPY_NAME "," G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME,
-                                G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
-                                exo_job_get_cancellable (EXO_JOB (job)),
-                                &err);
-
-      /* abort on error or cancellation */
-      if (info == NULL)
+      /* check the free space once the count thread knows how much to copy */
+      if (!thunar_transfer_job_verify_counted_destination (job, &err))
         break;
 
       /* guess the target file for this node (unless already provided) */
       if (should_use_copy_name)
         {
+          /* query file info */
+          info = g_file_query_info (node->source_file,
+                                    G_FILE_ATTRIBUTE_STANDARD_COPY_NAME "," G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME,
+                                    G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                    exo_job_get_cancellable (EXO_JOB (job)),
+                                    &err);
+
+          /* abort on error or cancellation */
+          if (info == NULL)
+            break;
+
           base_name = g_strdup (g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_STANDARD_COPY_NAME));
           /* copy name is NULLable, so use display name for fallback */
           if (base_name == NULL)
             base_name = g_strdup (g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME));
           target_file = g_file_get_child (target_parent_file, base_name);
           g_free (base_name);
+
+          display_name = g_strdup (g_file_info_get_display_name (info));
+          g_object_unref (info);
         }
       else if (G_LIKELY (target_file == NULL))
         {
@@ -912,6 +2093,10 @@ thunar_transfer_job_copy_node (ThunarTransferJob  *job,
       else
         target_file = g_object_ref (target_file);
 
+      /* local files don't need another query for the display name */
+      if (!should_use_copy_name)
+        display_name = g_filename_display_basename (g_file_peek_path (node->source_file));
+
       if (use_fat_name_scheme)
         {
           base_name = g_file_get_basename (target_file);
@@ -949,8 +2134,55 @@ thunar_transfer_job_copy_node (ThunarTransferJob  *job,
           g_free (base_name);
         }
 
+      /* skip files an interrupted run of this job already copied, or
+       * which are up to date when only changes are copied */
+      target_info = thunar_transfer_job_query_target (job, node, target_file);
+      if (thunar_transfer_job_skip_copied (job, node, target_file)
+          || thunar_transfer_job_skip_unchanged (job, node, target_file, target_info, use_fat_name_scheme))
+        {
+          g_clear_object (&target_info);
+          g_clear_object (&target_file);
+          g_free (display_name);
+          continue;
+        }
+
+      /* hand regular files over to the copy pool */
+      if (thunar_transfer_job_can_copy_leaf (job, node, target_file, target_info))
+        {
+          thunar_transfer_job_push_leaf (job, operation, node, target_file, target_parent_file,
+                                         explicit_target, target_file_list_return,
+                                         display_name);
+          g_clear_object (&target_info);
+          g_clear_object (&target_file);
+          g_free (display_name);
+          continue;
+        }
+      g_clear_object (&target_info);
+
       /* update progress information */
-      exo_job_info_message (EXO_JOB (job), "%s", g_file_info_get_display_name (info));
+      exo_job_info_message (EXO_JOB (job), "%s", display_name);
+
+      /* stream local folders to remote hosts in one go */
+      if (thunar_transfer_job_can_copy_archive (job, node, target_file)
+          && thunar_transfer_job_copy_archive (job, operation, node, target_file, target_file_list_return, &err))
+        {
+          if (err != NULL && !exo_job_is_cancelled (EXO_JOB (job)))
+            {
+              /* ask the user to skip this node and all subnodes */
+              response = thunar_job_ask_skip (THUNAR_JOB (job), "%s", err->message);
+
+              /* reset the error */
+              g_clear_error (&err);
+
+              /* a retry copies file by file, merging into what was unpacked */
+              if (G_UNLIKELY (response == THUNAR_JOB_RESPONSE_RETRY))
+                goto retry_copy;
+            }
+
+          g_clear_object (&target_file);
+          g_free (display_name);
+          continue;
+        }
 
 retry_copy:
       thunar_transfer_job_check_pause (job);
@@ -958,6 +2190,7 @@ retry_copy:
       /* copy the item specified by this node (not recursively) */
       real_target_file = thunar_transfer_job_copy_file (job, operation,
                                                         node->source_file,
+                                                        &node->info,
                                                         target_file,
                                                         node->replace_confirmed,
                                                         node->rename_confirmed,
@@ -972,8 +2205,33 @@ retry_copy:
                                                 node->source_file,
                                                 real_target_file);
 
+              /* directories of a copy are only collected once they are reached,
+               * so copying does not have to wait for the whole tree to be scanned */
+              if (node->info.file_type == G_FILE_TYPE_DIRECTORY && node->children == NULL
+                  && job->type == THUNAR_TRANSFER_JOB_COPY)
+                {
+retry_collect:
+                  if (!thunar_transfer_job_collect_children (job, node, FALSE, &err)
+                      && !exo_job_is_cancelled (EXO_JOB (job)))
+                    {
+                      /* drop what was collected, the files copied so far are kept */
+                      thunar_transfer_node_free (node->children);
+                      node->children = NULL;
+
+                      /* ask the user to skip the contents of this directory */
+                      response = thunar_job_ask_skip (THUNAR_JOB (job), "%s", err->message);
+
+                      /* reset the error */
+                      g_clear_error (&err);
+
+                      /* check whether to retry */
+                      if (G_UNLIKELY (response == THUNAR_JOB_RESPONSE_RETRY))
+                        goto retry_collect;
+                    }
+                }
+
               /* check if we have children to copy */
-              if (node->children != NULL)
+              if (err == NULL && node->children != NULL)
                 {
                   /* copy all children of this node */
                   thunar_transfer_job_copy_node (job, operation, node->children, NULL, real_target_file, NULL, &err);
@@ -989,9 +2247,18 @@ retry_copy:
                   /* outa here, freeing the target paths */
                   g_object_unref (real_target_file);
                   g_object_unref (target_file);
+                  g_free (display_name);
                   break;
                 }
 
+              /* remember the copied file in case the job gets interrupted */
+              if (job->journal != NULL && node->info.file_type == G_FILE_TYPE_REGULAR
+                  && g_file_equal (real_target_file, target_file))
+                {
+                  thunar_transfer_journal_add (job->journal, real_target_file,
+                                               node->info.mtime, node->info.size);
+                }
+
               /* add the real target file to the return list */
               if (G_LIKELY (target_file_list_return != NULL))
                 {
@@ -1006,7 +2273,13 @@ retry_remove:
               /* try to remove the source directory if we are on copy+remove fallback for move */
               if (job->type == THUNAR_TRANSFER_JOB_MOVE)
                 {
-                  if (g_file_delete (node->source_file,
+                  /* directories are only empty once the delete worker caught up */
+                  if (job->delete_pool != NULL && node->info.file_type == G_FILE_TYPE_DIRECTORY)
+                    {
+                      job->source_directories = g_list_prepend (job->source_directories,
+                                                                g_object_ref (node->source_file));
+                    }
+                  else if (g_file_delete (node->source_file,
                                      exo_job_get_cancellable (EXO_JOB (job)),
                                      &err))
                     {
@@ -1052,8 +2325,7 @@ retry_remove:
       /* release the guessed target file */
       g_clear_object (&target_file);
 
-      /* release file info */
-      g_object_unref (info);
+      g_free (display_name);
     }
 
   /* release parent file */
@@ -1072,12 +2344,139 @@ retry_remove:
 
 
 
+static void
+thunar_transfer_job_drain_leaves (ThunarTransferJob *job,
+                                  GError           **error)
+{
+  ThunarTransferNode  retry_node = { NULL, };
+  ThunarTransferLeaf *leaf;
+  GError             *err = NULL;
+  GList              *failed_leaves;
+  GList              *lp;
+  gboolean            retry;
+
+  _thunar_return_if_fail (THUNAR_IS_TRANSFER_JOB (job));
+  _thunar_return_if_fail (job->copy_pool != NULL);
+
+  /* wait for the workers to finish all queued files */
+  thunar_transfer_job_collect_leaves (job, 0);
+
+  /* the pool is idle now, and without it the retries stay in the job thread */
+  g_thread_pool_free (job->copy_pool, FALSE, TRUE);
+  job->copy_pool = NULL;
+
+  /* copy the failed files again, now through the job thread, which asks the user
+   * about conflicts and errors. skip that if the job failed or was cancelled */
+  retry = (error != NULL && *error == NULL);
+
+  failed_leaves = g_list_reverse (job->failed_leaves);
+  job->failed_leaves = NULL;
+
+  for (lp = failed_leaves; lp != NULL; lp = lp->next)
+    {
+      leaf = lp->data;
+
+      if (retry && err == NULL && !exo_job_set_error_if_cancelled (EXO_JOB (job), &err))
+        {
+          /* keep the collected info, so the journal records the file */
+          retry_node.source_file = leaf->source_file;
+          retry_node.info = leaf->info;
+
+          thunar_transfer_job_copy_node (job, leaf->operation, &retry_node,
+                                         leaf->explicit_target ? leaf->target_file : NULL,
+                                         leaf->explicit_target ? NULL : leaf->target_parent_file,
+                                         leaf->target_file_list_return, &err);
+        }
+
+      thunar_transfer_leaf_free (leaf);
+    }
+
+  g_list_free (failed_leaves);
+
+  if (G_UNLIKELY (err != NULL))
+    g_propagate_error (error, err);
+}
+
+
+
+static void
+thunar_transfer_job_drain_deletes (ThunarTransferJob *job,
+                                   GError           **error)
+{
+  ThunarThumbnailCache *thumbnail_cache;
+  ThunarApplication    *application;
+  ThunarJobResponse     response;
+  GError               *err = NULL;
+  GList                *source_files;
+  GList                *lp;
+  gboolean              retry;
+
+  _thunar_return_if_fail (THUNAR_IS_TRANSFER_JOB (job));
+  _thunar_return_if_fail (job->delete_pool != NULL);
+
+  /* wait for the worker to delete all queued sources */
+  g_thread_pool_free (job->delete_pool, FALSE, TRUE);
+  job->delete_pool = NULL;
+
+  /* delete the failed files again through the job thread, then the
+   * directories, innermost first. a failed move keeps its sources */
+  retry = (error != NULL && *error == NULL);
+
+  source_files = g_list_concat (g_list_reverse (job->failed_deletes),
+                                g_list_reverse (job->source_directories));
+  job->failed_deletes = NULL;
+  job->source_directories = NULL;
+
+  /* take a reference on the thumbnail cache */
+  application = thunar_application_get ();
+  thumbnail_cache = thunar_application_get_thumbnail_cache (application);
+  g_object_unref (application);
+
+  for (lp = source_files; lp != NULL; lp = lp->next)
+    {
+      if (!retry || err != NULL || exo_job_set_error_if_cancelled (EXO_JOB (job), &err))
+        continue;
+
+retry_remove:
+      thunar_transfer_job_check_pause (job);
+
+      if (g_file_delete (lp->data, exo_job_get_cancellable (EXO_JOB (job)), &err))
+        {
+          /* notify the thumbnail cache of the delete operation */
+          thunar_thumbnail_cache_delete_file (thumbnail_cache, lp->data);
+        }
+      else if (!exo_job_is_cancelled (EXO_JOB (job)))
+        {
+          /* ask the user to retry */
+          response = thunar_job_ask_skip (THUNAR_JOB (job), "%s", err->message);
+
+          /* reset the error */
+          g_clear_error (&err);
+
+          /* check whether to retry */
+          if (G_UNLIKELY (response == THUNAR_JOB_RESPONSE_RETRY))
+            goto retry_remove;
+        }
+    }
+
+  /* release the thumbnail cache */
+  g_object_unref (thumbnail_cache);
+
+  g_list_free_full (source_files, g_object_unref);
+
+  if (G_UNLIKELY (err != NULL))
+    g_propagate_error (error, err);
+}
+
+
+
 static gboolean
 thunar_transfer_job_verify_destination (ThunarTransferJob *transfer_job,
                                         GError           **error)
 {
   GFileInfo *filesystem_info;
   guint64    free_space;
+  guint64    required_space;
   GFile     *dest;
   GFileInfo *dest_info;
   gchar     *dest_name = NULL;
@@ -1091,8 +2490,14 @@ thunar_transfer_job_verify_destination (ThunarTransferJob *transfer_job,
   if (transfer_job->target_file_list == NULL)
     return TRUE;
 
+  /* only what is left to copy needs space, which is everything unless
+   * the copy started before the source files were counted */
+  g_mutex_lock (&transfer_job->leaf_mutex);
+  required_space = transfer_job->total_size - MIN (transfer_job->total_progress, transfer_job->total_size);
+  g_mutex_unlock (&transfer_job->leaf_mutex);
+
   /* total size is nul, should be fine */
-  if (transfer_job->total_size == 0)
+  if (required_space == 0)
     return TRUE;
 
   /* for all actions in thunar use the same target directory so
@@ -1100,9 +2505,7 @@ thunar_transfer_job_verify_destination (ThunarTransferJob *transfer_job,
   dest = g_file_get_parent (G_FILE (transfer_job->target_file_list->data));
 
   /* query information about the filesystem */
-  filesystem_info = g_file_query_filesystem_info (dest, THUNARX_FILESYSTEM_INFO_NAMESPACE,
-                                                  exo_job_get_cancellable (EXO_JOB (transfer_job)),
-                                                  NULL);
+  filesystem_info = thunar_transfer_job_query_fs_info (transfer_job, dest, FREE_SPACE_MAX_AGE);
 
   /* unable to query the info, this could happen on some backends */
   if (filesystem_info == NULL)
@@ -1131,9 +2534,9 @@ thunar_transfer_job_verify_destination (ThunarTransferJob *transfer_job,
   if (g_file_info_has_attribute (filesystem_info, G_FILE_ATTRIBUTE_FILESYSTEM_FREE))
     {
       free_space = g_file_info_get_attribute_uint64 (filesystem_info, G_FILE_ATTRIBUTE_FILESYSTEM_FREE);
-      if (transfer_job->total_size > free_space)
+      if (required_space > free_space)
         {
-          size_string = g_format_size_full (transfer_job->total_size - free_space,
+          size_string = g_format_size_full (required_space - free_space,
                                             transfer_job->file_size_binary ? G_FORMAT_SIZE_IEC_UNITS : G_FORMAT_SIZE_DEFAULT);
           succeed = thunar_job_ask_no_size (THUNAR_JOB (transfer_job),
                                             _("Error while copying to \"%s\": %s more space is "
@@ -1157,6 +2560,41 @@ thunar_transfer_job_verify_destination (ThunarTransferJob *transfer_job,
 }
 
 
+
+/* Checks the free space on the destination as soon as the source files
+ * are counted, if the copy had to start before that */
+static gboolean
+thunar_transfer_job_verify_counted_destination (ThunarTransferJob *transfer_job,
+                                                GError           **error)
+{
+  gboolean total_size_known;
+
+  if (transfer_job->destination_verified)
+    return TRUE;
+
+  g_mutex_lock (&transfer_job->leaf_mutex);
+  total_size_known = transfer_job->total_size_known;
+  g_mutex_unlock (&transfer_job->leaf_mutex);
+
+  if (!total_size_known)
+    return TRUE;
+
+  transfer_job->destination_verified = TRUE;
+
+  if (thunar_transfer_job_verify_destination (transfer_job, error))
+    return TRUE;
+
+  /* the user does not want to continue, keep what was copied so far */
+  if (error == NULL || *error == NULL)
+    {
+      exo_job_cancel (EXO_JOB (transfer_job));
+      exo_job_set_error_if_cancelled (EXO_JOB (transfer_job), error);
+    }
+
+  return FALSE;
+}
+
+
 static gboolean
 thunar_transfer_job_prepare_untrash_file (ExoJob    *job,
                                           GFileInfo *info,
@@ -1406,24 +2844,26 @@ thunar_transfer_job_move_file (ExoJob               *job,
 
 
 
-static gboolean
-thunar_transfer_job_device_id_in_job_list (const char *device_fs_id,
-                                           GList      *jobs)
+/* Returns the number of transfer jobs in @jobs that read from or
+ * write to the device @device_fs_id */
+static guint
+thunar_transfer_job_count_device_jobs (const gchar *device_fs_id,
+                                       GList       *jobs)
 {
   ThunarTransferJob *job;
+  guint              n_jobs = 0;
 
   for (GList *ljobs = jobs; device_fs_id != NULL && ljobs != NULL; ljobs = ljobs->next)
     {
       if (THUNAR_IS_TRANSFER_JOB (ljobs->data))
         {
           job = THUNAR_TRANSFER_JOB (ljobs->data);
-          if (g_strcmp0 (device_fs_id, job->source_device_fs_id) == 0)
-            return TRUE;
-          if (g_strcmp0 (device_fs_id, job->target_device_fs_id) == 0)
-            return TRUE;
+          if (g_strcmp0 (device_fs_id, job->source_device_fs_id) == 0
+              || g_strcmp0 (device_fs_id, job->target_device_fs_id) == 0)
+            n_jobs++;
         }
     }
-  return FALSE;
+  return n_jobs;
 }
 
 
@@ -1489,78 +2929,29 @@ thunar_transfer_job_fill_target_device_info (ThunarTransferJob *transfer_job,
 
 
 
-static void
-thunar_transfer_job_determine_copy_behavior (ThunarTransferJob *transfer_job,
-                                             gboolean          *freeze_if_src_busy_p,
-                                             gboolean          *freeze_if_tgt_busy_p,
-                                             gboolean          *always_parallel_copy_p,
-                                             gboolean          *should_freeze_on_any_other_job_p)
+/* Returns the number of jobs which may transfer from or to a device at
+ * the same time, according to the parallel copy mode. Local devices
+ * are only limited if the mode asks for it */
+static guint
+thunar_transfer_job_get_device_max_jobs (ThunarTransferJob *transfer_job,
+                                         gboolean           is_device_local)
 {
-  *freeze_if_src_busy_p = FALSE;
-  *freeze_if_tgt_busy_p = FALSE;
-  *should_freeze_on_any_other_job_p = FALSE;
-  if (transfer_job->parallel_copy_mode == THUNAR_PARALLEL_COPY_MODE_ALWAYS)
-    /* never freeze, always parallel copies */
-    *always_parallel_copy_p = TRUE;
-  else if (transfer_job->parallel_copy_mode == THUNAR_PARALLEL_COPY_MODE_ONLY_LOCAL)
-    {
-      /* always parallel copy if:
-       * - source device is local
-       * AND
-       * - target device is local
-       */
-      *always_parallel_copy_p = transfer_job->is_source_device_local && transfer_job->is_target_device_local;
-      *freeze_if_src_busy_p = !transfer_job->is_source_device_local;
-      *freeze_if_tgt_busy_p = !transfer_job->is_target_device_local;
-    }
-  else if (transfer_job->parallel_copy_mode == THUNAR_PARALLEL_COPY_MODE_ONLY_LOCAL_SAME_DEVICES)
-    {
-      /* always parallel copy if:
-       * - source and target device fs are identical
-       * AND
-       * - source device is local
-       * AND
-       * - target device is local
-       */
-      /* freeze copy if
-       * - src device fs ≠ tgt device fs and src or tgt appears in another job
-       * OR
-       * - src device is not local and src device appears in another job
-       * OR
-       * - tgt device is not local and tgt device appears in another job
-       */
-      if (g_strcmp0 (transfer_job->source_device_fs_id, transfer_job->target_device_fs_id) != 0)
-        {
-          *always_parallel_copy_p = FALSE;
-          /* freeze when either src or tgt device appears on another job */
-          *freeze_if_src_busy_p = TRUE;
-          *freeze_if_tgt_busy_p = TRUE;
-        }
-      else /* same as THUNAR_PARALLEL_COPY_MODE_ONLY_LOCAL */
-        {
-          *always_parallel_copy_p = transfer_job->is_source_device_local && transfer_job->is_target_device_local;
-          *freeze_if_src_busy_p = !transfer_job->is_source_device_local;
-          *freeze_if_tgt_busy_p = !transfer_job->is_target_device_local;
-        }
-    }
-  else if (transfer_job->parallel_copy_mode == THUNAR_PARALLEL_COPY_MODE_ONLY_LOCAL_IDLE_DEVICE)
+  switch (transfer_job->parallel_copy_mode)
     {
-      /* always parallel copy if:
-       * - source and target device fs are local
-       */
-      *always_parallel_copy_p = transfer_job->is_source_device_local && transfer_job->is_target_device_local;
+    case THUNAR_PARALLEL_COPY_MODE_ALWAYS:
+      return G_MAXUINT;
 
-      /* freeze copy if
-       * - src / tgt device appears in another job
-       */
-      *freeze_if_src_busy_p = TRUE;
-      *freeze_if_tgt_busy_p = TRUE;
-    }
-  else /* THUNAR_PARALLEL_COPY_MODE_NEVER */
-    {
-      /* freeze copy if another transfer job is running */
-      *always_parallel_copy_p = FALSE;
-      *should_freeze_on_any_other_job_p = TRUE;
+    case THUNAR_PARALLEL_COPY_MODE_ONLY_LOCAL:
+      return is_device_local ? G_MAXUINT : transfer_job->transfer_max_jobs_per_device;
+
+    case THUNAR_PARALLEL_COPY_MODE_ONLY_LOCAL_SAME_DEVICES:
+      /* copies between two devices always share them */
+      if (is_device_local && g_strcmp0 (transfer_job->source_device_fs_id, transfer_job->target_device_fs_id) == 0)
+        return G_MAXUINT;
+      return transfer_job->transfer_max_jobs_per_device;
+
+    default: /* THUNAR_PARALLEL_COPY_MODE_ONLY_LOCAL_IDLE_DEVICE */
+      return transfer_job->transfer_max_jobs_per_device;
     }
 }
 
@@ -1568,17 +2959,23 @@ thunar_transfer_job_determine_copy_behavior (ThunarTransferJob *transfer_job,
 
 /**
  * thunar_transfer_job_can_start:
+ * @transfer_job : a #ThunarTransferJob.
+ * @job_list     : the running jobs, followed by the jobs queued before @transfer_job.
  *
+ * Schedules @transfer_job per device: every device (a local block device
+ * or a gvfs mount, as told by its filesystem id) only accepts as many jobs
+ * as the "misc-transfer-max-jobs-per-device" preference allows, and the
+ * parallel copy mode decides which devices are limited at all. Since
+ * @job_list also contains the jobs that were queued earlier, a device
+ * is handed to the queued jobs in the order they were added.
  *
+ * Return value: %TRUE if @transfer_job can be launched now.
  **/
 gboolean
 thunar_transfer_job_can_start (ThunarTransferJob *transfer_job,
-                               GList             *running_job_list)
+                               GList             *job_list)
 {
-  gboolean freeze_if_src_busy;
-  gboolean freeze_if_tgt_busy;
-  gboolean always_parallel_copy;
-  gboolean should_freeze_on_any_other_job;
+  guint max_jobs;
 
   _thunar_return_val_if_fail (THUNAR_IS_TRANSFER_JOB (transfer_job), FALSE);
   _thunar_return_val_if_fail (!exo_job_is_cancelled (EXO_JOB (transfer_job)), TRUE);
@@ -1586,21 +2983,23 @@ thunar_transfer_job_can_start (ThunarTransferJob *transfer_job,
   /* no source node list nor target file list */
   if (transfer_job->source_node_list == NULL || transfer_job->target_file_list == NULL)
     return TRUE;
-  /* first source file */
-  thunar_transfer_job_fill_source_device_info (transfer_job, ((ThunarTransferNode *) transfer_job->source_node_list->data)->source_file);
-  /* first target file */
-  thunar_transfer_job_fill_target_device_info (transfer_job, G_FILE (transfer_job->target_file_list->data));
-  thunar_transfer_job_determine_copy_behavior (transfer_job,
-                                               &freeze_if_src_busy,
-                                               &freeze_if_tgt_busy,
-                                               &always_parallel_copy,
-                                               &should_freeze_on_any_other_job);
-
-  if (should_freeze_on_any_other_job && running_job_list != NULL)
-    return FALSE;
-  if (freeze_if_src_busy && thunar_transfer_job_device_id_in_job_list (transfer_job->source_device_fs_id, running_job_list))
+
+  /* the devices don't change while the job is queued, only query them once */
+  if (transfer_job->source_device_fs_id == NULL)
+    thunar_transfer_job_fill_source_device_info (transfer_job, ((ThunarTransferNode *) transfer_job->source_node_list->data)->source_file);
+  if (transfer_job->target_device_fs_id == NULL)
+    thunar_transfer_job_fill_target_device_info (transfer_job, G_FILE (transfer_job->target_file_list->data));
+
+  /* copies will be done consecutively, one after another */
+  if (transfer_job->parallel_copy_mode == THUNAR_PARALLEL_COPY_MODE_NEVER)
+    return job_list == NULL;
+
+  max_jobs = thunar_transfer_job_get_device_max_jobs (transfer_job, transfer_job->is_source_device_local);
+  if (thunar_transfer_job_count_device_jobs (transfer_job->source_device_fs_id, job_list) >= max_jobs)
     return FALSE;
-  if (freeze_if_tgt_busy && thunar_transfer_job_device_id_in_job_list (transfer_job->target_device_fs_id, running_job_list))
+
+  max_jobs = thunar_transfer_job_get_device_max_jobs (transfer_job, transfer_job->is_target_device_local);
+  if (thunar_transfer_job_count_device_jobs (transfer_job->target_device_fs_id, job_list) >= max_jobs)
     return FALSE;
 
   return TRUE;
@@ -1620,6 +3019,7 @@ thunar_transfer_job_execute (ExoJob  *job,
   GFileInfo            *info;
   GError               *err = NULL;
   GList                *new_files_list = NULL;
+  GList                *source_file_list = NULL;
   GList                *snext;
   GList                *sp;
   GList                *tnext;
@@ -1691,7 +3091,8 @@ thunar_transfer_job_execute (ExoJob  *job,
         }
       else if (transfer_job->type == THUNAR_TRANSFER_JOB_COPY)
         {
-          if (!thunar_transfer_job_collect_node (THUNAR_TRANSFER_JOB (job), node, &err))
+          /* the tree below is collected while copying */
+          if (!thunar_transfer_job_query_node (transfer_job, node, &err))
             break;
         }
 
@@ -1701,12 +3102,19 @@ thunar_transfer_job_execute (ExoJob  *job,
   /* release the thumbnail cache */
   g_object_unref (thumbnail_cache);
 
+  /* count the source files next to the copy, instead of waiting for it */
+  if (G_LIKELY (err == NULL) && transfer_job->type == THUNAR_TRANSFER_JOB_COPY)
+    thunar_transfer_job_start_counting (transfer_job);
+
   /* continue if there were no errors yet */
-  if (G_LIKELY (err == NULL))
+  if (G_LIKELY (err == NULL) && transfer_job->total_size_known)
     {
       /* check destination */
+      transfer_job->destination_verified = TRUE;
       if (!thunar_transfer_job_verify_destination (transfer_job, &err))
         {
+          thunar_transfer_job_stop_counting (transfer_job);
+
           if (err != NULL)
             {
               g_propagate_error (error, err);
@@ -1722,9 +3130,41 @@ thunar_transfer_job_execute (ExoJob  *job,
               return TRUE;
             }
         }
+    }
+
+  /* continue if there were no errors yet */
+  if (G_LIKELY (err == NULL))
+    {
 
       /* transfer starts now */
       transfer_job->start_time = g_get_real_time ();
+      transfer_job->start_wait_time = thunar_job_get_wait_time (THUNAR_JOB (job));
+
+      if (transfer_job->type == THUNAR_TRANSFER_JOB_COPY || transfer_job->type == THUNAR_TRANSFER_JOB_MOVE)
+        {
+          /* copy regular files in parallel, directories are still created by the
+           * job thread before their children are handed to the pool */
+          transfer_job->copy_pool = g_thread_pool_new (thunar_transfer_job_copy_leaf, transfer_job,
+                                                       MAX_COPY_WORKERS, FALSE, NULL);
+        }
+
+      if (transfer_job->type == THUNAR_TRANSFER_JOB_MOVE && transfer_job->source_node_list != NULL)
+        {
+          /* the nodes left could not be moved directly, delete each source
+           * file as soon as it is copied instead of after the whole tree */
+          transfer_job->delete_pool = g_thread_pool_new (thunar_transfer_job_delete_leaf, transfer_job,
+                                                         1, FALSE, NULL);
+        }
+
+      if (transfer_job->type == THUNAR_TRANSFER_JOB_COPY)
+        {
+          /* resume an interrupted run of the same copy, if any */
+          for (sp = transfer_job->source_node_list; sp != NULL; sp = sp->next)
+            source_file_list = g_list_prepend (source_file_list, ((ThunarTransferNode *) sp->data)->source_file);
+          source_file_list = g_list_reverse (source_file_list);
+          transfer_job->journal = thunar_transfer_journal_open (source_file_list, transfer_job->target_file_list);
+          g_list_free (source_file_list);
+        }
 
       /* perform the copy recursively for all source transfer nodes */
       for (sp = transfer_job->source_node_list, tp = transfer_job->target_file_list;
@@ -1734,8 +3174,23 @@ thunar_transfer_job_execute (ExoJob  *job,
           thunar_transfer_job_copy_node (transfer_job, operation, sp->data, tp->data, NULL,
                                          &new_files_list, &err);
         }
+
+      /* wait for the pool and copy the files it failed on */
+      if (transfer_job->copy_pool != NULL)
+        thunar_transfer_job_drain_leaves (transfer_job, &err);
+
+      if (transfer_job->delete_pool != NULL)
+        thunar_transfer_job_drain_deletes (transfer_job, &err);
+
+      if (transfer_job->journal != NULL)
+        {
+          thunar_transfer_journal_close (transfer_job->journal, err == NULL, exo_job_is_cancelled (job));
+          transfer_job->journal = NULL;
+        }
     }
 
+  thunar_transfer_job_stop_counting (transfer_job);
+
   /* check if we failed */
   if (G_UNLIKELY (err != NULL))
     {
@@ -1848,25 +3303,49 @@ thunar_transfer_job_get_status (ThunarTransferJob *job)
   gchar   *transfer_rate_str;
   GString *status;
   gulong   remaining_time;
+  guint64  total_size;
+  guint64  total_progress;
+  guint64  n_skipped_files;
+  gboolean total_size_known;
 
   _thunar_return_val_if_fail (THUNAR_IS_TRANSFER_JOB (job), NULL);
 
   status = g_string_sized_new (100);
 
+  g_mutex_lock (&job->leaf_mutex);
+  total_size = job->total_size;
+  total_progress = job->total_progress;
+  n_skipped_files = job->n_skipped_files;
+  total_size_known = job->total_size_known;
+  g_mutex_unlock (&job->leaf_mutex);
+
   /* transfer status like "22.6MB of 134.1MB" */
-  total_size_str = g_format_size_full (job->total_size, job->file_size_binary ? G_FORMAT_SIZE_IEC_UNITS : G_FORMAT_SIZE_DEFAULT);
-  total_progress_str = g_format_size_full (job->total_progress, job->file_size_binary ? G_FORMAT_SIZE_IEC_UNITS : G_FORMAT_SIZE_DEFAULT);
-  g_string_append_printf (status, _("%s of %s"), total_progress_str, total_size_str);
+  total_size_str = g_format_size_full (total_size, job->file_size_binary ? G_FORMAT_SIZE_IEC_UNITS : G_FORMAT_SIZE_DEFAULT);
+  total_progress_str = g_format_size_full (total_progress, job->file_size_binary ? G_FORMAT_SIZE_IEC_UNITS : G_FORMAT_SIZE_DEFAULT);
+  if (total_size_known)
+    g_string_append_printf (status, _("%s of %s"), total_progress_str, total_size_str);
+  else
+    g_string_append_printf (status, _("%s of %s found so far"), total_progress_str, total_size_str);
   g_free (total_size_str);
   g_free (total_progress_str);
 
-  /* show time and transfer rate after 10 seconds */
-  if (job->transfer_rate > 0
+  /* number of files which were up to date already */
+  if (n_skipped_files > 0)
+    {
+      g_string_append (status, ", ");
+      g_string_append_printf (status, ngettext ("%" G_GUINT64_FORMAT " unchanged file skipped",
+                                                "%" G_GUINT64_FORMAT " unchanged files skipped",
+                                                n_skipped_files),
+                              n_skipped_files);
+    }
+
+  /* show time and transfer rate after 10 seconds, once the total is known */
+  if (job->transfer_rate > 0 && job->remaining_time >= 0 && total_size_known && total_size > total_progress
       && (job->last_update_time - job->start_time) > MINIMUM_TRANSFER_TIME)
     {
-      /* remaining time based on the transfer speed */
+      /* remaining time from the byte and file rates seen so far */
       transfer_rate_str = g_format_size_full (job->transfer_rate, job->file_size_binary ? G_FORMAT_SIZE_IEC_UNITS : G_FORMAT_SIZE_DEFAULT);
-      remaining_time = (job->total_size - job->total_progress) / job->transfer_rate;
+      remaining_time = job->remaining_time;
 
       if (remaining_time > 0)
         {
@@ -62,7 +62,7 @@ thunar_transfer_job_get_status (ThunarTransferJob *job);
 
 gboolean
 thunar_transfer_job_can_start (ThunarTransferJob *transfer_job,
-                               GList             *running_job_list);
+                               GList             *job_list);
 
 G_END_DECLS
 
@@ -0,0 +1,652 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * Copyright (c) 2024 The Thunar development team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* A transfer journal records the files of a copy job and every file that was
+ * completely copied, so the job can be resumed after a crash, logout or
+ * cancellation. The journal is a plain text file in the cache directory
+ * named after the job's source and target files:
+ *
+ *   source <uri>
+ *   target <uri>
+ *   done <source mtime> <size> <target mtime> <target uri>
+ *   cancelled
+ *
+ * A file is only recorded once its data reached the disk, and the target
+ * modification time tells whether it was touched after that.
+ *
+ * A running job holds an advisory lock on its journal, so journals without
+ * a lock belong to interrupted jobs. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef HAVE_SYS_TYPES_H
+#include <sys/types.h>
+#endif
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#ifdef HAVE_STDIO_H
+#include <stdio.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_SYS_FILE_H
+#include <sys/file.h>
+#endif
+#ifdef HAVE_TIME_H
+#include <time.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include "thunar/thunar-gio-extensions.h"
+#include "thunar/thunar-private.h"
+#include "thunar/thunar-transfer-journal.h"
+
+#include <glib/gstdio.h>
+#include <libxfce4util/libxfce4util.h>
+
+
+
+/* location of the journals in the cache directory */
+#define JOURNAL_DIRECTORY "Thunar/transfers/"
+
+/* interrupted jobs older than this are not offered for resuming anymore */
+#define JOURNAL_MAX_AGE (30 * 24 * 60 * 60) /* s */
+
+/* sync the copied files and write them to the journal after
+ * this many files or this much time */
+#define JOURNAL_FLUSH_ENTRIES  64
+#define JOURNAL_FLUSH_INTERVAL G_USEC_PER_SEC /* us */
+
+
+
+typedef struct
+{
+  guint64 mtime;
+  guint64 size;
+  guint64 target_mtime;
+} ThunarTransferJournalEntry;
+
+typedef struct
+{
+  GFile  *target_file;
+  guint64 mtime;
+  guint64 size;
+} ThunarTransferJournalRecord;
+
+struct _ThunarTransferJournal
+{
+  gchar      *path;
+  FILE       *stream;
+
+  /* target uri -> ThunarTransferJournalEntry of an earlier run */
+  GHashTable *entries;
+
+  /* ThunarTransferJournalRecords not yet written */
+  GArray     *records;
+  gint64      last_flush_time;
+};
+
+
+
+static gchar *
+thunar_transfer_journal_get_path (GList *source_file_list,
+                                  GList *target_file_list)
+{
+  GChecksum *checksum;
+  GList     *lp;
+  gchar     *uri;
+  gchar     *name;
+  gchar     *path;
+
+  /* the same copy results in the same journal */
+  checksum = g_checksum_new (G_CHECKSUM_SHA1);
+  for (lp = source_file_list; lp != NULL; lp = lp->next)
+    {
+      uri = g_file_get_uri (lp->data);
+      g_checksum_update (checksum, (const guchar *) "source ", -1);
+      g_checksum_update (checksum, (const guchar *) uri, -1);
+      g_free (uri);
+    }
+  for (lp = target_file_list; lp != NULL; lp = lp->next)
+    {
+      uri = g_file_get_uri (lp->data);
+      g_checksum_update (checksum, (const guchar *) "target ", -1);
+      g_checksum_update (checksum, (const guchar *) uri, -1);
+      g_free (uri);
+    }
+
+  name = g_strconcat (JOURNAL_DIRECTORY, g_checksum_get_string (checksum), ".journal", NULL);
+  path = xfce_resource_save_location (XFCE_RESOURCE_CACHE, name, TRUE);
+  g_free (name);
+  g_checksum_free (checksum);
+
+  return path;
+}
+
+
+
+static gboolean
+thunar_transfer_journal_lock (FILE *stream)
+{
+#ifdef HAVE_SYS_FILE_H
+  return flock (fileno (stream), LOCK_EX | LOCK_NB) == 0;
+#else
+  return TRUE;
+#endif
+}
+
+
+
+static gboolean
+thunar_transfer_journal_parse (const gchar *path,
+                               GList      **source_file_list_return,
+                               GList      **target_file_list_return,
+                               GHashTable  *entries,
+                               gboolean    *cancelled_return)
+{
+  ThunarTransferJournalEntry *entry;
+  gchar                      *contents;
+  gchar                     **lines;
+  gchar                      *end;
+  gsize                       length;
+  guint                       n_lines;
+  guint64                     mtime;
+  guint64                     size;
+  guint64                     target_mtime;
+
+  if (!g_file_get_contents (path, &contents, &length, NULL))
+    return FALSE;
+
+  lines = g_strsplit (contents, "\n", -1);
+  n_lines = g_strv_length (lines);
+
+  /* the last line is incomplete if we crashed while writing it */
+  if (n_lines > 0 && (length == 0 || contents[length - 1] != '\n'))
+    n_lines--;
+
+  for (guint n = 0; n < n_lines; n++)
+    {
+      if (source_file_list_return != NULL && g_str_has_prefix (lines[n], "source "))
+        {
+          *source_file_list_return = g_list_prepend (*source_file_list_return, g_file_new_for_uri (lines[n] + 7));
+        }
+      else if (target_file_list_return != NULL && g_str_has_prefix (lines[n], "target "))
+        {
+          *target_file_list_return = g_list_prepend (*target_file_list_return, g_file_new_for_uri (lines[n] + 7));
+        }
+      else if (entries != NULL && g_str_has_prefix (lines[n], "done "))
+        {
+          mtime = g_ascii_strtoull (lines[n] + 5, &end, 10);
+          if (*end != ' ')
+            continue;
+
+          size = g_ascii_strtoull (end + 1, &end, 10);
+          if (*end != ' ')
+            continue;
+
+          target_mtime = g_ascii_strtoull (end + 1, &end, 10);
+          if (*end != ' ' || end[1] == '\0')
+            continue;
+
+          entry = g_new (ThunarTransferJournalEntry, 1);
+          entry->mtime = mtime;
+          entry->size = size;
+          entry->target_mtime = target_mtime;
+          g_hash_table_replace (entries, g_strdup (end + 1), entry);
+        }
+      else if (cancelled_return != NULL && strcmp (lines[n], "cancelled") == 0)
+        {
+          *cancelled_return = TRUE;
+        }
+    }
+
+  if (source_file_list_return != NULL)
+    *source_file_list_return = g_list_reverse (*source_file_list_return);
+  if (target_file_list_return != NULL)
+    *target_file_list_return = g_list_reverse (*target_file_list_return);
+
+  g_strfreev (lines);
+  g_free (contents);
+
+  return TRUE;
+}
+
+
+
+static gboolean
+thunar_transfer_journal_sync_file (GFile   *file,
+                                   guint64 *mtime_return)
+{
+  struct stat statb;
+  GFileInfo  *info;
+  gchar      *path;
+  gint        fd;
+  gint        result;
+
+  /* remote files are as durable as their backend makes them */
+  path = g_file_get_path (file);
+  if (path == NULL)
+    {
+      info = g_file_query_info (file, G_FILE_ATTRIBUTE_TIME_MODIFIED,
+                                G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, NULL, NULL);
+      if (info == NULL)
+        return FALSE;
+
+      *mtime_return = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+      g_object_unref (info);
+
+      return TRUE;
+    }
+
+  fd = g_open (path, O_RDONLY | O_CLOEXEC, 0);
+  g_free (path);
+  if (fd < 0)
+    return FALSE;
+
+#ifdef HAVE_FDATASYNC
+  result = fdatasync (fd);
+#else
+  result = fsync (fd);
+#endif
+
+  if (result == 0)
+    result = fstat (fd, &statb);
+  if (result == 0)
+    *mtime_return = statb.st_mtime;
+
+  close (fd);
+
+  return result == 0;
+}
+
+
+
+static void
+thunar_transfer_journal_flush (ThunarTransferJournal *journal)
+{
+  ThunarTransferJournalRecord *record;
+  guint64                      target_mtime;
+  gchar                       *uri;
+
+  if (journal->records->len == 0)
+    return;
+
+  /* only record files whose data is on the disk, so a crash right after
+   * writing the journal can not leave a truncated file behind that is
+   * skipped when the job is resumed */
+  for (guint n = 0; n < journal->records->len; n++)
+    {
+      record = &g_array_index (journal->records, ThunarTransferJournalRecord, n);
+
+      if (thunar_transfer_journal_sync_file (record->target_file, &target_mtime))
+        {
+          uri = g_file_get_uri (record->target_file);
+          fprintf (journal->stream, "done %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT " %s\n",
+                   record->mtime, record->size, target_mtime, uri);
+          g_free (uri);
+        }
+
+      g_object_unref (record->target_file);
+    }
+
+  g_array_set_size (journal->records, 0);
+
+  fflush (journal->stream);
+#ifdef HAVE_FDATASYNC
+  fdatasync (fileno (journal->stream));
+#else
+  fsync (fileno (journal->stream));
+#endif
+
+  journal->last_flush_time = g_get_monotonic_time ();
+}
+
+
+
+/**
+ * thunar_transfer_journal_open:
+ * @source_file_list : the #GFile<!---->s of the copy job.
+ * @target_file_list : the target #GFile<!---->s of the copy job.
+ *
+ * Opens the journal of a copy job. If an earlier run of the same job
+ * was interrupted, its journal is picked up again and the files it
+ * completed can be found with thunar_transfer_journal_lookup().
+ *
+ * Return value: the #ThunarTransferJournal or %NULL if the journal
+ *               could not be created or is used by another job.
+ **/
+ThunarTransferJournal *
+thunar_transfer_journal_open (GList *source_file_list,
+                              GList *target_file_list)
+{
+  ThunarTransferJournal *journal;
+  GStatBuf               statb;
+  GList                 *lp;
+  gchar                 *path;
+  gchar                 *uri;
+  FILE                  *stream;
+
+  path = thunar_transfer_journal_get_path (source_file_list, target_file_list);
+  if (G_UNLIKELY (path == NULL))
+    return NULL;
+
+  /* append to the journal of an earlier run, if any */
+  stream = g_fopen (path, "a");
+  if (G_UNLIKELY (stream == NULL))
+    {
+      g_free (path);
+      return NULL;
+    }
+
+  /* the same copy is already running */
+  if (!thunar_transfer_journal_lock (stream))
+    {
+      fclose (stream);
+      g_free (path);
+      return NULL;
+    }
+
+  journal = g_slice_new0 (ThunarTransferJournal);
+  journal->path = path;
+  journal->stream = stream;
+  journal->entries = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  journal->records = g_array_new (FALSE, FALSE, sizeof (ThunarTransferJournalRecord));
+  journal->last_flush_time = g_get_monotonic_time ();
+
+  if (g_stat (path, &statb) == 0 && statb.st_size > 0)
+    {
+      thunar_transfer_journal_parse (path, NULL, NULL, journal->entries, NULL);
+    }
+  else
+    {
+      for (lp = source_file_list; lp != NULL; lp = lp->next)
+        {
+          uri = g_file_get_uri (lp->data);
+          fprintf (stream, "source %s\n", uri);
+          g_free (uri);
+        }
+      for (lp = target_file_list; lp != NULL; lp = lp->next)
+        {
+          uri = g_file_get_uri (lp->data);
+          fprintf (stream, "target %s\n", uri);
+          g_free (uri);
+        }
+      fflush (stream);
+    }
+
+  return journal;
+}
+
+
+
+/**
+ * thunar_transfer_journal_close:
+ * @journal   : a #ThunarTransferJournal.
+ * @completed : whether the job completed.
+ * @cancelled : whether the job was cancelled by the user.
+ *
+ * Closes and frees @journal. The journal of a completed job is removed,
+ * otherwise it is kept so the job can be resumed. Cancelled jobs are
+ * resumed when started again, but not offered for resuming on startup.
+ **/
+void
+thunar_transfer_journal_close (ThunarTransferJournal *journal,
+                               gboolean               completed,
+                               gboolean               cancelled)
+{
+  _thunar_return_if_fail (journal != NULL);
+
+  if (completed)
+    {
+      g_unlink (journal->path);
+    }
+  else
+    {
+      thunar_transfer_journal_flush (journal);
+      if (cancelled)
+        fputs ("cancelled\n", journal->stream);
+    }
+
+  for (guint n = 0; n < journal->records->len; n++)
+    g_object_unref (g_array_index (journal->records, ThunarTransferJournalRecord, n).target_file);
+  g_array_free (journal->records, TRUE);
+
+  /* this also releases the lock */
+  fclose (journal->stream);
+
+  g_hash_table_destroy (journal->entries);
+  g_free (journal->path);
+  g_slice_free (ThunarTransferJournal, journal);
+}
+
+
+
+/**
+ * thunar_transfer_journal_lookup:
+ * @journal      : a #ThunarTransferJournal.
+ * @target_file  : a target #GFile.
+ * @mtime_return        : return location for the source modification time.
+ * @size_return         : return location for the size.
+ * @target_mtime_return : return location for the modification time of
+ *                        @target_file after it was copied.
+ *
+ * Checks whether an earlier run of the job completely copied a
+ * file to @target_file.
+ *
+ * Return value: %TRUE if the file was copied, %FALSE otherwise.
+ **/
+gboolean
+thunar_transfer_journal_lookup (ThunarTransferJournal *journal,
+                                GFile                 *target_file,
+                                guint64               *mtime_return,
+                                guint64               *size_return,
+                                guint64               *target_mtime_return)
+{
+  ThunarTransferJournalEntry *entry;
+  gchar                      *uri;
+
+  _thunar_return_val_if_fail (journal != NULL, FALSE);
+  _thunar_return_val_if_fail (G_IS_FILE (target_file), FALSE);
+
+  if (g_hash_table_size (journal->entries) == 0)
+    return FALSE;
+
+  uri = g_file_get_uri (target_file);
+  entry = g_hash_table_lookup (journal->entries, uri);
+  g_free (uri);
+
+  if (entry == NULL)
+    return FALSE;
+
+  *mtime_return = entry->mtime;
+  *size_return = entry->size;
+  *target_mtime_return = entry->target_mtime;
+
+  return TRUE;
+}
+
+
+
+/**
+ * thunar_transfer_journal_add:
+ * @journal     : a #ThunarTransferJournal.
+ * @target_file : the #GFile that was completely copied.
+ * @mtime       : the modification time of the source file.
+ * @size        : the size of the file.
+ *
+ * Records that @target_file was completely copied. The files are synced
+ * to the disk and written to the journal in batches, so a crash may lose
+ * the last few records.
+ **/
+void
+thunar_transfer_journal_add (ThunarTransferJournal *journal,
+                             GFile                 *target_file,
+                             guint64                mtime,
+                             guint64                size)
+{
+  ThunarTransferJournalRecord record;
+
+  _thunar_return_if_fail (journal != NULL);
+  _thunar_return_if_fail (G_IS_FILE (target_file));
+
+  record.target_file = g_object_ref (target_file);
+  record.mtime = mtime;
+  record.size = size;
+  g_array_append_val (journal->records, record);
+
+  if (journal->records->len >= JOURNAL_FLUSH_ENTRIES
+      || g_get_monotonic_time () - journal->last_flush_time > JOURNAL_FLUSH_INTERVAL)
+    thunar_transfer_journal_flush (journal);
+}
+
+
+
+/**
+ * thunar_transfer_journal_list_pending:
+ *
+ * Looks for journals of copy jobs that were interrupted by a crash or
+ * logout and are not running anymore. Journals that are too old to be
+ * resumed are removed.
+ *
+ * Return value: (transfer full): a list of journal paths, free with
+ *               g_list_free_full() and g_free().
+ **/
+GList *
+thunar_transfer_journal_list_pending (void)
+{
+  GStatBuf     statb;
+  const gchar *name;
+  gboolean     cancelled;
+  gchar       *directory;
+  gchar       *path;
+  GList       *pending = NULL;
+  FILE        *stream;
+  GDir        *dir;
+
+  directory = xfce_resource_save_location (XFCE_RESOURCE_CACHE, JOURNAL_DIRECTORY, FALSE);
+  if (directory == NULL)
+    return NULL;
+
+  dir = g_dir_open (directory, 0, NULL);
+  if (dir == NULL)
+    {
+      g_free (directory);
+      return NULL;
+    }
+
+  while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      if (!g_str_has_suffix (name, ".journal"))
+        continue;
+
+      path = g_build_filename (directory, name, NULL);
+
+      if (g_stat (path, &statb) == 0 && (time (NULL) - statb.st_mtime) > JOURNAL_MAX_AGE)
+        {
+          g_unlink (path);
+          g_free (path);
+          continue;
+        }
+
+      /* skip journals of running jobs */
+      stream = g_fopen (path, "r");
+      if (stream != NULL && thunar_transfer_journal_lock (stream))
+        {
+          cancelled = FALSE;
+          if (thunar_transfer_journal_parse (path, NULL, NULL, NULL, &cancelled) && !cancelled)
+            {
+              pending = g_list_prepend (pending, path);
+              path = NULL;
+            }
+        }
+
+      if (stream != NULL)
+        fclose (stream);
+      g_free (path);
+    }
+
+  g_dir_close (dir);
+  g_free (directory);
+
+  return pending;
+}
+
+
+
+/**
+ * thunar_transfer_journal_load:
+ * @path                    : the path of a journal.
+ * @source_file_list_return : return location for the source #GFile<!---->s.
+ * @target_file_list_return : return location for the target #GFile<!---->s.
+ *
+ * Reads the files of the copy job recorded in the journal at @path.
+ * Starting a copy job for them resumes it.
+ *
+ * Return value: %TRUE if the journal was read, %FALSE otherwise.
+ **/
+gboolean
+thunar_transfer_journal_load (const gchar *path,
+                              GList      **source_file_list_return,
+                              GList      **target_file_list_return)
+{
+  _thunar_return_val_if_fail (path != NULL, FALSE);
+
+  *source_file_list_return = NULL;
+  *target_file_list_return = NULL;
+
+  if (thunar_transfer_journal_parse (path, source_file_list_return, target_file_list_return, NULL, NULL)
+      && *source_file_list_return != NULL
+      && g_list_length (*source_file_list_return) == g_list_length (*target_file_list_return))
+    return TRUE;
+
+  thunar_g_list_free_full (*source_file_list_return);
+  thunar_g_list_free_full (*target_file_list_return);
+  *source_file_list_return = NULL;
+  *target_file_list_return = NULL;
+
+  return FALSE;
+}
+
+
+
+/**
+ * thunar_transfer_journal_discard:
+ * @path : the path of a journal.
+ *
+ * Removes the journal at @path, the interrupted job will
+ * not be resumed.
+ **/
+void
+thunar_transfer_journal_discard (const gchar *path)
+{
+  _thunar_return_if_fail (path != NULL);
+
+  g_unlink (path);
+}
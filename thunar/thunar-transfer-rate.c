@@ -0,0 +1,271 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * Copyright (c) 2024 The Thunar development team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Estimates the transfer rate and the remaining time of a transfer from
+ * samples of its progress. The caller passes the active transfer time,
+ * so pauses and questions to the user don't drag the rate down.
+ *
+ * The displayed rates are exponentially weighted moving averages with a
+ * time constant of a few seconds. The remaining time uses a slower model
+ * which splits the time of each interval into a part per byte and a part
+ * per file:
+ *
+ *   dt = bytes * seconds_per_byte + files * seconds_per_file
+ *
+ * fitted by exponentially weighted least squares, so many small files and
+ * a few large ones are both estimated well. Short bursts into a write
+ * cache are smoothed out by the longer time constant.
+ *
+ * The samples are kept, so recorded traces can be replayed through a
+ * new estimator. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "thunar/thunar-private.h"
+#include "thunar/thunar-transfer-rate.h"
+
+
+
+/* time constant of the displayed rates */
+#define RATE_TIME_CONSTANT (5.0) /* s */
+
+/* time constant of the remaining time model */
+#define MODEL_TIME_CONSTANT (30.0) /* s */
+
+/* number of samples kept for replaying */
+#define MAX_SAMPLES (4096)
+
+
+
+struct _ThunarTransferRate
+{
+  GArray *samples;
+
+  gdouble bytes_per_second;
+  gdouble files_per_second;
+
+  /* weighted sums of the least squares fit */
+  gdouble sum_bb; /* bytes * bytes */
+  gdouble sum_bf; /* bytes * files */
+  gdouble sum_ff; /* files * files */
+  gdouble sum_tb; /* time * bytes */
+  gdouble sum_tf; /* time * files */
+};
+
+
+
+/**
+ * thunar_transfer_rate_new:
+ *
+ * Return value: a new estimator without samples, to be released
+ *               with thunar_transfer_rate_free().
+ **/
+ThunarTransferRate *
+thunar_transfer_rate_new (void)
+{
+  ThunarTransferRate *rate;
+
+  rate = g_slice_new0 (ThunarTransferRate);
+  rate->samples = g_array_new (FALSE, FALSE, sizeof (ThunarTransferRateSample));
+
+  return rate;
+}
+
+
+
+void
+thunar_transfer_rate_free (ThunarTransferRate *rate)
+{
+  if (rate == NULL)
+    return;
+
+  g_array_free (rate->samples, TRUE);
+  g_slice_free (ThunarTransferRate, rate);
+}
+
+
+
+/**
+ * thunar_transfer_rate_add_sample:
+ * @rate  : a #ThunarTransferRate.
+ * @time  : active transfer time in microseconds.
+ * @bytes : bytes transferred until @time.
+ * @files : files completed until @time.
+ *
+ * Adds a sample of the progress of the transfer. Samples must not go
+ * back in time, those that do are ignored.
+ **/
+void
+thunar_transfer_rate_add_sample (ThunarTransferRate *rate,
+                                 gint64              time,
+                                 guint64             bytes,
+                                 guint64             files)
+{
+  const ThunarTransferRateSample *last;
+  ThunarTransferRateSample        sample = { time, bytes, files };
+  gdouble                         dt;
+  gdouble                         db;
+  gdouble                         df;
+  gdouble                         alpha;
+  gdouble                         decay;
+
+  _thunar_return_if_fail (rate != NULL);
+
+  if (rate->samples->len > 0)
+    {
+      last = &g_array_index (rate->samples, ThunarTransferRateSample, rate->samples->len - 1);
+      if (time <= last->time)
+        return;
+
+      /* progress can go back when a failed file is copied again */
+      dt = (gdouble) (time - last->time) / G_USEC_PER_SEC;
+      db = bytes > last->bytes ? (gdouble) (bytes - last->bytes) : 0.0;
+      df = files > last->files ? (gdouble) (files - last->files) : 0.0;
+
+      /* the weight of a sample depends on its length, so irregular
+       * sampling doesn't change the result much */
+      alpha = dt / (dt + RATE_TIME_CONSTANT);
+      if (rate->samples->len > 1)
+        {
+          rate->bytes_per_second += alpha * (db / dt - rate->bytes_per_second);
+          rate->files_per_second += alpha * (df / dt - rate->files_per_second);
+        }
+      else
+        {
+          rate->bytes_per_second = db / dt;
+          rate->files_per_second = df / dt;
+        }
+
+      decay = MODEL_TIME_CONSTANT / (dt + MODEL_TIME_CONSTANT);
+      rate->sum_bb = rate->sum_bb * decay + db * db;
+      rate->sum_bf = rate->sum_bf * decay + db * df;
+      rate->sum_ff = rate->sum_ff * decay + df * df;
+      rate->sum_tb = rate->sum_tb * decay + dt * db;
+      rate->sum_tf = rate->sum_tf * decay + dt * df;
+    }
+
+  /* keep the most recent samples */
+  if (rate->samples->len >= MAX_SAMPLES)
+    g_array_remove_range (rate->samples, 0, MAX_SAMPLES / 2);
+
+  g_array_append_val (rate->samples, sample);
+}
+
+
+
+gdouble
+thunar_transfer_rate_get_bytes_per_second (const ThunarTransferRate *rate)
+{
+  _thunar_return_val_if_fail (rate != NULL, 0.0);
+  return rate->bytes_per_second;
+}
+
+
+
+gdouble
+thunar_transfer_rate_get_files_per_second (const ThunarTransferRate *rate)
+{
+  _thunar_return_val_if_fail (rate != NULL, 0.0);
+  return rate->files_per_second;
+}
+
+
+
+/**
+ * thunar_transfer_rate_get_remaining_time:
+ * @rate            : a #ThunarTransferRate.
+ * @remaining_bytes : bytes left to transfer.
+ * @remaining_files : files left to transfer.
+ *
+ * Return value: the estimated remaining time in seconds, or -1 if there
+ *               are not enough samples yet.
+ **/
+gint64
+thunar_transfer_rate_get_remaining_time (const ThunarTransferRate *rate,
+                                         guint64                   remaining_bytes,
+                                         guint64                   remaining_files)
+{
+  gdouble seconds_per_byte;
+  gdouble seconds_per_file;
+  gdouble det;
+
+  _thunar_return_val_if_fail (rate != NULL, -1);
+
+  if (rate->sum_bb <= 0.0 && rate->sum_ff <= 0.0)
+    return -1;
+
+  det = rate->sum_bb * rate->sum_ff - rate->sum_bf * rate->sum_bf;
+
+  /* if all files were about the same size, the two parts cannot be told
+   * apart, but then either one alone predicts the rest just as well */
+  if (det > 1e-9 * rate->sum_bb * rate->sum_ff)
+    {
+      seconds_per_byte = (rate->sum_tb * rate->sum_ff - rate->sum_tf * rate->sum_bf) / det;
+      seconds_per_file = (rate->sum_tf * rate->sum_bb - rate->sum_tb * rate->sum_bf) / det;
+    }
+  else
+    {
+      seconds_per_byte = -1.0;
+      seconds_per_file = -1.0;
+    }
+
+  /* neither part can be negative, fall back to the other alone */
+  if (seconds_per_byte < 0.0 || seconds_per_file < 0.0)
+    {
+      if (rate->sum_bb > 0.0 && (remaining_bytes > 0 || rate->sum_ff <= 0.0))
+        {
+          seconds_per_byte = rate->sum_tb / rate->sum_bb;
+          seconds_per_file = 0.0;
+        }
+      else
+        {
+          seconds_per_byte = 0.0;
+          seconds_per_file = rate->sum_tf / rate->sum_ff;
+        }
+    }
+
+  return (gint64) (seconds_per_byte * remaining_bytes + seconds_per_file * remaining_files + 0.5);
+}
+
+
+
+/**
+ * thunar_transfer_rate_get_samples:
+ * @rate             : a #ThunarTransferRate.
+ * @n_samples_return : return location for the number of samples.
+ *
+ * Returns the most recent samples added to @rate, oldest first. Feeding
+ * them to a new estimator gives the same estimates, as long as not more
+ * samples were added than are kept.
+ *
+ * Return value: (transfer none): the samples, owned by @rate.
+ **/
+const ThunarTransferRateSample *
+thunar_transfer_rate_get_samples (const ThunarTransferRate *rate,
+                                  guint                    *n_samples_return)
+{
+  _thunar_return_val_if_fail (rate != NULL, NULL);
+  _thunar_return_val_if_fail (n_samples_return != NULL, NULL);
+
+  *n_samples_return = rate->samples->len;
+  return (const ThunarTransferRateSample *) rate->samples->data;
+}
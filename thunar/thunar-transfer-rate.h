@@ -0,0 +1,60 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * Copyright (c) 2024 The Thunar development team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __THUNAR_TRANSFER_RATE_H__
+#define __THUNAR_TRANSFER_RATE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS;
+
+typedef struct _ThunarTransferRate ThunarTransferRate;
+
+typedef struct
+{
+  gint64  time;  /* us of active transfer time, without pauses */
+  guint64 bytes; /* bytes transferred so far */
+  guint64 files; /* files completed so far */
+} ThunarTransferRateSample;
+
+ThunarTransferRate *
+thunar_transfer_rate_new (void);
+void
+thunar_transfer_rate_free (ThunarTransferRate *rate);
+void
+thunar_transfer_rate_add_sample (ThunarTransferRate *rate,
+                                 gint64              time,
+                                 guint64             bytes,
+                                 guint64             files);
+gdouble
+thunar_transfer_rate_get_bytes_per_second (const ThunarTransferRate *rate);
+gdouble
+thunar_transfer_rate_get_files_per_second (const ThunarTransferRate *rate);
+gint64
+thunar_transfer_rate_get_remaining_time (const ThunarTransferRate *rate,
+                                         guint64                   remaining_bytes,
+                                         guint64                   remaining_files);
+const ThunarTransferRateSample *
+thunar_transfer_rate_get_samples (const ThunarTransferRate *rate,
+                                  guint                    *n_samples_return);
+
+G_END_DECLS;
+
+#endif /* !__THUNAR_TRANSFER_RATE_H__ */
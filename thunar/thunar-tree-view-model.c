@@ -59,6 +59,7 @@
 #include "thunar/thunar-io-jobs.h"
 #include "thunar/thunar-preferences.h"
 #include "thunar/thunar-private.h"
+#include "thunar/thunar-search-matcher.h"
 #include "thunar/thunar-simple-job.h"
 #include "thunar/thunar-tree-view-model.h"
 #include "thunar/thunar-user.h"
@@ -341,6 +342,11 @@ thunar_tree_view_model_update_search_files (ThunarTreeViewModel *model);
 static void
 thunar_tree_view_model_add_search_files (ThunarStandardViewModel *model,
                                          GList                   *files);
+static void
+thunar_tree_view_model_remove_search_files (ThunarStandardViewModel *model,
+                                            GList                   *files);
+static void
+thunar_tree_view_model_clear_search_nodes (ThunarTreeViewModel *model);
 
 
 /*************************************************
@@ -353,7 +359,8 @@ struct _ThunarTreeViewModelClass
   /* signals */
   void (*error) (ThunarTreeViewModel *model,
                  const GError        *error);
-  void (*search_done) (void);
+  void (*search_done) (ThunarTreeViewModel *model,
+                       guint                n_pruned);
 };
 
 
@@ -393,12 +400,18 @@ struct _ThunarTreeViewModel
   gint n_visible_files;
   gint loading;
 
-  gchar **search_terms;
+  ThunarSearchMatcher *search_matcher;
 
   ThunarJob *search_job;
-  GList     *search_files;
   GMutex     mutex_add_search_files;
 
+  /* search results, already turned into nodes by the search threads and
+   * waiting to be spliced into the model by the update timeout */
+  GList *search_nodes;
+
+  /* search results the search took back, dropped by the update timeout */
+  GHashTable *search_files_to_remove;
+
   guint update_search_results_timeout_id;
 };
 
@@ -574,8 +587,9 @@ thunar_tree_view_model_init (ThunarTreeViewModel *model)
   model->search_job = NULL;
   model->update_search_results_timeout_id = 0;
 
-  model->search_terms = NULL;
-  model->search_files = NULL;
+  model->search_matcher = NULL;
+  model->search_nodes = NULL;
+  model->search_files_to_remove = g_hash_table_new_full (g_direct_hash, NULL, g_object_unref, NULL);
   g_mutex_init (&model->mutex_add_search_files);
 
   model->sort_func = thunar_file_compare_by_name;
@@ -623,6 +637,7 @@ thunar_tree_view_model_standard_view_model_init (ThunarStandardViewModelIface *i
   iface->set_folders_first = thunar_tree_view_model_set_folders_first;
   iface->set_hidden_last = thunar_tree_view_model_set_hidden_last;
   iface->add_search_files = thunar_tree_view_model_add_search_files;
+  iface->remove_search_files = thunar_tree_view_model_remove_search_files;
 }
 
 
@@ -671,9 +686,10 @@ thunar_tree_view_model_finalize (GObject *object)
                                      NULL, NULL);
 
   g_mutex_clear (&model->mutex_add_search_files);
+  g_hash_table_destroy (model->search_files_to_remove);
 
   g_free (model->date_custom_style);
-  g_strfreev (model->search_terms);
+  thunar_search_matcher_free (model->search_matcher);
 
   g_hash_table_destroy (model->subdirs);
 
@@ -1710,6 +1726,13 @@ static void
 _thunar_tree_view_model_search_finished (ThunarJob           *job,
                                          ThunarTreeViewModel *model)
 {
+  GArray *param_values;
+  guint   n_pruned;
+
+  /* the search job stores the number of folders left out by the prune rules */
+  param_values = thunar_simple_job_get_param_values (THUNAR_SIMPLE_JOB (job));
+  n_pruned = g_value_get_uint (&g_array_index (param_values, GValue, 8));
+
   if (model->search_job)
     {
       g_signal_handlers_disconnect_by_data (model->search_job, model);
@@ -1724,10 +1747,9 @@ _thunar_tree_view_model_search_finished (ThunarJob           *job,
       model->update_search_results_timeout_id = 0;
     }
 
-  thunar_g_list_free_full (model->search_files);
-  model->search_files = NULL;
+  thunar_tree_view_model_clear_search_nodes (model);
 
-  g_signal_emit_by_name (model, "search-done");
+  g_signal_emit_by_name (model, "search-done", n_pruned);
 }
 
 
@@ -1754,7 +1776,8 @@ thunar_tree_view_model_set_folder (ThunarStandardViewModel *model,
                                    gchar                   *search_query)
 {
   ThunarTreeViewModel *_model;
-  gchar               *search_query_normalized;
+  ThunarPreferences   *preferences;
+  gboolean             fuzzy;
 
   _thunar_return_if_fail (THUNAR_IS_TREE_VIEW_MODEL (model));
 
@@ -1767,8 +1790,7 @@ thunar_tree_view_model_set_folder (ThunarStandardViewModel *model,
       g_source_remove (_model->update_search_results_timeout_id);
       _model->update_search_results_timeout_id = 0;
     }
-  thunar_g_list_free_full (_model->search_files);
-  _model->search_files = NULL;
+  thunar_tree_view_model_clear_search_nodes (_model);
 
   thunar_tree_view_model_cleanup_model (_model);
   _model->root = NULL;
@@ -1794,14 +1816,17 @@ thunar_tree_view_model_set_folder (ThunarStandardViewModel *model,
     thunar_tree_view_model_load_dir (_model->root);
   else
     {
-      search_query_normalized = thunar_g_utf8_normalize_for_search (search_query, TRUE, TRUE);
-      g_strfreev (_model->search_terms);
-      _model->search_terms = thunar_util_split_search_query (search_query_normalized, NULL);
-      if (_model->search_terms != NULL)
+      preferences = thunar_preferences_get ();
+      g_object_get (G_OBJECT (preferences), "misc-fuzzy-search", &fuzzy, NULL);
+      g_object_unref (preferences);
+
+      thunar_search_matcher_free (_model->search_matcher);
+      _model->search_matcher = thunar_search_matcher_new (search_query, fuzzy);
+      if (_model->search_matcher != NULL)
         {
           /* search the current folder
            * start a new recursive_search_job */
-          _model->search_job = thunar_io_jobs_search_directory (THUNAR_STANDARD_VIEW_MODEL (_model), search_query_normalized, thunar_folder_get_corresponding_file (folder));
+          _model->search_job = thunar_io_jobs_search_directory (THUNAR_STANDARD_VIEW_MODEL (_model), search_query, thunar_folder_get_corresponding_file (folder));
           g_signal_connect (_model->search_job, "error", G_CALLBACK (_thunar_tree_view_model_search_error), NULL);
           g_signal_connect (_model->search_job, "finished", G_CALLBACK (_thunar_tree_view_model_search_finished), _model);
           exo_job_launch (EXO_JOB (_model->search_job));
@@ -1809,7 +1834,6 @@ thunar_tree_view_model_set_folder (ThunarStandardViewModel *model,
           /* add new results to the model every X ms */
           _model->update_search_results_timeout_id = g_timeout_add (500, G_SOURCE_FUNC (thunar_tree_view_model_update_search_files), _model);
         }
-      g_free (search_query_normalized);
     }
 
   /* notify listeners that we have a new folder */
@@ -3103,18 +3127,17 @@ static gboolean
 _thunar_tree_view_model_matches_search_terms (ThunarTreeViewModel *model,
                                               ThunarFile          *file)
 {
-  gboolean matched;
-  gchar   *name_n;
+  const gchar *display_name;
+  GFileInfo   *info;
 
-  name_n = (gchar *) thunar_file_get_display_name (file);
-  if (name_n == NULL)
+  /* a file without info cannot be checked, so it does not match */
+  display_name = thunar_file_get_display_name (file);
+  info = thunar_file_get_info (file);
+  if (display_name == NULL || info == NULL)
     return FALSE;
 
-  name_n = thunar_g_utf8_normalize_for_search (name_n, TRUE, TRUE);
-  matched = thunar_util_search_terms_match (model->search_terms, name_n);
-  g_free (name_n);
-
-  return matched;
+  return thunar_search_matcher_match (model->search_matcher, display_name)
+         && thunar_search_matcher_match_info (model->search_matcher, info);
 }
 
 
@@ -3151,43 +3174,102 @@ _thunar_tree_view_model_search_file_changed (Node *node, ThunarFile *file)
 static gboolean
 thunar_tree_view_model_update_search_files (ThunarTreeViewModel *model)
 {
-  ThunarFile *file;
+  GtkTreeIter    tree_iter;
+  GtkTreePath   *path;
+  GList         *nodes;
+  GHashTable    *files_to_remove;
+  GHashTableIter iter;
+  gpointer       key;
+  Node          *node;
+  Node          *last = NULL;
+  gint          *indices;
 
+  /* take the whole batch, so that the search threads are not blocked
+   * while its rows are inserted */
   g_mutex_lock (&model->mutex_add_search_files);
+  nodes = model->search_nodes;
+  model->search_nodes = NULL;
+  files_to_remove = model->search_files_to_remove;
+  model->search_files_to_remove = g_hash_table_new_full (g_direct_hash, NULL, g_object_unref, NULL);
+  g_mutex_unlock (&model->mutex_add_search_files);
+
+  /* drop the results the search took back first */
+  g_hash_table_iter_init (&iter, files_to_remove);
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    if (g_hash_table_contains (model->root->set, key))
+      thunar_tree_view_model_dir_remove_file (model->root, key);
+  g_hash_table_destroy (files_to_remove);
+
+  if (nodes == NULL)
+    return TRUE;
+
+  /* like in the list model, one path is reused for all rows of the
+   * batch. The results are toplevel rows, so only its first index
+   * changes, and a dummy child only appends a second one */
+  path = gtk_tree_path_new_first ();
+  indices = gtk_tree_path_get_indices (path);
 
-  for (GList *lp = model->search_files; lp != NULL; lp = lp->next)
+  for (GList *lp = nodes; lp != NULL; lp = lp->next)
     {
-      file = THUNAR_FILE (lp->data);
-      if (THUNAR_IS_FILE (file) == FALSE)
+      node = lp->data;
+
+      /* a dummy node follows the folder it was built for and gives it
+       * its expander. It is only added once the folder's own row was
+       * announced, so that the folder has no children at that point */
+      if (node->file == NULL)
         {
-          g_warning ("failed to add file to search results");
+          if (last == NULL || node->parent != last)
+            {
+              thunar_tree_view_model_node_destroy (node);
+              continue;
+            }
+
+          node->depth = last->depth + 1;
+          node->ptr = g_sequence_prepend (last->children, node);
+          last->n_children++;
+
+          GTK_TREE_ITER_INIT (tree_iter, model->stamp, node->ptr);
+          gtk_tree_path_append_index (path, 0);
+          gtk_tree_model_row_inserted (GTK_TREE_MODEL (model), path, &tree_iter);
+          gtk_tree_path_up (path);
+
+          GTK_TREE_ITER_INIT (tree_iter, model->stamp, last->ptr);
+          gtk_tree_model_row_has_child_toggled (GTK_TREE_MODEL (model), path, &tree_iter);
           continue;
         }
 
-      /* take a reference on that file */
-      g_object_ref (file);
-
-      if (_thunar_tree_view_model_matches_search_terms (model, file))
+      /* the search job already checked the query, like in the list model;
+       * files found by their contents would not match it by name. Only
+       * skip files which are already shown */
+      last = NULL;
+      if (g_hash_table_contains (model->root->set, node->file))
         {
-          Node *node;
-          node = thunar_tree_view_model_dir_add_file (model->root, lp->data);
-          if (node != NULL)
-            {
-              /* start watching the file */
-              g_signal_connect_swapped (file, "destroy", G_CALLBACK (_thunar_tree_view_model_search_file_destroyed), node);
-              g_signal_connect_swapped (file, "changed", G_CALLBACK (_thunar_tree_view_model_search_file_changed), node);
-              thunar_file_watch (file);
-              node->file_watch_active = TRUE;
-            }
+          thunar_tree_view_model_node_destroy (node);
+          continue;
         }
 
-      g_object_unref (file);
+      node->depth = model->root->depth + 1;
+      node->parent = model->root;
+      node->model = model;
+      node->ptr = g_sequence_insert_sorted (model->root->children, node,
+                                            thunar_tree_view_model_cmp_nodes, model);
+      model->root->n_children++;
+      g_hash_table_insert (model->root->set, node->file, node->ptr);
+
+      GTK_TREE_ITER_INIT (tree_iter, model->stamp, node->ptr);
+      indices[0] = g_sequence_iter_get_position (node->ptr);
+      gtk_tree_model_row_inserted (GTK_TREE_MODEL (model), path, &tree_iter);
+      last = node;
+
+      /* start watching the file */
+      g_signal_connect_swapped (node->file, "destroy", G_CALLBACK (_thunar_tree_view_model_search_file_destroyed), node);
+      g_signal_connect_swapped (node->file, "changed", G_CALLBACK (_thunar_tree_view_model_search_file_changed), node);
+      thunar_file_watch (node->file);
+      node->file_watch_active = TRUE;
     }
 
-  if (model->search_files != NULL)
-    g_list_free (model->search_files);
-  model->search_files = NULL;
-  g_mutex_unlock (&model->mutex_add_search_files);
+  gtk_tree_path_free (path);
+  g_list_free (nodes);
 
   return TRUE;
 }
@@ -3199,10 +3281,98 @@ thunar_tree_view_model_add_search_files (ThunarStandardViewModel *model,
                                          GList                   *files)
 {
   ThunarTreeViewModel *_model = THUNAR_TREE_VIEW_MODEL (model);
+  GList               *nodes = NULL;
+  Node                *node;
+  Node                *dummy;
+
+  /* this runs in the search threads, so build the nodes here. Probing
+   * whether a folder has any children needs to read it, which would
+   * otherwise stall the main thread once per folder in the results */
+  for (GList *lp = files; lp != NULL; lp = lp->next)
+    {
+      if (!THUNAR_IS_FILE (lp->data))
+        {
+          g_warning ("failed to add file to search results");
+          continue;
+        }
+
+      node = thunar_tree_view_model_new_node (lp->data);
+      nodes = g_list_prepend (nodes, node);
+
+      /* the dummy child is only queued right after its folder here,
+       * the main thread adds it once the folder's row is announced */
+      if (thunar_file_is_directory (lp->data) && !thunar_file_is_empty_directory (lp->data))
+        {
+          dummy = thunar_tree_view_model_new_dummy_node ();
+          dummy->parent = node;
+          nodes = g_list_prepend (nodes, dummy);
+        }
+    }
+
+  /* the nodes hold their own references, the list stays with the caller */
+  g_list_foreach (files, (GFunc) (void (*) (void)) g_object_unref, NULL);
+
+  g_mutex_lock (&_model->mutex_add_search_files);
+  _model->search_nodes = g_list_concat (_model->search_nodes, g_list_reverse (nodes));
+  g_mutex_unlock (&_model->mutex_add_search_files);
+}
+
+
+
+static void
+thunar_tree_view_model_remove_search_files (ThunarStandardViewModel *model,
+                                            GList                   *files)
+{
+  ThunarTreeViewModel *_model = THUNAR_TREE_VIEW_MODEL (model);
+  GList               *lp;
+  Node                *node;
+  Node                *dummy;
 
   g_mutex_lock (&_model->mutex_add_search_files);
 
-  _model->search_files = g_list_concat (_model->search_files, files);
+  for (GList *fp = files; fp != NULL; fp = fp->next)
+    {
+      for (lp = _model->search_nodes; lp != NULL; lp = lp->next)
+        if (((Node *) lp->data)->file == fp->data)
+          break;
+
+      if (lp == NULL)
+        {
+          g_hash_table_add (_model->search_files_to_remove, g_object_ref (fp->data));
+          continue;
+        }
+
+      /* a file which did not make it into the model yet is just dropped,
+       * together with the dummy child queued right after it */
+      node = lp->data;
+      if (lp->next != NULL)
+        {
+          dummy = lp->next->data;
+          if (dummy->file == NULL && dummy->parent == node)
+            {
+              thunar_tree_view_model_node_destroy (dummy);
+              _model->search_nodes = g_list_delete_link (_model->search_nodes, lp->next);
+            }
+        }
+      thunar_tree_view_model_node_destroy (node);
+      _model->search_nodes = g_list_delete_link (_model->search_nodes, lp);
+    }
 
   g_mutex_unlock (&_model->mutex_add_search_files);
 }
+
+
+
+static void
+thunar_tree_view_model_clear_search_nodes (ThunarTreeViewModel *model)
+{
+  GList *nodes;
+
+  g_mutex_lock (&model->mutex_add_search_files);
+  nodes = model->search_nodes;
+  model->search_nodes = NULL;
+  g_hash_table_remove_all (model->search_files_to_remove);
+  g_mutex_unlock (&model->mutex_add_search_files);
+
+  g_list_free_full (nodes, (GDestroyNotify) thunar_tree_view_model_node_destroy);
+}
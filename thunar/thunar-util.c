@@ -1079,61 +1079,6 @@ thunar_util_clip_view_background (GtkCellRenderer     *cell,
 
 
 
-/**
- * thunar_util_split_search_query:
- * @search_query: The search query to split.
- * @error: Return location for regex compilation errors.
- *
- * Search terms are split on whitespace. Search queries must be
- * normalized before passing to this function.
- *
- * See also: thunar_g_utf8_normalize_for_search().
- *
- * Return value: a list of search terms which must be freed with g_strfreev()
- **/
-gchar **
-thunar_util_split_search_query (const gchar *search_query_normalized,
-                                GError     **error)
-{
-  GRegex *whitespace_regex;
-  gchar **search_terms;
-
-  whitespace_regex = g_regex_new ("\\s+", 0, 0, error);
-  if (whitespace_regex == NULL)
-    return NULL;
-  search_terms = g_regex_split (whitespace_regex, search_query_normalized, 0);
-  g_regex_unref (whitespace_regex);
-  return search_terms;
-}
-
-
-
-/**
- * thunar_util_search_terms_match:
- * @terms: The search terms to look for, prepared with thunar_util_split_search_query().
- * @str: The string which the search terms might be found in.
- *
- * All search terms must match. Thunar uses simple substring matching
- * for the broadest multilingual support. @str must be normalized before
- * passing to this function.
- *
- * See also: thunar_g_utf8_normalize_for_search().
- *
- * Return value: TRUE if all terms matched, FALSE otherwise.
- **/
-
-gboolean
-thunar_util_search_terms_match (gchar **terms,
-                                gchar  *str)
-{
-  for (gint i = 0; terms[i] != NULL; i++)
-    if (g_strrstr (str, terms[i]) == NULL)
-      return FALSE;
-  return TRUE;
-}
-
-
-
 gboolean
 thunar_util_save_geometry_timer (gpointer user_data)
 {
@@ -109,12 +109,6 @@ thunar_util_clip_view_background (GtkCellRenderer     *cell,
                                   const GdkRectangle  *background_area,
                                   GtkWidget           *widget,
                                   GtkCellRendererState flags);
-gchar **
-thunar_util_split_search_query (const gchar *search_query_normalized,
-                                GError     **error);
-gboolean
-thunar_util_search_terms_match (gchar **terms,
-                                gchar  *str);
 gboolean
 thunar_util_save_geometry_timer (gpointer user_data);
 gchar *